@@ -0,0 +1,181 @@
+#include "alloc_tracker.hpp"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+
+namespace {
+
+struct ScopeEntry {
+	const char* name;
+	std::atomic<size_t> numAllocs, numFrees, numBytes; // current frame
+	AllocCounts frame, total; // only touched by allocTrackerEndFrame() and getAllocScopeStats()
+};
+
+}
+
+// the counters are used before main() and after it returns, so everything here must be constant initialized
+static ScopeEntry s_scopes[MAX_ALLOC_SCOPES] = { {"other", {}, {}, {}, {}, {}} };
+static std::atomic<int> s_numScopes = { 1 };
+static std::mutex s_scopesMutex; // for adding scopes
+static std::mutex s_framesMutex; // for the per frame counts
+static thread_local int t_scope = 0;
+static thread_local bool t_strict = false;
+
+static int findOrAddScope(const char* name)
+{
+	for (int i = 0; i < s_numScopes.load(std::memory_order_acquire); i++)
+		if (s_scopes[i].name == name)
+			return i;
+
+	std::lock_guard<std::mutex> lock(s_scopesMutex);
+	const int n = s_numScopes.load(std::memory_order_relaxed);
+	for (int i = 0; i < n; i++)
+		if (s_scopes[i].name == name)
+			return i;
+	if (n == MAX_ALLOC_SCOPES)
+		return 0; // we go to "other"
+	s_scopes[n].name = name;
+	s_numScopes.store(n + 1, std::memory_order_release);
+	return n;
+}
+
+static void countAlloc(size_t size)
+{
+	ScopeEntry& scope = s_scopes[t_scope];
+	scope.numAllocs.fetch_add(1, std::memory_order_relaxed);
+	scope.numBytes.fetch_add(size, std::memory_order_relaxed);
+	if (t_strict) {
+		t_strict = false; // so reporting can't recurse
+		fprintf(stderr, "allocation of %zu bytes in the scope \"%s\" in strict mode\n", size, scope.name);
+		assert(false);
+		t_strict = true;
+	}
+}
+
+static void countFree()
+{
+	s_scopes[t_scope].numFrees.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void* trackedAlloc(size_t size)
+{
+	countAlloc(size);
+	return malloc(size ? size : 1);
+}
+
+static void trackedFree(void* ptr)
+{
+	if (!ptr)
+		return;
+	countFree();
+	free(ptr);
+}
+
+AllocScope::AllocScope(const char* name)
+	: _prevScope(t_scope)
+{
+	t_scope = findOrAddScope(name);
+}
+
+AllocScope::~AllocScope()
+{
+	t_scope = _prevScope;
+}
+
+void allocTrackerEndFrame()
+{
+	std::lock_guard<std::mutex> lock(s_framesMutex);
+	const int n = s_numScopes.load(std::memory_order_acquire);
+	for (int i = 0; i < n; i++) {
+		ScopeEntry& scope = s_scopes[i];
+		scope.frame.numAllocs = scope.numAllocs.exchange(0, std::memory_order_relaxed);
+		scope.frame.numFrees = scope.numFrees.exchange(0, std::memory_order_relaxed);
+		scope.frame.numBytes = scope.numBytes.exchange(0, std::memory_order_relaxed);
+		scope.total.numAllocs += scope.frame.numAllocs;
+		scope.total.numFrees += scope.frame.numFrees;
+		scope.total.numBytes += scope.frame.numBytes;
+	}
+}
+
+AllocCounts getFrameAllocCounts()
+{
+	std::lock_guard<std::mutex> lock(s_framesMutex);
+	AllocCounts counts = {};
+	const int n = s_numScopes.load(std::memory_order_acquire);
+	for (int i = 0; i < n; i++) {
+		counts.numAllocs += s_scopes[i].frame.numAllocs;
+		counts.numFrees += s_scopes[i].frame.numFrees;
+		counts.numBytes += s_scopes[i].frame.numBytes;
+	}
+	return counts;
+}
+
+int getAllocScopeStats(AllocScopeStats* out, int maxScopes)
+{
+	AllocScopeStats all[MAX_ALLOC_SCOPES];
+	int n;
+	{
+		std::lock_guard<std::mutex> lock(s_framesMutex);
+		n = s_numScopes.load(std::memory_order_acquire);
+		for (int i = 0; i < n; i++)
+			all[i] = { s_scopes[i].name, s_scopes[i].frame, s_scopes[i].total };
+	}
+	std::sort(all, all + n, [](const AllocScopeStats& a, const AllocScopeStats& b) {
+		if (a.frame.numBytes != b.frame.numBytes)
+			return a.frame.numBytes > b.frame.numBytes;
+		return a.total.numBytes > b.total.numBytes;
+	});
+	n = std::min(n, maxScopes);
+	std::copy(all, all + n, out);
+	return n;
+}
+
+void setAllocStrictMode(bool strict)
+{
+	t_strict = strict;
+}
+
+void* allocTrackerImGuiAlloc(size_t size, void* /*userData*/)
+{
+	return trackedAlloc(size);
+}
+
+void allocTrackerImGuiFree(void* ptr, void* /*userData*/)
+{
+	trackedFree(ptr);
+}
+
+// ---------------------------------------------------------------------------------------------
+void* operator new(size_t size)
+{
+	if (void* p = trackedAlloc(size))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return trackedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return trackedAlloc(size);
+}
+
+void operator delete(void* ptr) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { trackedFree(ptr); }
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+
+// Counts the heap allocations made through the global operator new and through imgui (see
+// allocTrackerImGuiAlloc). The over-aligned operator new overloads are not replaced, nothing here uses them.
+// An allocation is attributed to the innermost AllocScope of the thread that makes it, or to the "other"
+// scope when there is none. We don't track the size of the blocks, frees are only counted
+
+struct AllocCounts {
+	size_t numAllocs;
+	size_t numFrees;
+	size_t numBytes; // allocated
+};
+
+struct AllocScopeStats {
+	const char* name;
+	AllocCounts frame; // last complete frame
+	AllocCounts total;
+};
+
+constexpr int MAX_ALLOC_SCOPES = 64;
+
+class AllocScope
+{
+public:
+	// scopes are identified by the address of the name, so it should be a string literal
+	explicit AllocScope(const char* name);
+	~AllocScope();
+	AllocScope(const AllocScope&) = delete;
+	AllocScope& operator=(const AllocScope&) = delete;
+
+private:
+	int _prevScope;
+};
+
+// closes the per frame counts of all the scopes, call it once per frame
+void allocTrackerEndFrame();
+AllocCounts getFrameAllocCounts(); // sum of all the scopes in the last complete frame
+// fills "out" with the scopes sorted by the bytes they allocated in the last frame, returns how many
+int getAllocScopeStats(AllocScopeStats* out, int maxScopes);
+
+// while enabled, any tracked allocation made by the calling thread is reported and asserts
+// we enable it after the warm-up frames to keep the render loop allocation free
+void setAllocStrictMode(bool strict);
+
+// for ImGui::SetAllocatorFunctions()
+void* allocTrackerImGuiAlloc(size_t size, void* userData);
+void allocTrackerImGuiFree(void* ptr, void* userData);
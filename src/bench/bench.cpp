@@ -0,0 +1,127 @@
+#include "bench.hpp"
+
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+namespace bench
+{
+
+double getTime()
+{
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+bool Runner::isFiltered(const char* group, const char* name)const
+{
+	if(!_options.filter)
+		return false;
+	const std::string fullName = std::string(group) + "/" + name;
+	return strstr(fullName.c_str(), _options.filter) == nullptr;
+}
+
+size_t Runner::calibrate(void (*call)(void*), void* ctx)const
+{
+	// double the number of ops until one sample takes long enough to be measured reliably
+	size_t n = 1;
+	for(;;) {
+		const double t0 = getTime();
+		for(size_t i = 0; i < n; i++)
+			call(ctx);
+		const double t = getTime() - t0;
+		if(t >= _options.minSampleTime || n >= (size_t(1) << 30))
+			return n;
+		n = t > 0 ? std::max(2 * n, size_t(1.2 * n * _options.minSampleTime / t)) : 2 * n;
+	}
+}
+
+static double percentile(const std::vector<double>& sorted, double p)
+{
+	const size_t i = size_t(p * (sorted.size() - 1) + 0.5);
+	return sorted[std::min(i, sorted.size() - 1)];
+}
+
+void Runner::measure(const char* group, const char* name, size_t itemsPerOp, void (*call)(void*), void* ctx)
+{
+	fprintf(stderr, "%s/%s... ", group, name);
+	fflush(stderr);
+
+	Result r;
+	r.name = name;
+	r.group = group;
+	r.itemsPerOp = itemsPerOp;
+	r.opsPerSample = calibrate(call, ctx); // also works as warm-up
+	r.nsPerOp.reserve(_options.numSamples);
+	for(int s = 0; s < _options.numSamples; s++) {
+		const double t0 = getTime();
+		for(size_t i = 0; i < r.opsPerSample; i++)
+			call(ctx);
+		const double t = getTime() - t0;
+		r.nsPerOp.push_back(1e9 * t / r.opsPerSample);
+	}
+
+	std::sort(r.nsPerOp.begin(), r.nsPerOp.end());
+	double sum = 0;
+	for(double x : r.nsPerOp)
+		sum += x;
+	r.mean = sum / r.nsPerOp.size();
+	r.min = r.nsPerOp.front();
+	r.max = r.nsPerOp.back();
+	r.p50 = percentile(r.nsPerOp, 0.50);
+	r.p95 = percentile(r.nsPerOp, 0.95);
+	r.p99 = percentile(r.nsPerOp, 0.99);
+
+	fprintf(stderr, "%.1f ns/op, %.3g items/s\n", r.p50, r.itemsPerSec());
+	_results.push_back(std::move(r));
+}
+
+void Runner::skip(const char* group, const char* name, const char* reason)
+{
+	if(isFiltered(group, name))
+		return;
+	fprintf(stderr, "%s/%s skipped: %s\n", group, name, reason);
+	_skipped.emplace_back(std::string(group) + "/" + name, reason);
+}
+
+void Runner::counter(const char* group, const char* name, const char* counter, double value)
+{
+	for(Result& r : _results) {
+		if(r.group == group && r.name == name) {
+			fprintf(stderr, "  %s: %.4g\n", counter, value);
+			r.counters.emplace_back(counter, value);
+			return;
+		}
+	}
+}
+
+void Runner::writeJson(FILE* f)const
+{
+	fprintf(f, "{\n  \"benchmarks\": [");
+	for(size_t i = 0; i < _results.size(); i++) {
+		const Result& r = _results[i];
+		fprintf(f, "%s\n    {\n", i ? "," : "");
+		fprintf(f, "      \"name\": \"%s/%s\",\n", r.group.c_str(), r.name.c_str());
+		fprintf(f, "      \"group\": \"%s\",\n", r.group.c_str());
+		fprintf(f, "      \"samples\": %zu,\n", r.nsPerOp.size());
+		fprintf(f, "      \"ops_per_sample\": %zu,\n", r.opsPerSample);
+		fprintf(f, "      \"items_per_op\": %zu,\n", r.itemsPerOp);
+		fprintf(f, "      \"items_per_sec\": %.6g,\n", r.itemsPerSec());
+		fprintf(f, "      \"ns_per_op\": { \"min\": %.6g, \"mean\": %.6g, \"p50\": %.6g, \"p95\": %.6g, \"p99\": %.6g, \"max\": %.6g }",
+			r.min, r.mean, r.p50, r.p95, r.p99, r.max);
+		if(!r.counters.empty()) {
+			fprintf(f, ",\n      \"counters\": {");
+			for(size_t c = 0; c < r.counters.size(); c++)
+				fprintf(f, "%s \"%s\": %.6g", c ? "," : "", r.counters[c].first.c_str(), r.counters[c].second);
+			fprintf(f, " }");
+		}
+		fprintf(f, "\n");
+		fprintf(f, "    }");
+	}
+	fprintf(f, "\n  ],\n  \"skipped\": [");
+	for(size_t i = 0; i < _skipped.size(); i++)
+		fprintf(f, "%s\n    { \"name\": \"%s\", \"reason\": \"%s\" }", i ? "," : "", _skipped[i].first.c_str(), _skipped[i].second.c_str());
+	fprintf(f, "\n  ]\n}\n");
+}
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace bench
+{
+
+// keeps the compiler from optimizing away a value we only compute for benchmarking
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	const volatile char* p = (const volatile char*)&value;
+	(void)*p;
+#endif
+}
+
+struct Result {
+	std::string name;
+	std::string group;
+	size_t itemsPerOp; // e.g. number of triangles drawn in one call of the benchmark function
+	size_t opsPerSample;
+	std::vector<double> nsPerOp; // one entry per sample, sorted
+	double min, mean, p50, p95, p99, max; // ns per op
+	std::vector<std::pair<std::string, double>> counters; // other measurements, e.g. cache miss ratios
+	double itemsPerSec()const { return p50 > 0 ? 1e9 * itemsPerOp / p50 : 0; }
+};
+
+struct Options {
+	const char* filter = nullptr; // only run benchmarks whose name contains this
+	int numSamples = 30;
+	double minSampleTime = 0.005; // seconds, we repeat the op until a sample takes at least this
+};
+
+class Runner
+{
+public:
+	explicit Runner(const Options& options) : _options(options) {}
+
+	// op() is called many times, it must do the same work every time
+	template <typename F>
+	void run(const char* group, const char* name, size_t itemsPerOp, F&& op);
+
+	void skip(const char* group, const char* name, const char* reason);
+
+	// attaches a value to the result of a benchmark that already ran, nothing happens if it was filtered out
+	void counter(const char* group, const char* name, const char* counter, double value);
+
+	void writeJson(FILE* file)const;
+
+private:
+	bool isFiltered(const char* group, const char* name)const;
+	size_t calibrate(void (*call)(void*), void* ctx)const;
+	void measure(const char* group, const char* name, size_t itemsPerOp, void (*call)(void*), void* ctx);
+
+	Options _options;
+	std::vector<Result> _results;
+	std::vector<std::pair<std::string, std::string>> _skipped; // name, reason
+};
+
+double getTime();
+
+// ---------------------------------------------------------------------------------------------
+template <typename F>
+void Runner::run(const char* group, const char* name, size_t itemsPerOp, F&& op)
+{
+	if(isFiltered(group, name))
+		return;
+	auto call = [](void* ctx) { (*(std::remove_reference_t<F>*)ctx)(); };
+	measure(group, name, itemsPerOp, call, (void*)&op);
+}
+
+}
@@ -0,0 +1,67 @@
+#include "bench_groups.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include "state.hpp"
+
+void runDrawBenchmarks(bench::Runner& runner)
+{
+	constexpr size_t N = 1000;
+	const vec3 a = {0, 0, 0}, b = {1, 0, 0}, c = {0, 1, 0};
+
+	runner.run("draw", "drawPoint", N, [&] {
+		resetState();
+		for (size_t i = 0; i < N; i++)
+			drawPoint(a);
+	});
+	runner.run("draw", "drawLine", N, [&] {
+		resetState();
+		for (size_t i = 0; i < N; i++)
+			drawLine(a, b);
+	});
+	runner.run("draw", "drawTriangle", N, [&] {
+		resetState();
+		for (size_t i = 0; i < N; i++)
+			drawTriangle(a, b, c);
+	});
+	runner.run("draw", "drawTriangle_transparent", N, [&] {
+		resetState();
+		pushColor({1, 0, 0, 0.5f});
+		for (size_t i = 0; i < N; i++)
+			drawTriangle(a, b, c);
+		popColor();
+	});
+	runner.run("draw", "pushPopColor", N, [&] {
+		resetState();
+		for (size_t i = 0; i < N; i++) {
+			pushColor({1, 0, 0, 1});
+			popColor();
+		}
+	});
+
+	// the cost of the matrix stack and of transforming with a non-identity matrix
+	const mat4 m = glm::rotate(glm::translate(mat4(1), {1, 2, 3}), 0.3f, {0, 1, 0});
+	runner.run("matrix", "pushPopMtx", N, [&] {
+		resetState();
+		for (size_t i = 0; i < N; i++) {
+			pushMtx(m);
+			popMtx();
+		}
+	});
+	runner.run("matrix", "pushMtx_drawTriangle", N, [&] {
+		resetState();
+		for (size_t i = 0; i < N; i++) {
+			pushMtx(m);
+			drawTriangle(a, b, c);
+			popMtx();
+		}
+	});
+	runner.run("matrix", "nestedMtx8_drawTriangle", N, [&] {
+		resetState();
+		for (int d = 0; d < 8; d++)
+			pushMtx(m);
+		for (size_t i = 0; i < N; i++)
+			drawTriangle(a, b, c);
+		for (int d = 0; d < 8; d++)
+			popMtx();
+	});
+}
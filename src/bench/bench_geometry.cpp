@@ -0,0 +1,336 @@
+#include "bench_groups.hpp"
+
+#include <assert.h>
+#include <stdio.h>
+#include <algorithm>
+#include <glm/gtc/matrix_inverse.hpp>
+#include <imgui.h>
+#include "user_api.hpp"
+#include "state.hpp"
+#include "tl/span.hpp"
+#include "geom/icosphere.hpp"
+#include "geom/cylinder.hpp"
+#include "geom/parametric.hpp"
+#include "geom/normals.hpp"
+#include "geom/vertex_cache.hpp"
+#include "geom/vertex_fetch.hpp"
+#include "geom/overdraw.hpp"
+#include "geom/strips.hpp"
+#include "geom/simplify.hpp"
+#include "geom/weld.hpp"
+#include "geom/quantize.hpp"
+#include "geom/quad_strip.hpp"
+#include "geom/soa_mesh.hpp"
+
+// the passes that run when a retained mesh is created, each one on the output of the previous one, with the
+// cache, fetch and overdraw stats before and after. The ops include copying the indices
+template <typename V>
+static void runMeshOptimizationBenchmarks(bench::Runner& runner, const char* meshName, tl::CSpan<V> verts, tl::CSpan<u32> inds)
+{
+	const u32 numVerts = u32(verts.size());
+	const vec3* positions = &verts[0].pos;
+	std::vector<u32> in(inds.begin(), inds.end()), out(inds.size());
+	std::vector<u8> scratch(std::max({optimizeVertexCacheArenaBytes(numVerts, inds.size()), optimizeOverdrawArenaBytes(numVerts, inds.size()),
+		vertexFetchStatsArenaBytes(numVerts, sizeof(V)), overdrawStatsArenaBytes(), stripifyArenaBytes(numVerts, inds.size())}));
+	auto arena = [&] { return tl::Arena(scratch.data(), scratch.size()); };
+	auto acmr = [&](const std::vector<u32>& i) { tl::Arena a = arena(); return computeVertexCacheStats(a, {i.data(), i.size()}, numVerts).acmr; };
+	auto overdraw = [&](const std::vector<u32>& i) {
+		tl::Arena a = arena();
+		return computeOverdrawStats(a, positions, sizeof(V), numVerts, {i.data(), i.size()}).overdraw;
+	};
+	auto overfetch = [&](const std::vector<u32>& i, u32 n) { tl::Arena a = arena(); return computeVertexFetchStats(a, {i.data(), i.size()}, n, sizeof(V)).overfetch; };
+	char name[64];
+
+	snprintf(name, sizeof(name), "optimizeVertexCache_%s", meshName);
+	runner.run("geometry", name, inds.size() / 3, [&] {
+		out = in;
+		tl::Arena a = arena();
+		optimizeVertexCache(a, {out.data(), out.size()}, numVerts);
+	});
+	runner.counter("geometry", name, "acmr_before", acmr(in));
+	runner.counter("geometry", name, "acmr_after", acmr(out));
+	in = out;
+
+	snprintf(name, sizeof(name), "optimizeOverdraw_%s", meshName);
+	runner.run("geometry", name, inds.size() / 3, [&] {
+		out = in;
+		tl::Arena a = arena();
+		optimizeOverdraw(a, positions, sizeof(V), numVerts, {out.data(), out.size()});
+	});
+	runner.counter("geometry", name, "overdraw_before", overdraw(in));
+	runner.counter("geometry", name, "overdraw_after", overdraw(out));
+	runner.counter("geometry", name, "acmr_after", acmr(out));
+	in = out;
+
+	snprintf(name, sizeof(name), "optimizeVertexFetch_%s", meshName);
+	std::vector<u32> remap(numVerts);
+	u32 numUsed = 0;
+	runner.run("geometry", name, inds.size() / 3, [&] {
+		out = in;
+		numUsed = optimizeVertexFetch({out.data(), out.size()}, {remap.data(), remap.size()});
+	});
+	runner.counter("geometry", name, "overfetch_before", overfetch(in, numVerts));
+	runner.counter("geometry", name, "overfetch_after", overfetch(out, numUsed));
+	in = out;
+
+	// the index bytes as u32 triangles and as strips, in u16 when the vertices fit
+	snprintf(name, sizeof(name), "stripify_%s", meshName);
+	std::vector<u32> strip(stripifyMaxInds(inds.size()));
+	u32 numStripInds = 0;
+	runner.run("geometry", name, inds.size() / 3, [&] {
+		tl::Arena a = arena();
+		numStripInds = stripify(a, {in.data(), in.size()}, numUsed, {strip.data(), strip.size()});
+	});
+	const size_t indexSize = fitsU16Indices(numUsed) ? sizeof(u16) : sizeof(u32);
+	runner.counter("geometry", name, "index_bytes_before", double(in.size() * sizeof(u32)));
+	runner.counter("geometry", name, "index_bytes_after", double(std::min<size_t>(numStripInds, in.size()) * indexSize));
+	strip.resize(numStripInds);
+	out.resize(in.size());
+	out.resize(unstripify({strip.data(), strip.size()}, {out.data(), out.size()}));
+	runner.counter("geometry", name, "acmr_after", acmr(out));
+}
+
+void runGeometryBenchmarks(bench::Runner& runner)
+{
+	for (int subDivs : {3, 5, 7, 9}) {
+		std::vector<vec3> verts(icosphereNumVerts(subDivs));
+		std::vector<u32> inds(icosphereNumInds(subDivs));
+		for (bool normalize : {false, true}) {
+			char name[64];
+			snprintf(name, sizeof(name), "generateIcosphere_%d%s", subDivs, normalize ? "_normalized" : "");
+			runner.run("geometry", name, inds.size() / 3, [&] {
+				generateIcosphere({verts.data(), verts.size()}, {inds.data(), inds.size()}, subDivs, normalize);
+				bench::doNotOptimize(verts[0]);
+			});
+		}
+	}
+
+	for (u32 resolution : {64u, 4096u}) {
+		std::vector<Vert_pos_normal> verts(cylinderNumVerts(resolution));
+		std::vector<u32> inds(cylinderNumInds(resolution));
+		char name[64];
+		snprintf(name, sizeof(name), "generateCylinder_%u", resolution);
+		runner.run("geometry", name, inds.size() / 3, [&] {
+			generateCylinder({verts.data(), verts.size()}, {inds.data(), inds.size()}, 0.1f, 0, 0.2f, resolution);
+			bench::doNotOptimize(verts[0]);
+		});
+	}
+
+	for (u32 n : {100u, 1000u}) {
+		std::vector<Vert_pos_normal_tc> verts(gridNumVerts(n, n));
+		std::vector<u32> inds(gridNumInds(n, n));
+		char name[64];
+		snprintf(name, sizeof(name), "generateTorus_%ux%u", n, n);
+		runner.run("geometry", name, inds.size() / 3, [&] {
+			generateTorus({verts.data(), verts.size()}, {inds.data(), inds.size()}, n, n, 1, 0.3f);
+			bench::doNotOptimize(verts[0]);
+		});
+		// the same surface through the generic path, which calls sin/cos per vertex
+		snprintf(name, sizeof(name), "generateParametricSurface_torus_%ux%u", n, n);
+		runner.run("geometry", name, inds.size() / 3, [&] {
+			generateParametricSurface({verts.data(), verts.size()}, {inds.data(), inds.size()}, n, n, [](float u, float v) {
+				const float a = 2*PI * u, b = 2*PI * v;
+				const vec3 n = {glm::cos(a) * glm::cos(b), glm::sin(b), -glm::sin(a) * glm::cos(b)};
+				const vec3 c = {glm::cos(a), 0, -glm::sin(a)};
+				return SurfacePoint{c + 0.3f * n, n};
+			});
+			bench::doNotOptimize(verts[0]);
+		});
+	}
+
+	{
+		constexpr int N = 1000; // edges of the strip
+		std::vector<Vert_pos_tc> strip(2 * N);
+		for (int i = 0; i < N; i++) {
+			const float l = (i * 3.f) / N;
+			const float h = 0.3f * sinf(2 * l);
+			strip[2 * i + 0] = {{l, h, -1}, {float(i) / N, 0}};
+			strip[2 * i + 1] = {{l, h, +1}, {float(i) / N, 1}};
+		}
+		std::vector<Vert_pos_normal_tc> verts(quadStripNumVerts(strip.size()));
+		std::vector<u32> inds(quadStripNumInds(strip.size()));
+		runner.run("geometry", "MeshBuilder_addQuadStrip_1000", 2 * (N - 1), [&] {
+			MeshBuilder mb = {{verts.data(), verts.size()}, {inds.data(), inds.size()}};
+			mb.addQuadStrip({strip.data(), strip.size()});
+			bench::doNotOptimize(verts[0]);
+		});
+	}
+
+	{
+		// a tube along a 100k point trajectory
+		constexpr u32 SIDES = 8, N = 100000;
+		std::vector<vec2> profile(SIDES);
+		for (u32 i = 0; i < SIDES; i++)
+			profile[i] = 0.05f * vec2(cosf(2*PI * i / SIDES), sinf(2*PI * i / SIDES));
+		std::vector<vec3> path(N);
+		for (u32 i = 0; i < N; i++)
+			path[i] = {cosf(0.01f * i), 1e-4f * i, sinf(0.01f * i)};
+		std::vector<u8> memory(2 * tl::Arena::bytesFor<Vert_pos_normal_tc>(SIDES * 2 * N) + 2 * tl::Arena::bytesFor<u32>(SIDES * 6 * N));
+		runner.run("geometry", "MeshBuilder_addSweep_8x100k", SIDES * 2 * (N - 1), [&] {
+			tl::Arena arena(memory.data(), memory.size());
+			MeshBuilder mb;
+			mb.arena = &arena;
+			mb.addSweep({profile.data(), profile.size()}, true, {path.data(), path.size()});
+			bench::doNotOptimize(mb.verts[0]);
+		});
+	}
+
+	{
+		const int subDivs = 9;
+		std::vector<vec3> verts(icosphereNumVerts(subDivs));
+		std::vector<u32> inds(icosphereNumInds(subDivs));
+		generateIcosphere({verts.data(), verts.size()}, {inds.data(), inds.size()}, subDivs, true);
+		std::vector<vec3> normals(verts.size());
+		std::vector<u8> scratch(vertexNormalsArenaBytes(verts.size(), inds.size()));
+		for (NormalWeighting weighting : {NormalWeighting::Area, NormalWeighting::Angle}) {
+			char name[64];
+			snprintf(name, sizeof(name), "computeVertexNormals_icosphere%d_%s", subDivs, weighting == NormalWeighting::Area ? "area" : "angle");
+			runner.run("geometry", name, inds.size() / 3, [&] {
+				tl::Arena arena(scratch.data(), scratch.size());
+				computeVertexNormals(arena, verts.data(), sizeof(vec3), verts.size(), {inds.data(), inds.size()},
+					normals.data(), sizeof(vec3), weighting);
+				bench::doNotOptimize(normals[0]);
+			});
+		}
+
+		// the same kernel reading and writing the members of vertex structs in place, against the streams of a SoaMesh
+		std::vector<Vert_pos_normal> aosVerts(verts.size());
+		for (size_t i = 0; i < verts.size(); i++)
+			aosVerts[i].pos = verts[i];
+		SoaMesh<Attrib_pos, Attrib_normal> soaMesh;
+		soaMesh.assignFrom(CMeshSpans<Vert_pos_normal>{{aosVerts.data(), aosVerts.size()}, {inds.data(), inds.size()}});
+		runner.run("geometry", "computeVertexNormals_icosphere9_area_aos", inds.size() / 3, [&] {
+			tl::Arena arena(scratch.data(), scratch.size());
+			const tl::Span<Vert_pos_normal> span = {aosVerts.data(), aosVerts.size()};
+			computeVertexNormals(arena, attribView<Attrib_pos>(tl::CSpan<Vert_pos_normal>(span)), {inds.data(), inds.size()},
+				attribView<Attrib_normal>(span));
+			bench::doNotOptimize(aosVerts[0]);
+		});
+		runner.run("geometry", "computeVertexNormals_icosphere9_area_soa", inds.size() / 3, [&] {
+			tl::Arena arena(scratch.data(), scratch.size());
+			computeVertexNormals(arena, soaMesh.view<Attrib_pos>(), soaMesh.indSpan(), soaMesh.view<Attrib_normal>());
+			bench::doNotOptimize(soaMesh.stream<Attrib_normal>()[0]);
+		});
+	}
+
+	for (int subDivs : {3, 7}) {
+		std::vector<Vert_pos_normal> verts(icosphereNumVerts(subDivs));
+		std::vector<vec3> positions(verts.size());
+		std::vector<u32> inds(icosphereNumInds(subDivs));
+		generateIcosphere({positions.data(), positions.size()}, {inds.data(), inds.size()}, subDivs, true);
+		for (size_t i = 0; i < verts.size(); i++)
+			verts[i] = {positions[i], positions[i]};
+		char name[16];
+		snprintf(name, sizeof(name), "icosphere%d", subDivs);
+		runMeshOptimizationBenchmarks<Vert_pos_normal>(runner, name, {verts.data(), verts.size()}, {inds.data(), inds.size()});
+	}
+	{
+		// a coiled tube, it overlaps itself
+		constexpr u32 SIDES = 8, N = 10000;
+		vec2 profile[SIDES];
+		for (u32 i = 0; i < SIDES; i++)
+			profile[i] = 0.05f * vec2(cosf(2*PI * i / SIDES), sinf(2*PI * i / SIDES));
+		std::vector<vec3> path(N);
+		for (u32 i = 0; i < N; i++)
+			path[i] = {cosf(0.01f * i), 1e-4f * i, sinf(0.01f * i)};
+		std::vector<u8> memory(2 * tl::Arena::bytesFor<Vert_pos_normal_tc>(SIDES * 2 * N) + 2 * tl::Arena::bytesFor<u32>(SIDES * 6 * N));
+		tl::Arena arena(memory.data(), memory.size());
+		MeshBuilder mb;
+		mb.arena = &arena;
+		mb.addSweep(profile, true, {path.data(), path.size()});
+		runMeshOptimizationBenchmarks<Vert_pos_normal_tc>(runner, "tube", mb.mesh().verts, mb.mesh().inds);
+	}
+
+	{
+		// a LOD chain like the one of the retained meshes, every level simplifies the full mesh
+		const int subDivs = 7;
+		std::vector<vec3> verts(icosphereNumVerts(subDivs));
+		std::vector<u32> inds(icosphereNumInds(subDivs)), lod(inds.size());
+		generateIcosphere({verts.data(), verts.size()}, {inds.data(), inds.size()}, subDivs, true);
+		std::vector<u8> scratch(simplifyArenaBytes(verts.size(), inds.size()));
+		for (int percent : {50, 25, 12}) {
+			char name[64];
+			snprintf(name, sizeof(name), "simplifyMesh_icosphere%d_%d%%", subDivs, percent);
+			u32 numInds = 0;
+			float error = 0;
+			runner.run("geometry", name, inds.size() / 3, [&] {
+				tl::Arena arena(scratch.data(), scratch.size());
+				numInds = simplifyMesh(arena, verts.data(), sizeof(vec3), verts.size(), {inds.data(), inds.size()},
+					u32(inds.size() * percent / 300) * 3, {lod.data(), lod.size()}, &error);
+			});
+			runner.counter("geometry", name, "triangles", numInds / 3);
+			runner.counter("geometry", name, "error", error);
+		}
+	}
+
+	{
+		// a torus as a triangle soup of 10M vertices, every vertex of the grid is there 6 times
+		constexpr u32 N = 1291;
+		std::vector<Vert_pos_normal_tc> grid(gridNumVerts(N, N));
+		std::vector<u32> inds(gridNumInds(N, N));
+		generateTorus({grid.data(), grid.size()}, {inds.data(), inds.size()}, N, N, 1, 0.3f);
+		std::vector<Vert_pos_normal_tc> soup(inds.size());
+		for (size_t i = 0; i < inds.size(); i++)
+			soup[i] = grid[inds[i]];
+		const u32 numVerts = u32(soup.size());
+		std::vector<u32> remap(numVerts);
+		std::vector<u8> scratch(weldArenaBytes(numVerts));
+		u32 numWelded = 0;
+		runner.run("geometry", "weldPositions_torus_10M", numVerts, [&] {
+			tl::Arena arena(scratch.data(), scratch.size());
+			numWelded = weldPositions(arena, &soup[0].pos, sizeof(soup[0]), numVerts, 0, {remap.data(), remap.size()});
+		});
+		runner.counter("geometry", "weldPositions_torus_10M", "welded_vertices", numWelded);
+		// the seam of the texture coords is kept
+		runner.run("geometry", "weldVertices_torus_10M_attribs", numVerts, [&] {
+			tl::Arena arena(scratch.data(), scratch.size());
+			numWelded = weldVertices(arena, &soup[0].pos, sizeof(soup[0]), numVerts, 1e-6f, {remap.data(), remap.size()}, [&](u32 i, u32 j) {
+				return glm::all(glm::lessThanEqual(glm::abs(soup[i].normal - soup[j].normal), vec3(1e-4f))) &&
+					glm::all(glm::lessThanEqual(glm::abs(soup[i].tc - soup[j].tc), vec2(1e-4f)));
+			});
+		});
+		runner.counter("geometry", "weldVertices_torus_10M_attribs", "welded_vertices", numWelded);
+	}
+
+	{
+		// the positions of a 1M vertex torus from 12 to 8 bytes, with their errors
+		constexpr u32 N = 1000;
+		std::vector<Vert_pos_normal_tc> verts(gridNumVerts(N, N));
+		std::vector<u32> inds(gridNumInds(N, N));
+		generateTorus({verts.data(), verts.size()}, {inds.data(), inds.size()}, N, N, 1, 0.3f);
+		std::vector<QuantizedVert_pos> quantized(verts.size());
+		const u32 numVerts = u32(verts.size());
+		const PositionQuantization quantization = getPositionQuantization(&verts[0].pos, sizeof(verts[0]), numVerts);
+		QuantizationStats stats = {};
+		runner.run("geometry", "quantizePositions_torus1M", numVerts, [&] {
+			stats = quantizePositions(&verts[0].pos, sizeof(verts[0]), numVerts, quantization, quantized[0].pos, sizeof(quantized[0]));
+		});
+		runner.counter("geometry", "quantizePositions_torus1M", "bytes_before", numVerts * sizeof(vec3));
+		runner.counter("geometry", "quantizePositions_torus1M", "bytes_after", quantized.size() * sizeof(quantized[0]));
+		runner.counter("geometry", "quantizePositions_torus1M", "max_pos_error", stats.maxPosError);
+		runner.counter("geometry", "quantizePositions_torus1M", "rms_pos_error", stats.rmsPosError);
+	}
+
+	// macro: what the icosahedron example submits every frame
+	{
+		const int subDivs = 5;
+		const u32 numInds = icosphereNumInds(subDivs);
+		std::vector<vec3> verts(icosphereNumVerts(subDivs));
+		std::vector<u32> inds(numInds);
+		generateIcosphere({verts.data(), verts.size()}, {inds.data(), inds.size()}, subDivs);
+		runner.run("frame", "icosphere5_triangles", numInds / 3, [&] {
+			resetState();
+			for (u32 i = 0; i < numInds; i += 3)
+				drawTriangle(verts[inds[i]], verts[inds[i + 1]], verts[inds[i + 2]]);
+		});
+		runner.run("frame", "icosphere5_wireframe", numInds, [&] {
+			resetState();
+			for (u32 i = 0; i < numInds; i += 3) {
+				const vec3 p0 = verts[inds[i]], p1 = verts[inds[i + 1]], p2 = verts[inds[i + 2]];
+				drawLine(p0, p1);
+				drawLine(p1, p2);
+				drawLine(p2, p0);
+			}
+		});
+	}
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include "bench.hpp"
+
+void runDrawBenchmarks(bench::Runner& runner);
+void runUploadBenchmarks(bench::Runner& runner, bool hasGl);
+void runGeometryBenchmarks(bench::Runner& runner);
+void runSphereBenchmarks(bench::Runner& runner, bool hasGl);
@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glad/glad.h>
+#include "bench_groups.hpp"
+#include "headless.hpp"
+
+static void printUsage()
+{
+	printf(
+		"usage: giterate_bench [options]\n"
+		"  --filter S      only run the benchmarks whose name (group/name) contains S\n"
+		"  --samples N     samples per benchmark (default 30)\n"
+		"  --min-time MS   minimum duration of a sample in milliseconds (default 5)\n"
+		"  --out F         write the JSON results to F instead of stdout\n"
+		"  --no-gl         skip the benchmarks that need an OpenGL context\n");
+}
+
+int main(int argc, char** argv)
+{
+	bench::Options options;
+	const char* outPath = nullptr;
+	bool useGl = true;
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if (strcmp(arg, "--filter") == 0 && hasValue)
+			options.filter = argv[++i];
+		else if (strcmp(arg, "--samples") == 0 && hasValue)
+			options.numSamples = atoi(argv[++i]);
+		else if (strcmp(arg, "--min-time") == 0 && hasValue)
+			options.minSampleTime = 1e-3 * atof(argv[++i]);
+		else if (strcmp(arg, "--out") == 0 && hasValue)
+			outPath = argv[++i];
+		else if (strcmp(arg, "--no-gl") == 0)
+			useGl = false;
+		else {
+			printUsage();
+			return 1;
+		}
+	}
+	if (options.numSamples <= 0) {
+		printUsage();
+		return 1;
+	}
+
+	// we always run headless, the GL benchmarks are skipped if we can't get a context
+	bool hasGl = false;
+	if (useGl && createHeadlessContext(3, 3)) {
+		hasGl = gladLoadGLLoader(getHeadlessProcAddress) != 0;
+		if (hasGl)
+			fprintf(stderr, "renderer: %s\n", glGetString(GL_RENDERER));
+	}
+
+	bench::Runner runner(options);
+	runDrawBenchmarks(runner);
+	runUploadBenchmarks(runner, hasGl);
+	runGeometryBenchmarks(runner);
+	runSphereBenchmarks(runner, hasGl);
+
+	FILE* out = outPath ? fopen(outPath, "w") : stdout;
+	if (!out) {
+		fprintf(stderr, "Couldn't open %s\n", outPath);
+		return 2;
+	}
+	runner.writeJson(out);
+	if (out != stdout)
+		fclose(out);
+
+	if (hasGl)
+		destroyHeadlessContext();
+	return 0;
+}
@@ -0,0 +1,173 @@
+#include "bench_groups.hpp"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include "spheres.hpp"
+#include "geom/icosphere.hpp"
+
+// drawSpheres(), whose vertex shader makes the icosphere from gl_VertexID, against the same spheres instanced
+// from a retained icosphere in a vertex and an index buffer. Every sample draws about the same number of triangles
+// into an offscreen target, glFinish() makes sure we measure the drawing and not only queuing the commands
+
+static const char* RETAINED_VERT_SHADER_SRC =
+R"GLSL(
+#version 330 core
+uniform mat4 u_viewProj;
+
+layout(location = 0) in vec4 a_sphere;
+layout(location = 1) in vec4 a_color;
+layout(location = 2) in vec3 a_pos;
+
+out vec4 v_color;
+
+void main()
+{
+	gl_Position = u_viewProj * vec4(a_sphere.xyz + a_sphere.w * a_pos, 1.0);
+	v_color = a_color;
+}
+)GLSL";
+
+static const char* RETAINED_FRAG_SHADER_SRC =
+R"GLSL(
+#version 330 core
+layout(location = 0) out vec4 o_color;
+
+in vec4 v_color;
+
+void main()
+{
+	o_color = v_color;
+}
+)GLSL";
+
+static u32 createRetainedProgram()
+{
+	const char* srcs[] = { RETAINED_VERT_SHADER_SRC, RETAINED_FRAG_SHADER_SRC };
+	const GLenum types[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	const u32 prog = glCreateProgram();
+	for (int i = 0; i < 2; i++) {
+		const u32 shader = glCreateShader(types[i]);
+		glShaderSource(shader, 1, &srcs[i], nullptr);
+		glCompileShader(shader);
+		glAttachShader(prog, shader);
+		glDeleteShader(shader);
+	}
+	glLinkProgram(prog);
+	i32 ok;
+	glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+	assert(ok);
+	return prog;
+}
+
+void runSphereBenchmarks(bench::Runner& runner, bool hasGl)
+{
+	constexpr int MIN_SUBDIVS = 2, MAX_SUBDIVS = 6;
+	char names[2][MAX_SUBDIVS + 1][64];
+	for (int s = MIN_SUBDIVS; s <= MAX_SUBDIVS; s++) {
+		snprintf(names[0][s], sizeof(names[0][s]), "procedural_subDivs%d", s);
+		snprintf(names[1][s], sizeof(names[1][s]), "retained_subDivs%d", s);
+	}
+	if (!hasGl) {
+		for (int s = MIN_SUBDIVS; s <= MAX_SUBDIVS; s++) {
+			runner.skip("spheres", names[0][s], "no OpenGL context");
+			runner.skip("spheres", names[1][s], "no OpenGL context");
+		}
+		return;
+	}
+
+	constexpr int SIZE = 512;
+	u32 fbo, rbos[2];
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glGenRenderbuffers(2, rbos);
+	glBindRenderbuffer(GL_RENDERBUFFER, rbos[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, SIZE, SIZE);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rbos[0]);
+	glBindRenderbuffer(GL_RENDERBUFFER, rbos[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, SIZE, SIZE);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rbos[1]);
+	glViewport(0, 0, SIZE, SIZE);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LEQUAL);
+
+	initSphereRenderer();
+	const u32 retainedProg = createRetainedProgram();
+	const i32 viewProjLoc = glGetUniformLocation(retainedProg, "u_viewProj");
+	const mat4 viewProj = glm::perspective(0.8f, 1.f, 0.1f, 100.f) * glm::lookAt(vec3(0, 0, 12), vec3(0), vec3(0, 1, 0));
+
+	constexpr u32 TRIANGLES_PER_OP = 1 << 20;
+	std::vector<SphereDraw> draws;
+	for (int s = MIN_SUBDIVS; s <= MAX_SUBDIVS; s++) {
+		// the spheres of a level on a square grid, smaller the more there are
+		const u32 numTris = icosphereNumProceduralVerts(s) / 3;
+		const u32 numSpheres = glm::max(1u, TRIANGLES_PER_OP / numTris);
+		const u32 side = u32(ceilf(sqrtf(float(numSpheres))));
+		const float spacing = 8.f / side;
+		draws.resize(numSpheres);
+		for (u32 i = 0; i < numSpheres; i++) {
+			const vec3 center = { spacing * (i % side + 0.5f) - 4, spacing * (i / side + 0.5f) - 4, 0 };
+			draws[i] = { vec4(center, 0.4f * spacing), vec4(float(i % 7) / 7, 0.5f, 1, 1), s };
+		}
+		const size_t items = size_t(numSpheres) * numTris;
+
+		FrameStats stats = {};
+		runner.run("spheres", names[0][s], items, [&] {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			drawSpheres({draws.data(), draws.size()}, viewProj, false, 0, stats);
+			glFinish();
+		});
+		runner.counter("spheres", names[0][s], "vertex_bytes", 0);
+		runner.counter("spheres", names[0][s], "instance_bytes", double(numSpheres * 2 * sizeof(vec4)));
+
+		// the retained icosphere, with u16 indices: 6 subdivisions have 41K vertices
+		std::vector<vec3> verts(icosphereNumVerts(s));
+		std::vector<u32> inds(icosphereNumInds(s));
+		generateIcosphere({verts.data(), verts.size()}, {inds.data(), inds.size()}, s, true);
+		std::vector<u16> inds16(inds.begin(), inds.end());
+		std::vector<vec4> instances(2 * numSpheres);
+		for (u32 i = 0; i < numSpheres; i++) {
+			instances[2 * i] = draws[i].sphere;
+			instances[2 * i + 1] = draws[i].color;
+		}
+		u32 vao, buffers[3];
+		glGenVertexArrays(1, &vao);
+		glBindVertexArray(vao);
+		glGenBuffers(3, buffers);
+		glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+		glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(vec4), instances.data(), GL_STATIC_DRAW);
+		for (u32 a = 0; a < 2; a++) {
+			glEnableVertexAttribArray(a);
+			glVertexAttribPointer(a, 4, GL_FLOAT, GL_FALSE, 2 * sizeof(vec4), (void*)(a * sizeof(vec4)));
+			glVertexAttribDivisor(a, 1);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, buffers[1]);
+		glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(vec3), verts.data(), GL_STATIC_DRAW);
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), nullptr);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[2]);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, inds16.size() * sizeof(u16), inds16.data(), GL_STATIC_DRAW);
+
+		glUseProgram(retainedProg);
+		glUniformMatrix4fv(viewProjLoc, 1, GL_FALSE, &viewProj[0][0]);
+		runner.run("spheres", names[1][s], items, [&] {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			glDrawElementsInstanced(GL_TRIANGLES, GLsizei(inds16.size()), GL_UNSIGNED_SHORT, nullptr, GLsizei(numSpheres));
+			glFinish();
+		});
+		runner.counter("spheres", names[1][s], "vertex_bytes", double(verts.size() * sizeof(vec3) + inds16.size() * sizeof(u16)));
+		runner.counter("spheres", names[1][s], "instance_bytes", double(instances.size() * sizeof(vec4)));
+		glBindVertexArray(0);
+		glDeleteBuffers(3, buffers);
+		glDeleteVertexArrays(1, &vao);
+	}
+
+	glUseProgram(0);
+	glDeleteProgram(retainedProg);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteRenderbuffers(2, rbos);
+	glDeleteFramebuffers(1, &fbo);
+}
@@ -0,0 +1,74 @@
+#include "bench_groups.hpp"
+
+#include <string.h>
+#include <glad/glad.h>
+#include "state.hpp"
+
+// different ways of streaming the triangles of a frame to a GL buffer, endRender() uses glBufferData
+void runUploadBenchmarks(bench::Runner& runner, bool hasGl)
+{
+	const char* names[] = {
+		"bufferData_orphan",
+		"bufferSubData",
+		"mapBufferRange_invalidate",
+		"mapBufferRange_unsynchronizedRing",
+	};
+	if (!hasGl) {
+		for (const char* name : names)
+			runner.skip("upload", name, "no OpenGL context");
+		return;
+	}
+
+	constexpr size_t N = 100'000;
+	constexpr size_t SIZE = N * sizeof(Triangle);
+	std::vector<Triangle> tris(N);
+	for (size_t i = 0; i < N; i++) {
+		const float x = float(i % 1000);
+		const float y = float(i / 1000);
+		tris[i] = {
+			Point{{x, y, 0}, {1, 0, 0, 1}},
+			Point{{x + 1, y, 0}, {1, 0, 0, 1}},
+			Point{{x, y + 1, 0}, {1, 0, 0, 1}},
+		};
+	}
+
+	u32 vbo;
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+	// glFinish() makes sure we measure the transfer and not only queuing the command
+	runner.run("upload", names[0], N, [&] {
+		glBufferData(GL_ARRAY_BUFFER, SIZE, tris.data(), GL_STREAM_DRAW);
+		glFinish();
+	});
+
+	glBufferData(GL_ARRAY_BUFFER, SIZE, nullptr, GL_STREAM_DRAW);
+	runner.run("upload", names[1], N, [&] {
+		glBufferSubData(GL_ARRAY_BUFFER, 0, SIZE, tris.data());
+		glFinish();
+	});
+
+	runner.run("upload", names[2], N, [&] {
+		void* p = glMapBufferRange(GL_ARRAY_BUFFER, 0, SIZE, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		memcpy(p, tris.data(), SIZE);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glFinish();
+	});
+
+	// the buffer holds several frames, we only orphan it when we wrap around
+	constexpr size_t RING_FRAMES = 4;
+	glBufferData(GL_ARRAY_BUFFER, RING_FRAMES * SIZE, nullptr, GL_STREAM_DRAW);
+	size_t ringFrame = 0;
+	runner.run("upload", names[3], N, [&] {
+		GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+		if (ringFrame == 0)
+			access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;
+		void* p = glMapBufferRange(GL_ARRAY_BUFFER, ringFrame * SIZE, SIZE, access);
+		memcpy(p, tris.data(), SIZE);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		ringFrame = (ringFrame + 1) % RING_FRAMES;
+		glFinish();
+	});
+
+	glDeleteBuffers(1, &vbo);
+}
@@ -0,0 +1,93 @@
+#include "camera_path.hpp"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+bool CameraPath::load(const char* path)
+{
+	FILE* file = fopen(path, "r");
+	if (!file)
+		return false;
+	keys.clear();
+	char line[256];
+	bool ok = true;
+	while (fgets(line, sizeof(line), file)) {
+		const char* p = line + strspn(line, " \t");
+		if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0')
+			continue;
+		CameraKey key;
+		if (sscanf(p, "%f %f %f %f %f %f", &key.t, &key.pos.x, &key.pos.y, &key.pos.z, &key.heading, &key.pitch) != 6 ||
+			(!keys.empty() && key.t < keys.back().t))
+		{
+			ok = false;
+			break;
+		}
+		keys.push_back(key);
+	}
+	fclose(file);
+	return ok && !keys.empty();
+}
+
+bool CameraPath::save(const char* path)const
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+		return false;
+	fprintf(file, "# t x y z heading pitch\n");
+	for (const CameraKey& key : keys)
+		fprintf(file, "%.4f %.6f %.6f %.6f %.6f %.6f\n", key.t, key.pos.x, key.pos.y, key.pos.z, key.heading, key.pitch);
+	fclose(file);
+	return true;
+}
+
+static vec3 catmullRom(vec3 p0, vec3 p1, vec3 p2, vec3 p3, float t)
+{
+	const float t2 = t * t;
+	const float t3 = t2 * t;
+	return 0.5f * ((2.f * p1) + (p2 - p0) * t +
+		(2.f * p0 - 5.f * p1 + 4.f * p2 - p3) * t2 +
+		(3.f * p1 - p0 - 3.f * p2 + p3) * t3);
+}
+
+CameraKey CameraPath::sample(float t)const
+{
+	assert(!keys.empty());
+	const size_t n = keys.size();
+	if (n == 1 || t <= keys[0].t)
+		return keys[0];
+	if (t >= keys[n - 1].t)
+		return keys[n - 1];
+
+	size_t i = 0; // keys[i].t <= t < keys[i+1].t
+	while (keys[i + 1].t <= t)
+		i++;
+	const CameraKey& k1 = keys[i];
+	const CameraKey& k2 = keys[i + 1];
+	const CameraKey& k0 = keys[i > 0 ? i - 1 : i];
+	const CameraKey& k3 = keys[i + 2 < n ? i + 2 : i + 1];
+	const float u = (t - k1.t) / (k2.t - k1.t);
+
+	float dHeading = k2.heading - k1.heading;
+	while (dHeading > PI)
+		dHeading -= 2*PI;
+	while (dHeading < -PI)
+		dHeading += 2*PI;
+
+	CameraKey key;
+	key.t = t;
+	key.pos = catmullRom(k0.pos, k1.pos, k2.pos, k3.pos, u);
+	key.heading = k1.heading + u * dHeading;
+	key.pitch = k1.pitch + u * (k2.pitch - k1.pitch);
+	return key;
+}
+
+void CameraPathRecorder::feed(float dt, vec3 pos, float heading, float pitch)
+{
+	if (!path.keys.empty()) {
+		time += dt;
+		if (time - path.keys.back().t < minInterval)
+			return;
+	}
+	path.keys.push_back({ time, pos, heading, pitch });
+}
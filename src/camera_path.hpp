@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+#include "user_api.hpp"
+
+// Keyframed camera path for reproducible runs. The text format has one key per line:
+//   t x y z heading pitch
+// where t is in seconds (increasing) and the angles in radians, like in FpsCamera.
+// Empty lines and lines starting with '#' are ignored
+
+struct CameraKey {
+	float t;
+	vec3 pos;
+	float heading, pitch;
+};
+
+struct CameraPath {
+	std::vector<CameraKey> keys;
+
+	bool load(const char* path);
+	bool save(const char* path)const;
+
+	float duration()const { return keys.empty() ? 0 : keys.back().t; }
+	// the position is interpolated with a Catmull-Rom spline, the angles linearly (the heading the short way)
+	// t is clamped to the range of the keys
+	CameraKey sample(float t)const;
+};
+
+// records the live camera into a CameraPath, at most one key every minInterval seconds
+struct CameraPathRecorder {
+	CameraPath path;
+	float minInterval = 0.1f;
+	float time = 0;
+
+	void reset() { path.keys.clear(); time = 0; }
+	void feed(float dt, vec3 pos, float heading, float pitch);
+};
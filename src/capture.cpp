@@ -0,0 +1,183 @@
+#include "capture.hpp"
+
+#include <string.h>
+
+template <typename T>
+static size_t spanBytes(tl::CSpan<T> s) { return s.size() * sizeof(T); }
+
+static u8* writeBytes(u8* p, const void* data, size_t size)
+{
+	if (size)
+		memcpy(p, data, size);
+	return p + size;
+}
+
+bool CaptureWriter::open(const char* path)
+{
+	close();
+	_file = fopen(path, "wb");
+	if (!_file)
+		return false;
+
+	CaptureFileHeader header;
+	memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+	header.version = CAPTURE_VERSION;
+	header.sizeofPoint = sizeof(Point);
+	header.sizeofLine = sizeof(Line);
+	header.sizeofTriangle = sizeof(Triangle);
+	fwrite(&header, sizeof(header), 1, _file);
+
+	_quit = false;
+	_numFrames = 0;
+	_numBytes = sizeof(header);
+	_numStalls = 0;
+	_thread = std::thread([this] { threadLoop(); });
+	return true;
+}
+
+void CaptureWriter::close()
+{
+	if (!_file)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_quit = true;
+	}
+	_cv.notify_all();
+	_thread.join();
+	fclose(_file);
+	_file = nullptr;
+}
+
+void CaptureWriter::writeFrame(const DrawLists& lists, const mat4& viewMtx, const mat4& projMtx, float dt)
+{
+	assert(_file);
+	size_t slot;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		if (_numQueued == MAX_QUEUED_FRAMES) {
+			_numStalls++;
+			_cv.wait(lock, [&] { return _numQueued < MAX_QUEUED_FRAMES; });
+		}
+		slot = (_queueHead + _numQueued) % MAX_QUEUED_FRAMES;
+	}
+
+	// the slot isn't visible to the writer thread until we increment _numQueued
+	CaptureFrameHeader header;
+	header.numPoints = u32(lists.points.size());
+	header.numLines = u32(lists.lines.size());
+	header.numTriangles = u32(lists.triangles.size());
+	header.numTransparentTriangles = u32(lists.transparentTriangles.size());
+	header.viewMtx = viewMtx;
+	header.projMtx = projMtx;
+	header.dt = dt;
+
+	std::vector<u8>& buffer = _buffers[slot];
+	buffer.resize(sizeof(header) + spanBytes(lists.points) + spanBytes(lists.lines) +
+		spanBytes(lists.triangles) + spanBytes(lists.transparentTriangles));
+	u8* p = buffer.data();
+	p = writeBytes(p, &header, sizeof(header));
+	p = writeBytes(p, lists.points.begin(), spanBytes(lists.points));
+	p = writeBytes(p, lists.lines.begin(), spanBytes(lists.lines));
+	p = writeBytes(p, lists.triangles.begin(), spanBytes(lists.triangles));
+	p = writeBytes(p, lists.transparentTriangles.begin(), spanBytes(lists.transparentTriangles));
+	assert(p == buffer.data() + buffer.size());
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_numQueued++;
+		_numFrames++;
+		_numBytes += buffer.size();
+	}
+	_cv.notify_all();
+}
+
+void CaptureWriter::threadLoop()
+{
+	for (;;) {
+		std::vector<u8>* buffer;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_cv.wait(lock, [&] { return _numQueued > 0 || _quit; });
+			if (_numQueued == 0)
+				return; // _quit and nothing left to write
+			buffer = &_buffers[_queueHead];
+		}
+
+		fwrite(buffer->data(), 1, buffer->size(), _file);
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_queueHead = (_queueHead + 1) % MAX_QUEUED_FRAMES;
+			_numQueued--;
+		}
+		_cv.notify_all();
+	}
+}
+
+// ---------------------------------------------------------------------------------------------
+bool CaptureReader::open(const char* path)
+{
+	close();
+	if (!_file.open(path))
+		return false;
+
+	const u8* data = _file.data();
+	const size_t size = _file.size();
+	CaptureFileHeader header;
+	if (size < sizeof(header))
+		return false;
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, CAPTURE_MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != CAPTURE_VERSION ||
+		header.sizeofPoint != sizeof(Point) ||
+		header.sizeofLine != sizeof(Line) ||
+		header.sizeofTriangle != sizeof(Triangle))
+	{
+		close();
+		return false;
+	}
+
+	// a capture that was interrupted can end with an incomplete frame, we just ignore it
+	size_t offset = sizeof(header);
+	while (offset + sizeof(CaptureFrameHeader) <= size) {
+		CaptureFrameHeader frame;
+		memcpy(&frame, data + offset, sizeof(frame));
+		const size_t frameSize = sizeof(frame) +
+			size_t(frame.numPoints) * sizeof(Point) +
+			size_t(frame.numLines) * sizeof(Line) +
+			size_t(frame.numTriangles + size_t(frame.numTransparentTriangles)) * sizeof(Triangle);
+		if (offset + frameSize > size)
+			break;
+		_frameOffsets.push_back(offset);
+		offset += frameSize;
+	}
+	return true;
+}
+
+void CaptureReader::close()
+{
+	_file.close();
+	_frameOffsets.clear();
+}
+
+CaptureFrame CaptureReader::getFrame(u32 i)const
+{
+	const u8* p = _file.data() + _frameOffsets[i];
+	CaptureFrameHeader header;
+	memcpy(&header, p, sizeof(header));
+	p += sizeof(header);
+
+	CaptureFrame frame;
+	frame.viewMtx = header.viewMtx;
+	frame.projMtx = header.projMtx;
+	frame.dt = header.dt;
+	frame.lists.points = { (const Point*)p, header.numPoints };
+	p += header.numPoints * sizeof(Point);
+	frame.lists.lines = { (const Line*)p, header.numLines };
+	p += header.numLines * sizeof(Line);
+	frame.lists.triangles = { (const Triangle*)p, header.numTriangles };
+	p += header.numTriangles * sizeof(Triangle);
+	frame.lists.transparentTriangles = { (const Triangle*)p, header.numTransparentTriangles };
+	return frame;
+}
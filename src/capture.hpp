@@ -0,0 +1,84 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include "state.hpp"
+#include "tl/mapped_file.hpp"
+
+// Capture files store, for every frame, the 4 primitive streams of State and the camera matrices
+// The layout of each frame is: CaptureFrameHeader, Point[], Line[], Triangle[], Triangle[] (transparent)
+// The arrays are stored exactly as they are in memory so a replay can point DrawLists into the mapped file
+
+constexpr char CAPTURE_MAGIC[8] = { 'G', 'I', 'T', 'C', 'A', 'P', 'T', 0 };
+constexpr u32 CAPTURE_VERSION = 1;
+
+struct CaptureFileHeader {
+	char magic[8];
+	u32 version;
+	u32 sizeofPoint, sizeofLine, sizeofTriangle; // to detect captures from builds with a different layout
+};
+
+struct CaptureFrameHeader {
+	u32 numPoints, numLines, numTriangles, numTransparentTriangles;
+	mat4 viewMtx, projMtx;
+	float dt;
+};
+
+struct CaptureFrame {
+	DrawLists lists;
+	mat4 viewMtx, projMtx;
+	float dt;
+};
+
+// Writes frames from a background thread, writeFrame() only copies the streams into a buffer
+class CaptureWriter
+{
+public:
+	~CaptureWriter() { close(); }
+
+	bool open(const char* path);
+	void close(); // blocks until all the queued frames are on disk
+	bool isOpen()const { return _file != nullptr; }
+
+	void writeFrame(const DrawLists& lists, const mat4& viewMtx, const mat4& projMtx, float dt);
+
+	u32 numFrames()const { return _numFrames; }
+	size_t numBytes()const { return _numBytes; }
+	u32 numStalls()const { return _numStalls; } // times writeFrame() had to wait for the disk
+
+private:
+	static constexpr size_t MAX_QUEUED_FRAMES = 8;
+
+	void threadLoop();
+
+	FILE* _file = nullptr;
+	std::thread _thread;
+	std::mutex _mutex;
+	std::condition_variable _cv;
+	// ring of frames waiting to be written, the buffers are reused so we don't allocate every frame
+	std::vector<u8> _buffers[MAX_QUEUED_FRAMES];
+	size_t _queueHead = 0;
+	size_t _numQueued = 0; // includes the frame being written
+	bool _quit = false;
+	u32 _numFrames = 0;
+	size_t _numBytes = 0;
+	u32 _numStalls = 0;
+};
+
+class CaptureReader
+{
+public:
+	bool open(const char* path);
+	void close();
+	bool isOpen()const { return _file.isOpen(); }
+
+	u32 numFrames()const { return u32(_frameOffsets.size()); }
+	CaptureFrame getFrame(u32 i)const;
+
+private:
+	tl::MappedFile _file;
+	std::vector<size_t> _frameOffsets;
+};
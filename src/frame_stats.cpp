@@ -0,0 +1,91 @@
+#include "frame_stats.hpp"
+
+#include <stdio.h>
+#include <algorithm>
+
+static float percentile(const float* sorted, size_t n, float p)
+{
+	const size_t i = size_t(p * (n - 1) + 0.5f);
+	return sorted[std::min(i, n - 1)];
+}
+
+FrameTimeStats computeFrameTimeStats(float* times, size_t numTimes)
+{
+	FrameTimeStats stats = {};
+	stats.numFrames = numTimes;
+	if (numTimes == 0)
+		return stats;
+
+	std::sort(times, times + numTimes);
+	double sum = 0;
+	for (size_t i = 0; i < numTimes; i++)
+		sum += times[i];
+	stats.min = times[0];
+	stats.max = times[numTimes - 1];
+	stats.avg = float(sum / numTimes);
+	stats.p50 = percentile(times, numTimes, 0.50f);
+	stats.p95 = percentile(times, numTimes, 0.95f);
+	stats.p99 = percentile(times, numTimes, 0.99f);
+	return stats;
+}
+
+void printFrameTimeStats(const FrameTimeStats& stats)
+{
+	printf("frames: %zu\n", stats.numFrames);
+	printf("fps(avg): %.1f\n", stats.avg > 0 ? 1 / stats.avg : 0.f);
+	printf("frame time (ms): min %.3f | avg %.3f | p50 %.3f | p95 %.3f | p99 %.3f | max %.3f\n",
+		1e3f * stats.min, 1e3f * stats.avg,
+		1e3f * stats.p50, 1e3f * stats.p95, 1e3f * stats.p99,
+		1e3f * stats.max);
+}
+
+void writeFrameTimeStatsJson(FILE* file, const FrameTimeStats& stats)
+{
+	fprintf(file, "{ \"frames\": %zu, \"min\": %.4f, \"avg\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }",
+		stats.numFrames, 1e3f * stats.min, 1e3f * stats.avg,
+		1e3f * stats.p50, 1e3f * stats.p95, 1e3f * stats.p99, 1e3f * stats.max);
+}
+
+void writeFrameStatsCsvHeader(FILE* file)
+{
+	fprintf(file, "frame,frame_ms,points,lines,triangles,transparent_triangles,"
+		"point_bytes,line_bytes,triangle_bytes,transparent_triangle_bytes,image_bytes,"
+		"draw_calls,gl_calls,user_draws_ms,end_render_ms,gui_ms,state_size,state_capacity,allocs,alloc_bytes,mesh_draws,mesh_triangles,meshlets,culled_meshlets,sphere_draws,sphere_triangles\n");
+}
+
+void writeFrameStatsCsvRow(FILE* file, u32 frameInd, float frameTime, const FrameStats& stats)
+{
+	fprintf(file, "%u,%.4f,%u,%u,%u,%u,%zu,%zu,%zu,%zu,%zu,%u,%u,%.4f,%.4f,%.4f,%zu,%zu,%zu,%zu,%u,%u,%u,%u,%u,%u\n",
+		frameInd, 1e3f * frameTime,
+		stats.numPoints, stats.numLines, stats.numTriangles, stats.numTransparentTriangles,
+		stats.pointBytes, stats.lineBytes, stats.triangleBytes, stats.transparentTriangleBytes, stats.imageBytes,
+		stats.numDrawCalls, stats.numGlCalls,
+		1e3f * stats.userDrawsTime, 1e3f * stats.endRenderTime, 1e3f * stats.guiTime,
+		stats.stateSize, stats.stateCapacity, stats.numAllocs, stats.allocBytes,
+		stats.numMeshDraws, stats.numMeshTriangles, stats.numMeshlets, stats.numCulledMeshlets, stats.numSphereDraws, stats.numSphereTriangles);
+}
+
+void FrameTimeHistory::add(float t)
+{
+	times[next] = t;
+	next = (next + 1) % CAPACITY;
+	if (numTimes < CAPACITY)
+		numTimes++;
+}
+
+size_t FrameTimeHistory::copyTimes(float* out)const
+{
+	const size_t first = (next + CAPACITY - numTimes) % CAPACITY;
+	for (size_t i = 0; i < numTimes; i++)
+		out[i] = times[(first + i) % CAPACITY];
+	return numTimes;
+}
+
+void computeFrameTimeHistogram(const float* times, size_t numTimes, float maxTime, float* bins, int numBins)
+{
+	std::fill(bins, bins + numBins, 0.f);
+	for (size_t i = 0; i < numTimes; i++) {
+		const int b = int(times[i] / maxTime * numBins);
+		bins[std::min(std::max(b, 0), numBins - 1)] += 1;
+	}
+}
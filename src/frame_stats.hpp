@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdio.h>
+#include "user_api.hpp"
+
+// summary of a series of frame times, all values in seconds
+struct FrameTimeStats {
+	size_t numFrames;
+	float min, avg, max;
+	float p50, p95, p99;
+};
+
+// "times" gets sorted in place
+FrameTimeStats computeFrameTimeStats(float* times, size_t numTimes);
+void printFrameTimeStats(const FrameTimeStats& stats);
+// writes a JSON object with the values in milliseconds
+void writeFrameTimeStatsJson(FILE* file, const FrameTimeStats& stats);
+
+// the last frame times, for the live statistics in the gui
+struct FrameTimeHistory {
+	static constexpr size_t CAPACITY = 512;
+	float times[CAPACITY];
+	size_t numTimes = 0;
+	size_t next = 0;
+
+	void add(float t);
+	// copies the times from the oldest to the newest, returns how many
+	size_t copyTimes(float* out)const;
+};
+
+// one row per frame, the times are in milliseconds
+void writeFrameStatsCsvHeader(FILE* file);
+void writeFrameStatsCsvRow(FILE* file, u32 frameInd, float frameTime, const FrameStats& stats);
+
+// counts the times in numBins uniform buckets in [0, maxTime), bigger times go to the last bucket
+void computeFrameTimeHistogram(const float* times, size_t numTimes, float maxTime, float* bins, int numBins);
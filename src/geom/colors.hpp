@@ -0,0 +1,7 @@
+#pragma once
+
+#include "user_api.hpp"
+
+constexpr vec4 RED = { 1, 0, 0, 1 };
+constexpr vec4 GREEN = { 0, 1, 0, 1 };
+constexpr vec4 BLUE = { 0, 0, 1, 1 };
@@ -0,0 +1,70 @@
+#include "cylinder.hpp"
+#include "parametric.hpp"
+
+#include <assert.h>
+
+void generateCylinder(tl::Span<Vert_pos_normal> verts, tl::Span<u32> inds,
+	float radius, float minY, float maxY, u32 resolution)
+{
+	assert(resolution >= 3);
+	assert(verts.size() == 0 || verts.size() == cylinderNumVerts(resolution));
+	assert(inds.size() == 0 || inds.size() == cylinderNumInds(resolution));
+
+	if(verts.size())
+	{
+		// one pass, the circle comes from the same table as the revolution surfaces
+		const float* cosTable;
+		const float* sinTable;
+		geom_detail::getCircleTable(resolution, cosTable, sinTable);
+		for(u32 i = 0; i < resolution; i++) {
+			const vec3 normal = {sinTable[i], 0, cosTable[i]};
+			const vec3 bottom = {radius * normal.x, minY, radius * normal.z};
+			const vec3 top = {bottom.x, maxY, bottom.z};
+			verts[i] = {bottom, {0, -1, 0}};
+			verts[resolution + i] = {top, {0, +1, 0}};
+			verts[2*resolution + 2*i + 0] = {bottom, normal};
+			verts[2*resolution + 2*i + 1] = {top, normal};
+		}
+	}
+
+	if(inds.size())
+	{
+		// bottom cap
+		for(u32 i = 0; i < resolution-2; i++) {
+			inds[3*i + 0] = 0;
+			inds[3*i + 1] = i+2;
+			inds[3*i + 2] = i+1;
+		}
+		// top cap
+		u32 offset = 3 * (resolution-2);
+		for(u32 i = 0; i < resolution-2; i++) {
+			inds[offset + 3*i + 0] = resolution + 0;
+			inds[offset + 3*i + 1] = resolution + i+1;
+			inds[offset + 3*i + 2] = resolution + i+2;
+		}
+		// sides, they use their own vertices so they get the side normals
+		offset += offset;
+		for(u32 i = 0; i < resolution; i++) {
+			const u32 a0 = 2*resolution + 2*i;
+			const u32 a1 = 2*resolution + 2*((i+1) % resolution);
+			const u32 b0 = a0 + 1;
+			const u32 b1 = a1 + 1;
+			inds[offset + 6*i + 0] = a0;
+			inds[offset + 6*i + 1] = a1;
+			inds[offset + 6*i + 2] = b1;
+			inds[offset + 6*i + 3] = a0;
+			inds[offset + 6*i + 4] = b1;
+			inds[offset + 6*i + 5] = b0;
+		}
+	}
+}
+
+MeshSpans<Vert_pos_normal> generateCylinder(tl::Arena& arena,
+	float radius, float minY, float maxY, u32 resolution)
+{
+	MeshSpans<Vert_pos_normal> mesh;
+	mesh.verts = arena.alloc<Vert_pos_normal>(cylinderNumVerts(resolution));
+	mesh.inds = arena.alloc<u32>(cylinderNumInds(resolution));
+	generateCylinder(mesh.verts, mesh.inds, radius, minY, maxY, resolution);
+	return mesh;
+}
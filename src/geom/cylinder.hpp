@@ -0,0 +1,28 @@
+#pragma once
+
+#include "mesh.hpp"
+#include "tl/arena.hpp"
+
+// Closed cylinder around the Y axis, the caps and the sides have their own vertices so the normals are flat
+
+constexpr u32 cylinderNumVerts(u32 resolution)
+{
+	return 4 * resolution;
+}
+
+constexpr u32 cylinderNumInds(u32 resolution)
+{
+	return 2*3 * (resolution - 2) + resolution * 6;
+}
+
+// the spans must have the sizes given above, either can be empty to skip generating it
+void generateCylinder(tl::Span<Vert_pos_normal> verts, tl::Span<u32> inds,
+	float radius, float minY, float maxY, u32 resolution);
+MeshSpans<Vert_pos_normal> generateCylinder(tl::Arena& arena,
+	float radius, float minY, float maxY, u32 resolution);
+
+constexpr size_t cylinderArenaBytes(u32 resolution)
+{
+	return tl::Arena::bytesFor<Vert_pos_normal>(cylinderNumVerts(resolution)) +
+		tl::Arena::bytesFor<u32>(cylinderNumInds(resolution));
+}
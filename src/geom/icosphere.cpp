@@ -0,0 +1,340 @@
+#include "icosphere.hpp"
+
+#include <assert.h>
+#include <math.h>
+#include <utility>
+#include "tl/parallel.hpp"
+
+/*static mat2 rotY(float a)
+{
+	return mat2 {
+		glm::cos(a), -glm::sin(a),
+		glm::sin(a), glm::cos(a)
+	};
+}
+
+static void generateIcosahedronVerts(vec3 verts[12])
+{
+	using glm::sqrt;
+	const mat2 rot36 = rotY(0.2f * PI);
+
+	const float r = 1 / (2*sin(0.2f*PI));
+	const float h = sqrt(1 - r*r);
+	const float a = sqrt(r*r - 0.25f);
+	const float h2 = 0.5f * sqrt(1 - (r-a)*(r-a) - 0.25f);
+
+	verts[0] = vec3(0, h2+h, 0);
+	vec2 p(r, 0);
+	for(int i = 0; i < 5; i++) {
+		verts[1+i] = {p.y, h2, -p.x};
+		p = rot36 * p;
+		verts[6+i] = {p.y, -h2, -p.x};
+		p = rot36 * p;
+	}
+	verts[11] = -verts[0];
+
+	for(int i = 0; i < 12; i++)
+		verts[i] = glm::normalize(verts[i]);
+}*/
+static const vec3 icosahedronVerts[12] = {
+	{0.0000000000000000000000000, 1.0000000000000000000000000, 0.0000000000000000000000000},
+	{0.0000000000000000000000000, 0.4472136497497558593750000, -0.8944272398948669433593750},
+	{-0.8506507873535156250000000, 0.4472136497497558593750000, -0.2763932347297668457031250},
+	{-0.5257311463356018066406250, 0.4472136497497558593750000, 0.7236067652702331542968750},
+	{0.5257310271263122558593750, 0.4472136497497558593750000, 0.7236068248748779296875000},
+	{0.8506507873535156250000000, 0.4472136497497558593750000, -0.2763930857181549072265625},
+	{-0.5257310867309570312500000, -0.4472136497497558593750000, -0.7236068248748779296875000},
+	{-0.8506507873535156250000000, -0.4472136497497558593750000, 0.2763931453227996826171875},
+	{-0.0000000626720364493849047, -0.4472136497497558593750000, 0.8944271802902221679687500},
+	{0.8506507277488708496093750, -0.4472136497497558593750000, 0.2763932645320892333984375},
+	{0.5257312059402465820312500, -0.4472136497497558593750000, -0.7236067056655883789062500},
+	{-0.0000000000000000000000000, -1.0000000000000000000000000, -0.0000000000000000000000000},
+};
+
+static const u8 icosahedronFaces[20 * 3] = {
+	0, 1, 2,  0, 2, 3,  0, 3, 4,  0, 4, 5,  0, 5, 1,
+	1, 6, 2,  2, 6, 7,  2, 7, 3,  3, 7, 8,  3, 8, 4,  4, 8, 9,  4, 9, 5,  5, 9, 10,  5, 10, 1,  1, 10, 6,
+	6, 11, 7,  7, 11, 8,  8, 11, 9,  9, 11, 10,  10, 11, 6,
+};
+
+// The vertices are laid out in rows of constant "latitude" from the top vertex to the bottom one:
+// row 0 is the top vertex, rows [1, fnl) the top cap, [fnl, 2*fnl) the middle band, [2*fnl, 3*fnl) the
+// bottom cap and row 3*fnl the bottom vertex. Band b has the triangles between rows b and b+1.
+// The offsets of the rows and bands are closed form, so they can be filled independently
+
+static u32 rowVertOffset(int fnl, int r)
+{
+	const u32 n = fnl;
+	if(r == 0)
+		return 0;
+	if(r < fnl)
+		return 1 + 5 * u32(r-1) * r / 2;
+	const u32 topEnd = 1 + 5 * (n-1) * n / 2;
+	if(r < 2*fnl)
+		return topEnd + 5 * n * u32(r - fnl);
+	const u32 midEnd = topEnd + 5 * n * n;
+	const u32 l = r - 2*fnl;
+	return midEnd + 5 * (l * n - l * (l-1) / 2);
+}
+
+static u32 bandTriOffset(int fnl, int b)
+{
+	const u32 n = fnl;
+	if(b < fnl)
+		return 5 * u32(b) * b;
+	if(b < 2*fnl)
+		return 5 * n * n + 10 * n * u32(b - fnl);
+	const u32 l = b - 2*fnl;
+	return 15 * n * n + 5 * (2 * l * n - l * l);
+}
+
+static void writeVertexRow(vec3* verts, int fnl, int r, bool normalize)
+{
+	using glm::mix;
+	int vi = rowVertOffset(fnl, r);
+	auto addVert = [&](vec3 p) {
+		verts[vi++] = normalize ? glm::normalize(p) : p;
+	};
+
+	if(r == 0)
+		addVert(icosahedronVerts[0]);
+	else if(r < fnl) { // top cap
+		const int l = r;
+		const float vertPercent = float(l) / fnl;
+		for(int f = 0; f < 5; f++) {
+			const vec3 pLeft = mix(icosahedronVerts[0], icosahedronVerts[1+f], vertPercent);
+			const vec3 pRight = mix(icosahedronVerts[0], icosahedronVerts[1+(f+1)%5], vertPercent);
+			for(int x = 0; x < l; x++) {
+				const vec3 p = mix(pLeft, pRight, float(x) / l);
+				addVert(p);
+			}
+		}
+	}
+	else if(r < 2*fnl) { // middle
+		const int l = r - fnl;
+		const float vertPercent = float(l) / fnl;
+		for(int f = 0; f < 5; f++) {
+			const vec3 topLeft = icosahedronVerts[1+f];
+			const vec3 topRight = icosahedronVerts[1+(f+1)%5];
+			const vec3 botLeft = icosahedronVerts[6+f];
+			const vec3 botRight = icosahedronVerts[6+(f+1)%5];
+			const vec3 left = mix(topLeft, botLeft, vertPercent);
+			const vec3 mid = mix(topRight, botLeft, vertPercent);
+			const vec3 right = mix(topRight, botRight, vertPercent);
+			for(int x = 0; x < fnl-l; x++) {
+				const vec3 p = mix(left, mid, float(x) / (fnl-l));
+				addVert(p);
+			}
+			for(int x = 0; x < l; x++) {
+				const vec3 p = mix(mid, right, float(x) / l);
+				addVert(p);
+			}
+		}
+	}
+	else if(r < 3*fnl) { // bottom cap
+		const int l = r - 2*fnl;
+		const float vertPercent = float(l) / fnl;
+		for(int f = 0; f < 5; f++) {
+			const vec3 pLeft = mix(icosahedronVerts[6+f], icosahedronVerts[11], vertPercent);
+			const vec3 pRight = mix(icosahedronVerts[6+(f+1)%5], icosahedronVerts[11], vertPercent);
+			for(int x = 0; x < fnl-l; x++) {
+				const vec3 p = mix(pLeft, pRight, float(x) / (fnl-l));
+				addVert(p);
+			}
+		}
+	}
+	else
+		addVert(icosahedronVerts[11]);
+
+	assert(u32(vi) == rowVertOffset(fnl, r+1) || r == 3*fnl);
+}
+
+static void writeIndexBand(u32* inds, int fnl, int b, u32 numVerts)
+{
+	u32 i = 3 * bandTriOffset(fnl, b);
+	auto addTri = [&](u32 i0, u32 i1, u32 i2) {
+		inds[i++] = i0;
+		inds[i++] = i1;
+		inds[i++] = i2;
+	};
+
+	if(b == 0) { // top
+		for(int f = 0; f < 5; f++)
+			addTri(0, 1+f, 1+(f+1)%5);
+	}
+	else if(b < fnl) {
+		const int l = b;
+		const u32 rowOffset = rowVertOffset(fnl, l);
+		const int rowLen = l*5;
+		const int nextRowLen = (l+1)*5;
+		for(int f = 0; f < 5; f++) {
+			for(int x = 0; x < l; x++) {
+				const u32 topLeft = rowOffset + l*f + x;
+				const u32 topRight = rowOffset + (l*f + x + 1) % rowLen;
+				const u32 botLeft = rowOffset + rowLen + (l+1) * f + x;
+				addTri(
+					topLeft,
+					botLeft,
+					botLeft + 1);
+				addTri(
+					topLeft,
+					botLeft + 1,
+					topRight);
+			}
+			addTri(
+				rowOffset + (l*(f+1)) % rowLen, // review!
+				rowOffset + rowLen + (l+1) * f + l,
+				rowOffset + rowLen + ((l+1) * f + l + 1) % nextRowLen);
+		}
+	}
+	else if(b < 2*fnl) { // middle
+		const u32 rowOffset = rowVertOffset(fnl, b);
+		const int rowLen = 5 * fnl;
+		for(int x = 0; x < rowLen; x++) {
+			const u32 topLeft = rowOffset + x;
+			const u32 topRight = rowOffset + (x+1) % rowLen;
+			const u32 botLeft = rowOffset + rowLen + x;
+			const u32 botRight = rowOffset + rowLen + (x+1) % rowLen;
+			addTri(topLeft, botLeft, topRight);
+			addTri(topRight, botLeft, botRight);
+		}
+	}
+	else if(b < 3*fnl - 1) { // bottom
+		const int l = b - 2*fnl;
+		const u32 rowOffset = rowVertOffset(fnl, b);
+		const int faceLen = fnl - l;
+		const int rowLen = faceLen*5;
+		const int nextRowLen = (faceLen-1)*5;
+		for(int f = 0; f < 5; f++) {
+			for(int x = 0; x < fnl-l-1; x++) {
+				const u32 topLeft = rowOffset + faceLen*f + x;
+				const u32 topRight = rowOffset + faceLen*f + x + 1;
+				const u32 botLeft = rowOffset + rowLen + (faceLen-1) * f + x;
+				const u32 botRight = rowOffset + rowLen + ((faceLen-1) * f + x + 1) % nextRowLen;
+				addTri(topLeft, botLeft, topRight);
+				addTri(topRight, botLeft, botRight);
+			}
+			addTri(
+				rowOffset + faceLen*(f+1) - 1,
+				rowOffset + rowLen + ((faceLen-1) * (f+1)) % nextRowLen,
+				rowOffset + faceLen*(f+1) % rowLen);
+		}
+	}
+	else { // bottom vertex
+		for(int f = 0; f < 5; f++)
+			addTri(numVerts-6+f, numVerts-1, numVerts-6 + (f+1)%5);
+	}
+
+	assert(i == 3 * bandTriOffset(fnl, b+1));
+}
+
+void generateIcosphere(tl::Span<vec3> verts, tl::Span<u32> inds, int subDivs, bool normalize)
+{
+	assert(subDivs >= 0 && subDivs <= ICOSPHERE_MAX_SUBDIVS);
+	const int fnl = 1 << subDivs; // num levels per face
+	const u32 numVerts = icosphereNumVerts(subDivs);
+	assert(verts.size() == 0 || verts.size() == numVerts);
+	assert(inds.size() == 0 || inds.size() == icosphereNumInds(subDivs));
+
+	// the rows have 5*fnl elements at most, we want chunks of a few thousand vertices
+	const size_t rowsPerChunk = glm::max(1, 4096 / (5 * fnl));
+	const int numRows = 3*fnl + 1;
+	if(verts.size()) {
+		tl::parallelFor(0, numRows, rowsPerChunk, [&](size_t r) {
+			writeVertexRow(verts.begin(), fnl, int(r), normalize);
+		});
+	}
+	if(inds.size()) {
+		tl::parallelFor(0, numRows - 1, rowsPerChunk, [&](size_t b) {
+			writeIndexBand(inds.begin(), fnl, int(b), numVerts);
+		});
+	}
+}
+
+MeshSpans<vec3> generateIcosphere(tl::Arena& arena, int subDivs, bool normalize)
+{
+	MeshSpans<vec3> mesh;
+	mesh.verts = arena.alloc<vec3>(icosphereNumVerts(subDivs));
+	mesh.inds = arena.alloc<u32>(icosphereNumInds(subDivs));
+	generateIcosphere(mesh.verts, mesh.inds, subDivs, normalize);
+	return mesh;
+}
+
+// measured on the generated meshes up to 6 subdivisions, then 4 times smaller for each
+static const float s_icosphereErrors[ICOSPHERE_MAX_SUBDIVS + 1] = {
+	2.053e-1f, 6.583e-2f, 1.775e-2f, 4.529e-3f, 1.138e-3f, 2.849e-4f, 7.135e-5f,
+	1.784e-5f, 4.459e-6f, 1.115e-6f, 2.787e-7f, 6.967e-8f, 1.742e-8f, 4.354e-9f,
+};
+
+float icosphereMaxError(int subDivs)
+{
+	assert(subDivs >= 0 && subDivs <= ICOSPHERE_MAX_SUBDIVS);
+	return s_icosphereErrors[subDivs];
+}
+
+int selectIcosphereSubDivs(float projectedRadius, float maxPixelError, int maxSubDivs)
+{
+	assert(maxSubDivs >= 0 && maxSubDivs <= ICOSPHERE_MAX_SUBDIVS);
+	int subDivs = 0;
+	while(subDivs < maxSubDivs && s_icosphereErrors[subDivs] * projectedRadius > maxPixelError)
+		subDivs++;
+	return subDivs;
+}
+
+u32 getIcosphereProceduralRow(u32 l)
+{
+	u32 r = u32(sqrtf(float(l)));
+	if((r + 1) * (r + 1) <= l)
+		r++;
+	else if(r * r > l)
+		r--;
+	return r;
+}
+
+vec3 getIcosphereProceduralVertex(int subDivs, u32 vertexId)
+{
+	assert(subDivs >= 0 && subDivs <= ICOSPHERE_MAX_SUBDIVS);
+	const u32 n = 1u << subDivs;
+	const u32 tri = vertexId / 3, corner = vertexId % 3;
+	const u32 face = tri >> (2 * subDivs);
+	const u32 l = tri - (face << (2 * subDivs));
+	// the row r has 2r+1 triangles, alternating up (apex at the row above) and down
+	const u32 r = getIcosphereProceduralRow(l);
+	const u32 k = l - r * r, c = k / 2;
+	u32 row = r, col = c;
+	if(k % 2 == 0) {
+		row += corner != 0;
+		col += corner == 2;
+	}
+	else {
+		row += corner == 1;
+		col += corner != 0;
+	}
+	// the corners are added in the order of their index, so the two faces of an edge make the same sum even if
+	// the compiler fuses the multiplies and adds
+	u32 inds[3] = { icosahedronFaces[3 * face], icosahedronFaces[3 * face + 1], icosahedronFaces[3 * face + 2] };
+	float weights[3] = { float(n - row), float(row - col), float(col) };
+	for(int a = 0; a < 2; a++) {
+		for(int b = 0; b < 2 - a; b++) {
+			if(inds[b] > inds[b + 1]) {
+				std::swap(inds[b], inds[b + 1]);
+				std::swap(weights[b], weights[b + 1]);
+			}
+		}
+	}
+	const vec3 p =
+		weights[0] * icosahedronVerts[inds[0]] +
+		weights[1] * icosahedronVerts[inds[1]] +
+		weights[2] * icosahedronVerts[inds[2]];
+	return glm::normalize(p);
+}
+
+tl::CSpan<vec3> getIcosahedronVerts()
+{
+	return icosahedronVerts;
+}
+
+tl::CSpan<u8> getIcosahedronFaceInds()
+{
+	return icosahedronFaces;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "mesh.hpp"
+#include "tl/arena.hpp"
+
+// Icosahedron with each face subdivided in 4^subDivs triangles. The vertices stay on the faces of the
+// icosahedron unless "normalize" is set, then they are projected on the unit sphere
+// The generation is split in rows of vertices and bands of triangles that are filled in parallel
+
+constexpr int ICOSPHERE_MAX_SUBDIVS = 13; // the number of indices still fits in 32 bits
+
+constexpr u32 icosphereNumVerts(int subDivs)
+{
+	const u32 fnl = 1u << subDivs; // num levels per face
+	return
+		2 + // top and bot verts
+		2 * 5 * (fnl-1) * fnl / 2 + // top and bot caps
+		5 * (fnl+1) * fnl; // middle
+}
+
+constexpr u32 icosphereNumInds(int subDivs)
+{
+	return 3 * (20 * (1u << (2 * subDivs)));
+}
+
+// the spans must have the sizes given above, either can be empty to skip generating it
+void generateIcosphere(tl::Span<vec3> verts, tl::Span<u32> inds, int subDivs, bool normalize = false);
+MeshSpans<vec3> generateIcosphere(tl::Arena& arena, int subDivs, bool normalize = false);
+
+constexpr size_t icosphereArenaBytes(int subDivs)
+{
+	return tl::Arena::bytesFor<vec3>(icosphereNumVerts(subDivs)) + tl::Arena::bytesFor<u32>(icosphereNumInds(subDivs));
+}
+
+// Levels of detail for spheres: the distance between the flat faces of the normalized icosphere and the unit
+// sphere shrinks by about 4 with every subdivision, so the level that keeps it below an error in pixels is
+// chosen from the size of the sphere on screen
+float icosphereMaxError(int subDivs); // relative to the radius
+
+// the fewest subdivisions (up to maxSubDivs) whose error stays within maxPixelError pixels for a sphere of
+// projectedRadius pixels, that is radius * pixelsPerUnit / distance
+int selectIcosphereSubDivs(float projectedRadius, float maxPixelError, int maxSubDivs);
+
+// The triangles of generateIcosphere(normalize = true) without indices, so they can be generated from the vertex
+// id (e.g. gl_VertexID) without any buffer: the triangle t is in the face t / 4^subDivs of the icosahedron, then
+// in a row and a column of the subdivided face. Every point is the normalized sum of the corners of the face
+// with integer weights, so the vertices of an edge come out the same in the two faces that share it
+constexpr u32 icosphereNumProceduralVerts(int subDivs)
+{
+	return icosphereNumInds(subDivs);
+}
+
+vec3 getIcosphereProceduralVertex(int subDivs, u32 vertexId);
+
+// the row of the triangle l of a subdivided face, the one with r * r <= l < (r + 1) * (r + 1). It starts from
+// sqrt(float(l)) like the vertex shader and corrects it by one, which is exact while l fits the 24 bits of the
+// mantissa of a float: up to 12 subdivisions
+u32 getIcosphereProceduralRow(u32 l);
+
+// the icosahedron the icospheres are made from, the faces are counterclockwise seen from outside
+tl::CSpan<vec3> getIcosahedronVerts();
+tl::CSpan<u8> getIcosahedronFaceInds(); // 3 per face
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "user_api.hpp"
+#include "tl/span.hpp"
+
+// Common types of the mesh generators
+// Every generator has constexpr functions that return the exact number of vertices and indices it writes,
+// the caller provides the memory (spans, or a tl::Arena sized with tl::Arena::bytesFor), so the
+// generation itself never allocates
+
+struct Vert_pos_normal {
+	vec3 pos, normal;
+};
+
+struct Vert_pos_tc {
+	vec3 pos;
+	vec2 tc; // texture coord
+};
+
+struct Vert_pos_normal_tc {
+	vec3 pos;
+	vec3 normal;
+	vec2 tc;
+};
+
+template <typename V>
+struct MeshSpans {
+	tl::Span<V> verts;
+	tl::Span<u32> inds; // triangle list
+};
+
+template <typename V>
+struct CMeshSpans {
+	tl::CSpan<V> verts;
+	tl::CSpan<u32> inds;
+};
@@ -0,0 +1,219 @@
+#include "mesh_cache.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <filesystem>
+
+static const char MESH_FILE_MAGIC[8] = "GITMESH";
+constexpr u32 MESH_FILE_VERSION = 2;
+
+// the file is: header, key, padding to 16, vertices, padding to 4, indices
+struct MeshFileHeader {
+	char magic[8];
+	u32 version;
+	u32 vertSize, numVerts, numInds;
+	u32 keyLength;
+	u32 generatorVersion; // MESH_GENERATOR_VERSION
+};
+
+static size_t alignUp(size_t x, size_t a) { return (x + a - 1) / a * a; }
+
+static size_t fileVertsOffset(size_t keyLength) { return alignUp(sizeof(MeshFileHeader) + keyLength, 16); }
+
+static size_t indsOffset(size_t vertsOffset, u32 vertSize, u32 numVerts)
+{
+	return alignUp(vertsOffset + size_t(vertSize) * numVerts, 4);
+}
+
+static u64 hashKey(const char* key)
+{
+	u64 h = 0xcbf29ce484222325ull; // FNV-1a of the generator version and the key
+	auto add = [&](u8 byte) {
+		h ^= byte;
+		h *= 0x100000001b3ull;
+	};
+	for(u32 i = 0; i < 4; i++)
+		add(u8(MESH_GENERATOR_VERSION >> (8 * i)));
+	for(const char* c = key; *c; c++)
+		add(u8(*c));
+	return h;
+}
+
+MeshCache::MeshCache(size_t maxBytes)
+	: _maxBytes(maxBytes)
+{}
+
+void MeshCache::setMaxBytes(size_t maxBytes)
+{
+	_maxBytes = maxBytes;
+	evict(nullptr);
+}
+
+void MeshCache::setDiskDir(const char* dir)
+{
+	_diskDir = dir ? dir : "";
+	if(dir) {
+		std::error_code error;
+		std::filesystem::create_directories(dir, error);
+		if(error)
+			fprintf(stderr, "Couldn't create the mesh cache directory %s\n", dir);
+	}
+}
+
+void MeshCache::clear()
+{
+	_entries.clear();
+	_stats.numMeshes = 0;
+	_stats.numBytes = 0;
+}
+
+MeshCache::Entry* MeshCache::find(const char* key, u32 vertSize, u32 numVerts, u32 numInds)
+{
+	for(size_t i = 0; i < _entries.size(); i++) {
+		Entry& entry = *_entries[i];
+		if(entry.key != key)
+			continue;
+		if(entry.vertSize == vertSize && entry.numVerts == numVerts && entry.numInds == numInds)
+			return &entry;
+		// same key with a different layout: the mesh it was made for is stale, it's a miss and the new one replaces it
+		_stats.numBytes -= entry.numBytes;
+		_stats.numMeshes--;
+		_entries.erase(_entries.begin() + i);
+		return nullptr;
+	}
+	return nullptr;
+}
+
+std::string MeshCache::diskPath(const char* key)const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx.mesh", (unsigned long long)hashKey(key));
+	return _diskDir + name;
+}
+
+MeshCache::Entry* MeshCache::loadFromDisk(const char* key, u32 vertSize, u32 numVerts, u32 numInds)
+{
+	if(_diskDir.empty())
+		return nullptr;
+
+	auto entry = std::make_unique<Entry>();
+	if(!entry->file.open(diskPath(key).c_str()))
+		return nullptr;
+
+	const u8* data = entry->file.data();
+	const size_t size = entry->file.size();
+	MeshFileHeader header;
+	if(size < sizeof(header))
+		return nullptr;
+	memcpy(&header, data, sizeof(header));
+	const size_t keyLength = strlen(key);
+	const size_t vertsOffset = fileVertsOffset(keyLength);
+	const size_t indsOff = indsOffset(vertsOffset, vertSize, numVerts);
+	if(memcmp(header.magic, MESH_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != MESH_FILE_VERSION || header.generatorVersion != MESH_GENERATOR_VERSION ||
+		header.vertSize != vertSize || header.numVerts != numVerts || header.numInds != numInds ||
+		header.keyLength != keyLength ||
+		size != indsOff + size_t(numInds) * sizeof(u32) ||
+		memcmp(data + sizeof(header), key, keyLength) != 0) // a different key with the same hash
+	{
+		return nullptr;
+	}
+
+	entry->key = key;
+	entry->vertSize = vertSize;
+	entry->numVerts = numVerts;
+	entry->numInds = numInds;
+	entry->verts = data + vertsOffset;
+	entry->inds = (const u32*)(data + indsOff);
+	entry->numBytes = size;
+	_entries.push_back(std::move(entry));
+	_stats.numMeshes++;
+	_stats.numBytes += size;
+	return _entries.back().get();
+}
+
+MeshCache::Entry* MeshCache::add(const char* key, u32 vertSize, u32 numVerts, u32 numInds,
+	void (*generate)(void* ctx, u8* verts, u32* inds), void* ctx)
+{
+	auto entry = std::make_unique<Entry>();
+	entry->key = key;
+	entry->vertSize = vertSize;
+	entry->numVerts = numVerts;
+	entry->numInds = numInds;
+	const size_t indsOff = indsOffset(0, vertSize, numVerts);
+	entry->memory.resize(indsOff + size_t(numInds) * sizeof(u32));
+	u8* verts = entry->memory.data();
+	u32* inds = (u32*)(verts + indsOff);
+	generate(ctx, verts, inds);
+	entry->verts = verts;
+	entry->inds = inds;
+	entry->numBytes = entry->memory.size();
+
+	if(!_diskDir.empty())
+		saveToDisk(*entry);
+
+	_entries.push_back(std::move(entry));
+	_stats.numMeshes++;
+	_stats.numBytes += _entries.back()->numBytes;
+	return _entries.back().get();
+}
+
+void MeshCache::saveToDisk(const Entry& entry)
+{
+	// we write to a temporary file and rename it, so another run never maps a partial file
+	const std::string path = diskPath(entry.key.c_str());
+	const std::string tmpPath = path + ".tmp";
+	FILE* file = fopen(tmpPath.c_str(), "wb");
+	if(!file)
+		return;
+
+	MeshFileHeader header = {};
+	memcpy(header.magic, MESH_FILE_MAGIC, sizeof(header.magic));
+	header.version = MESH_FILE_VERSION;
+	header.generatorVersion = MESH_GENERATOR_VERSION;
+	header.vertSize = entry.vertSize;
+	header.numVerts = entry.numVerts;
+	header.numInds = entry.numInds;
+	header.keyLength = u32(entry.key.size());
+	const size_t vertsOffset = fileVertsOffset(entry.key.size());
+	const size_t vertsBytes = size_t(entry.vertSize) * entry.numVerts;
+	const size_t indsOff = indsOffset(vertsOffset, entry.vertSize, entry.numVerts);
+	const u8 zeros[16] = {};
+
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	ok = ok && fwrite(entry.key.data(), 1, entry.key.size(), file) == entry.key.size();
+	ok = ok && fwrite(zeros, 1, vertsOffset - sizeof(header) - entry.key.size(), file) == vertsOffset - sizeof(header) - entry.key.size();
+	ok = ok && fwrite(entry.verts, 1, vertsBytes, file) == vertsBytes;
+	ok = ok && fwrite(zeros, 1, indsOff - vertsOffset - vertsBytes, file) == indsOff - vertsOffset - vertsBytes;
+	ok = ok && fwrite(entry.inds, sizeof(u32), entry.numInds, file) == entry.numInds;
+	ok = fclose(file) == 0 && ok;
+
+	std::error_code error;
+	if(ok)
+		std::filesystem::rename(tmpPath, path, error);
+	if(!ok || error)
+		std::filesystem::remove(tmpPath, error);
+}
+
+void MeshCache::evict(const Entry* keep)
+{
+	while(_stats.numBytes > _maxBytes) {
+		size_t oldest = _entries.size();
+		for(size_t i = 0; i < _entries.size(); i++) {
+			if(_entries[i].get() != keep && (oldest == _entries.size() || _entries[i]->lastUse < _entries[oldest]->lastUse))
+				oldest = i;
+		}
+		if(oldest == _entries.size())
+			return; // only "keep" is left, we let it go over the budget
+		_stats.numBytes -= _entries[oldest]->numBytes;
+		_stats.numMeshes--;
+		_stats.evictions++;
+		_entries.erase(_entries.begin() + oldest);
+	}
+}
+
+MeshCache& getMeshCache()
+{
+	static MeshCache cache;
+	return cache;
+}
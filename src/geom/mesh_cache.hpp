@@ -0,0 +1,96 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "mesh.hpp"
+#include "tl/mapped_file.hpp"
+
+// Cache of generated meshes keyed by a string with the generator name and its parameters,
+// e.g. "icosphere/7/normalized". The meshes are kept in memory under a byte budget, evicting the least
+// recently used ones, and optionally written to a directory from where later runs map them instead of
+// generating them again.
+// The spans returned by get() stay valid until the next get() or clear(), so call get() every time
+// the mesh is used, a hit is just a lookup
+
+// bump it when a generator makes different meshes for the same key: it goes into the name and the header of the
+// disk cache files, so the files of the other versions are misses
+constexpr u32 MESH_GENERATOR_VERSION = 1;
+
+class MeshCache
+{
+public:
+	struct Stats {
+		u32 memoryHits;
+		u32 diskHits; // mapped from the disk cache
+		u32 misses; // had to generate
+		u32 evictions;
+		u32 numMeshes;
+		size_t numBytes; // in memory, generated or mapped
+	};
+
+	explicit MeshCache(size_t maxBytes = 256 << 20);
+
+	void setMaxBytes(size_t maxBytes);
+	// nullptr disables the disk cache
+	void setDiskDir(const char* dir);
+
+	// generate(tl::Span<V> verts, tl::Span<u32> inds) must fill exactly numVerts and numInds
+	template <typename V, typename F>
+	CMeshSpans<V> get(const char* key, u32 numVerts, u32 numInds, F&& generate);
+
+	void clear();
+	const Stats& stats()const { return _stats; }
+
+private:
+	struct Entry {
+		std::string key;
+		u32 vertSize, numVerts, numInds;
+		std::vector<u8> memory; // when generated in this run
+		tl::MappedFile file; // when it comes from the disk cache
+		const u8* verts;
+		const u32* inds;
+		size_t numBytes;
+		u64 lastUse;
+	};
+
+	Entry* find(const char* key, u32 vertSize, u32 numVerts, u32 numInds);
+	Entry* loadFromDisk(const char* key, u32 vertSize, u32 numVerts, u32 numInds);
+	Entry* add(const char* key, u32 vertSize, u32 numVerts, u32 numInds,
+		void (*generate)(void* ctx, u8* verts, u32* inds), void* ctx);
+	void saveToDisk(const Entry& entry);
+	void evict(const Entry* keep);
+	std::string diskPath(const char* key)const;
+
+	std::vector<std::unique_ptr<Entry>> _entries;
+	size_t _maxBytes;
+	std::string _diskDir;
+	u64 _useCounter = 0;
+	Stats _stats = {};
+};
+
+// the cache shared by the app and the user code, its stats are shown in the gui
+MeshCache& getMeshCache();
+
+// ---------------------------------------------------------------------------------------------
+template <typename V, typename F>
+CMeshSpans<V> MeshCache::get(const char* key, u32 numVerts, u32 numInds, F&& generate)
+{
+	Entry* entry = find(key, sizeof(V), numVerts, numInds);
+	if(entry)
+		_stats.memoryHits++;
+	else if((entry = loadFromDisk(key, sizeof(V), numVerts, numInds)))
+		_stats.diskHits++;
+	else {
+		_stats.misses++;
+		struct Ctx { std::remove_reference_t<F>* f; u32 numVerts, numInds; } ctx = { &generate, numVerts, numInds };
+		entry = add(key, sizeof(V), numVerts, numInds, [](void* ctx, u8* verts, u32* inds) {
+			Ctx& c = *(Ctx*)ctx;
+			(*c.f)(tl::Span<V>((V*)verts, c.numVerts), tl::Span<u32>(inds, c.numInds));
+		}, &ctx);
+	}
+	entry->lastUse = ++_useCounter;
+	evict(entry);
+	return { {(const V*)entry->verts, numVerts}, {entry->inds, numInds} };
+}
@@ -0,0 +1,337 @@
+#include "meshlets.hpp"
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "tl/parallel.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define GEOM_SSE
+	#include <xmmintrin.h>
+#endif
+
+namespace
+{
+
+constexpr size_t TRI_GRAIN = 16 << 10;
+constexpr size_t BOUNDS_GRAIN = 1024; // meshlets
+constexpr u32 CULL_GRAIN = 1024; // meshlets per parallel chunk of the culling, a multiple of 4
+constexpr u32 MAX_CULL_CHUNKS = 256; // their results are compacted in order after the parallel part
+
+struct Positions {
+	const u8* data;
+	size_t stride;
+	vec3 operator[](u32 i)const { return *(const vec3*)(data + i * stride); }
+};
+
+// all the triangles of the meshlet face away from the camera: the angle between the direction to the center and
+// the normals is less than 90 degrees even after moving to the edge of the sphere
+inline bool isBackfacing(const Meshlet& m, vec3 cameraPos)
+{
+	const vec3 v = vec3(m.sphere) - cameraPos;
+	const float va = glm::dot(v, vec3(m.cone));
+	const float perp = sqrtf(glm::max((glm::dot(v, v) - va * va) * (1 - m.cone.w * m.cone.w), 0.f));
+	return va * m.cone.w - perp >= m.sphere.w;
+}
+
+inline bool isOutside(const Meshlet& m, const MeshletCullView& view)
+{
+	for(int p = 0; p < 6; p++)
+		if(glm::dot(vec3(view.planes[p]), vec3(m.sphere)) + view.planes[p].w < -m.sphere.w)
+			return true;
+	return false;
+}
+
+#ifdef GEOM_SSE
+// the culling of 4 meshlets, bit k of outside and backfacing is meshlet k
+void cull4(const Meshlet* m, const MeshletCullView& view, int& outside, int& backfacing)
+{
+	__m128 cx = _mm_loadu_ps(&m[0].sphere.x), cy = _mm_loadu_ps(&m[1].sphere.x);
+	__m128 cz = _mm_loadu_ps(&m[2].sphere.x), r = _mm_loadu_ps(&m[3].sphere.x);
+	_MM_TRANSPOSE4_PS(cx, cy, cz, r);
+	const __m128 negR = _mm_sub_ps(_mm_setzero_ps(), r);
+
+	__m128 out = _mm_setzero_ps();
+	for(int p = 0; p < 6; p++) {
+		const vec4& plane = view.planes[p];
+		const __m128 d = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cx), _mm_mul_ps(_mm_set1_ps(plane.y), cy)),
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), cz), _mm_set1_ps(plane.w)));
+		out = _mm_or_ps(out, _mm_cmplt_ps(d, negR));
+	}
+	outside = _mm_movemask_ps(out);
+	backfacing = 0;
+	if(!view.cones)
+		return;
+
+	__m128 ax = _mm_loadu_ps(&m[0].cone.x), ay = _mm_loadu_ps(&m[1].cone.x);
+	__m128 az = _mm_loadu_ps(&m[2].cone.x), cosA = _mm_loadu_ps(&m[3].cone.x);
+	_MM_TRANSPOSE4_PS(ax, ay, az, cosA);
+	const __m128 vx = _mm_sub_ps(cx, _mm_set1_ps(view.cameraPos.x));
+	const __m128 vy = _mm_sub_ps(cy, _mm_set1_ps(view.cameraPos.y));
+	const __m128 vz = _mm_sub_ps(cz, _mm_set1_ps(view.cameraPos.z));
+	const __m128 va = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, ax), _mm_mul_ps(vy, ay)), _mm_mul_ps(vz, az));
+	const __m128 vv = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+	const __m128 sin2 = _mm_sub_ps(_mm_set1_ps(1), _mm_mul_ps(cosA, cosA));
+	const __m128 perp = _mm_sqrt_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(vv, _mm_mul_ps(va, va)), sin2), _mm_setzero_ps()));
+	backfacing = _mm_movemask_ps(_mm_cmpge_ps(_mm_sub_ps(_mm_mul_ps(va, cosA), perp), r)) & ~outside;
+}
+#endif
+
+}
+
+u32 buildMeshlets(tl::Arena& scratch, const vec3* positions, size_t positionStride, u32 numVerts, tl::Span<u32> inds,
+	tl::Span<u32> meshletOffsets, u32 maxTriangles, float coneWeight)
+{
+	assert(inds.size() % 3 == 0 && maxTriangles > 0);
+	const u32 numTris = u32(inds.size() / 3);
+	assert(meshletOffsets.size() >= maxMeshlets(inds.size()) + 1);
+	const Positions pos = {(const u8*)positions, positionStride};
+
+	// vertex -> triangles
+	tl::Span<u32> offsets = scratch.alloc<u32>(numVerts + 1);
+	tl::Span<u32> vertTris = scratch.alloc<u32>(inds.size());
+	memset(offsets.begin(), 0, (numVerts + 1) * sizeof(u32));
+	for(u32 v : inds)
+		offsets[v + 1]++;
+	for(u32 v = 0; v < numVerts; v++)
+		offsets[v + 1] += offsets[v];
+	for(u32 i = 0; i < inds.size(); i++)
+		vertTris[offsets[inds[i]]++] = i / 3;
+	for(u32 v = numVerts; v > 0; v--) // the fill moved every offset to the next vertex
+		offsets[v] = offsets[v - 1];
+	offsets[0] = 0;
+
+	tl::Span<vec3> centroids = scratch.alloc<vec3>(numTris);
+	tl::Span<vec3> normals = scratch.alloc<vec3>(numTris);
+	tl::parallelForRanges(0, numTris, TRI_GRAIN, [&](size_t from, size_t to) {
+		for(size_t t = from; t < to; t++) {
+			const vec3 a = pos[inds[3*t]], b = pos[inds[3*t + 1]], c = pos[inds[3*t + 2]];
+			centroids[t] = (a + b + c) * (1.f / 3);
+			const vec3 n = glm::cross(b - a, c - a);
+			const float l = glm::length(n);
+			normals[t] = l > 0 ? n / l : vec3(0);
+		}
+	});
+
+	tl::Span<u8> taken = scratch.alloc<u8>(numTris);
+	tl::Span<u32> stamps = scratch.alloc<u32>(numTris);
+	tl::Span<u32> order = scratch.alloc<u32>(numTris);
+	tl::Span<u32> newInds = scratch.alloc<u32>(inds.size());
+	tl::Span<u32> candidates = scratch.alloc<u32>(MESHLET_MAX_CANDIDATES);
+	memset(taken.begin(), 0, numTris);
+	memset(stamps.begin(), 0xFF, numTris * sizeof(u32));
+
+	u32 numMeshlets = 0, numTaken = 0, seed = 0;
+	while(numTaken < numTris) {
+		while(taken[seed])
+			seed++;
+		const u32 meshlet = numMeshlets++;
+		const u32 first = numTaken;
+		meshletOffsets[meshlet] = 3 * first;
+		u32 numCandidates = 0;
+		vec3 centroidSum(0), normalSum(0);
+		auto take = [&](u32 t) {
+			taken[t] = 1;
+			order[numTaken++] = t;
+			centroidSum += centroids[t];
+			normalSum += normals[t];
+			for(int k = 0; k < 3; k++) {
+				const u32 v = inds[3*t + k];
+				for(u32 j = offsets[v]; j < offsets[v + 1] && numCandidates < MESHLET_MAX_CANDIDATES; j++) {
+					const u32 n = vertTris[j];
+					if(!taken[n] && stamps[n] != meshlet) {
+						stamps[n] = meshlet;
+						candidates[numCandidates++] = n;
+					}
+				}
+			}
+		};
+
+		take(seed);
+		while(numTaken - first < maxTriangles) {
+			const vec3 center = centroidSum / float(numTaken - first);
+			const float l = glm::length(normalSum);
+			const vec3 axis = l > 0 ? normalSum / l : vec3(0);
+			// the squared distance to the center, grown by the angle to the normals
+			u32 best = ~0u;
+			float bestScore = FLT_MAX;
+			for(u32 c = 0; c < numCandidates; ) {
+				const u32 t = candidates[c];
+				if(taken[t]) {
+					candidates[c] = candidates[--numCandidates];
+					continue;
+				}
+				const vec3 d = centroids[t] - center;
+				const float f = 1 + coneWeight * (1 - glm::dot(normals[t], axis));
+				const float score = glm::dot(d, d) * f * f;
+				if(score < bestScore) {
+					bestScore = score;
+					best = c;
+				}
+				c++;
+			}
+			if(best == ~0u)
+				break;
+			const u32 t = candidates[best];
+			candidates[best] = candidates[--numCandidates];
+			take(t);
+		}
+		// the list order inside the meshlet
+		std::sort(order.begin() + first, order.begin() + numTaken);
+	}
+	meshletOffsets[numMeshlets] = u32(inds.size());
+
+	for(u32 i = 0; i < numTris; i++)
+		for(int k = 0; k < 3; k++)
+			newInds[3*i + k] = inds[3*order[i] + k];
+	memcpy(inds.begin(), newInds.begin(), inds.size() * sizeof(u32));
+	return numMeshlets;
+}
+
+void computeMeshletBounds(const vec3* positions, size_t positionStride, tl::CSpan<u32> inds,
+	tl::CSpan<u32> meshletOffsets, tl::Span<Meshlet> meshlets)
+{
+	assert(meshletOffsets.size() > meshlets.size());
+	const Positions pos = {(const u8*)positions, positionStride};
+	tl::parallelFor(0, meshlets.size(), BOUNDS_GRAIN, [&](size_t m) {
+		const u32 from = meshletOffsets[m], to = meshletOffsets[m + 1];
+		// the sphere around the center of the bounding box
+		vec3 lo(FLT_MAX), hi(-FLT_MAX);
+		for(u32 i = from; i < to; i++) {
+			lo = glm::min(lo, pos[inds[i]]);
+			hi = glm::max(hi, pos[inds[i]]);
+		}
+		const vec3 center = 0.5f * (lo + hi);
+		float r2 = 0;
+		vec3 normalSum(0);
+		for(u32 i = from; i < to; i++) {
+			const vec3 d = pos[inds[i]] - center;
+			r2 = glm::max(r2, glm::dot(d, d));
+		}
+		for(u32 i = from; i < to; i += 3) {
+			const vec3 n = glm::cross(pos[inds[i + 1]] - pos[inds[i]], pos[inds[i + 2]] - pos[inds[i]]);
+			const float l = glm::length(n);
+			if(l > 0)
+				normalSum += n / l;
+		}
+
+		// the cone: the average normal and the widest angle to it, degenerate triangles don't face anywhere
+		Meshlet& meshlet = meshlets[m];
+		meshlet.sphere = vec4(center, sqrtf(r2));
+		meshlet.cone = vec4(0, 0, 0, -1);
+		meshlet.firstInd = from;
+		meshlet.numInds = to - from;
+		const float l = glm::length(normalSum);
+		if(l == 0)
+			return;
+		const vec3 axis = normalSum / l;
+		float minCos = 1;
+		for(u32 i = from; i < to; i += 3) {
+			const vec3 n = glm::cross(pos[inds[i + 1]] - pos[inds[i]], pos[inds[i + 2]] - pos[inds[i]]);
+			const float nl = glm::length(n);
+			if(nl > 0)
+				minCos = glm::min(minCos, glm::dot(n / nl, axis));
+		}
+		if(minCos > 0)
+			meshlet.cone = vec4(axis, minCos);
+	});
+}
+
+MeshletCullView getMeshletCullView(const mat4& viewProj, const mat4& model, vec3 cameraPos)
+{
+	// the planes of the clip space (-w <= x, y, z <= w) in the space of the mesh
+	const mat4 m = viewProj * model;
+	auto row = [&m](int i) { return vec4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+	MeshletCullView view;
+	for(int i = 0; i < 3; i++) {
+		view.planes[2*i] = row(3) + row(i);
+		view.planes[2*i + 1] = row(3) - row(i);
+	}
+	for(vec4& p : view.planes)
+		p /= glm::length(vec3(p));
+
+	view.cameraPos = vec3(glm::inverse(model) * vec4(cameraPos, 1));
+	// the angles are kept by rotations and uniform scales: orthogonal axes of the same length
+	const vec3 x = vec3(model[0]), y = vec3(model[1]), z = vec3(model[2]);
+	const float xx = glm::dot(x, x), tolerance = 1e-4f * xx;
+	view.cones =
+		glm::abs(glm::dot(y, y) - xx) <= tolerance && glm::abs(glm::dot(z, z) - xx) <= tolerance &&
+		glm::abs(glm::dot(x, y)) <= tolerance && glm::abs(glm::dot(y, z)) <= tolerance && glm::abs(glm::dot(z, x)) <= tolerance;
+	return view;
+}
+
+u32 cullMeshlets(tl::CSpan<Meshlet> meshlets, const MeshletCullView& view, tl::Span<MeshletRange> ranges,
+	MeshletCullStats* stats)
+{
+	assert(ranges.size() >= meshlets.size());
+	struct Chunk {
+		u32 numRanges;
+		MeshletCullStats stats;
+	};
+	Chunk chunks[MAX_CULL_CHUNKS];
+	const u32 numMeshlets = u32(meshlets.size());
+	const u32 grainSize = glm::max(CULL_GRAIN, ((numMeshlets + MAX_CULL_CHUNKS - 1) / MAX_CULL_CHUNKS + 3) & ~3u);
+	const u32 numChunks = (numMeshlets + grainSize - 1) / grainSize;
+
+	// every chunk writes its ranges where its meshlets start, it can't have more
+	tl::parallelForRanges(0, numMeshlets, grainSize, [&](size_t from, size_t to) {
+		MeshletRange* out = ranges.begin() + from;
+		u32 numRanges = 0;
+		MeshletCullStats chunkStats = {};
+		auto emit = [&](const Meshlet& m, bool outside, bool backfacing) {
+			if(outside) {
+				chunkStats.numFrustumCulled++;
+				return;
+			}
+			if(backfacing) {
+				chunkStats.numBackfaceCulled++;
+				return;
+			}
+			chunkStats.numVisible++;
+			chunkStats.numVisibleInds += m.numInds;
+			if(numRanges && out[numRanges - 1].firstInd + out[numRanges - 1].numInds == m.firstInd)
+				out[numRanges - 1].numInds += m.numInds;
+			else
+				out[numRanges++] = {m.firstInd, m.numInds};
+		};
+
+		size_t i = from;
+	#ifdef GEOM_SSE
+		for(; i + 4 <= to; i += 4) {
+			int outside, backfacing;
+			cull4(meshlets.begin() + i, view, outside, backfacing);
+			for(int k = 0; k < 4; k++)
+				emit(meshlets[i + k], (outside >> k) & 1, (backfacing >> k) & 1);
+		}
+	#endif
+		for(; i < to; i++) {
+			const bool outside = isOutside(meshlets[i], view);
+			emit(meshlets[i], outside, !outside && view.cones && isBackfacing(meshlets[i], view.cameraPos));
+		}
+		chunks[from / grainSize] = {numRanges, chunkStats};
+	});
+
+	// the chunks in order, the ranges only move back
+	u32 numRanges = 0;
+	MeshletCullStats total = {};
+	for(u32 c = 0; c < numChunks; c++) {
+		const MeshletRange* src = ranges.begin() + c * grainSize;
+		for(u32 j = 0; j < chunks[c].numRanges; j++) {
+			const MeshletRange r = src[j];
+			if(numRanges && ranges[numRanges - 1].firstInd + ranges[numRanges - 1].numInds == r.firstInd)
+				ranges[numRanges - 1].numInds += r.numInds;
+			else
+				ranges[numRanges++] = r;
+		}
+		total.numVisible += chunks[c].stats.numVisible;
+		total.numFrustumCulled += chunks[c].stats.numFrustumCulled;
+		total.numBackfaceCulled += chunks[c].stats.numBackfaceCulled;
+		total.numVisibleInds += chunks[c].stats.numVisibleInds;
+	}
+	if(stats)
+		*stats = total;
+	return numRanges;
+}
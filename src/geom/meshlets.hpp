@@ -0,0 +1,79 @@
+#pragma once
+
+#include "mesh.hpp"
+#include "tl/arena.hpp"
+
+// Meshlets: the triangles of a mesh split into clusters of up to maxTriangles neighbours, each with a bounding
+// sphere and a cone around its normals, so a big mesh can be culled by pieces instead of as a whole
+// A meshlet starts at the first free triangle in the list order and grows through the triangles that share a
+// vertex with it, taking the closest to its center and the best aligned with its normals (coneWeight trades
+// one for the other). Its triangles keep their list order, so the vertex cache order is kept inside the meshlets
+// The culling tests 4 meshlets at a time against the frustum and the normal cones, in parallel, and merges the
+// visible meshlets that are next to each other in the index buffer into ranges, e.g. for glMultiDrawElements()
+// The scratch memory comes from an arena, size it with buildMeshletsArenaBytes()
+
+struct Meshlet {
+	vec4 sphere; // center, radius
+	// axis and cos of the half angle of the cone of the normals. A cone of more than 90 degrees can't be
+	// culled, it's (0, 0, 0, -1)
+	vec4 cone;
+	u32 firstInd, numInds;
+};
+
+struct MeshletRange {
+	u32 firstInd, numInds;
+};
+
+constexpr u32 MESHLET_MAX_TRIANGLES = 64; // the meshlets of the retained meshes
+constexpr u32 MESHLET_MAX_CANDIDATES = 1024; // triangles next to a growing meshlet that it looks at
+
+constexpr size_t buildMeshletsArenaBytes(u32 numVerts, size_t numInds)
+{
+	return
+		tl::Arena::bytesFor<u32>(numVerts + 1) + // vertex -> triangles offsets
+		tl::Arena::bytesFor<u32>(numInds) + // vertex -> triangles
+		tl::Arena::bytesFor<vec3>(numInds / 3) + // centroids
+		tl::Arena::bytesFor<vec3>(numInds / 3) + // normals
+		tl::Arena::bytesFor<u8>(numInds / 3) + // taken triangles
+		tl::Arena::bytesFor<u32>(numInds / 3) + // last meshlet that looked at the triangle
+		tl::Arena::bytesFor<u32>(numInds / 3) + // triangles in the new order
+		tl::Arena::bytesFor<u32>(numInds) + // indices in the new order
+		tl::Arena::bytesFor<u32>(MESHLET_MAX_CANDIDATES);
+}
+
+// the worst case: the triangles don't share any vertex
+constexpr u32 maxMeshlets(size_t numInds)
+{
+	return u32(numInds / 3);
+}
+
+// Reorders the triangles so every meshlet is contiguous. meshletOffsets needs maxMeshlets() + 1 entries, it gets
+// the first index of every meshlet and then inds.size(). Returns the number of meshlets
+u32 buildMeshlets(tl::Arena& scratch, const vec3* positions, size_t positionStride, u32 numVerts, tl::Span<u32> inds,
+	tl::Span<u32> meshletOffsets, u32 maxTriangles = MESHLET_MAX_TRIANGLES, float coneWeight = 0.5f);
+
+// the bounds of the meshlets [meshletOffsets[i], meshletOffsets[i+1]), meshlets.size() is the number of meshlets
+void computeMeshletBounds(const vec3* positions, size_t positionStride, tl::CSpan<u32> inds,
+	tl::CSpan<u32> meshletOffsets, tl::Span<Meshlet> meshlets);
+
+// what the culling needs to know, in the space of the mesh
+struct MeshletCullView {
+	vec4 planes[6]; // of the frustum, the normals point inside and have unit length
+	vec3 cameraPos;
+	bool cones; // the cone test only works if the model matrix keeps the angles
+};
+
+// model is the matrix of the mesh, cameraPos is in world space
+MeshletCullView getMeshletCullView(const mat4& viewProj, const mat4& model, vec3 cameraPos);
+
+struct MeshletCullStats {
+	u32 numVisible;
+	u32 numFrustumCulled;
+	u32 numBackfaceCulled; // all their triangles face away from the camera
+	u32 numVisibleInds;
+};
+
+// writes the visible meshlets as ranges of indices to ranges, which needs meshlets.size() entries, and returns
+// the number of ranges. The order is the order of the meshlets, the results don't depend on the threads
+u32 cullMeshlets(tl::CSpan<Meshlet> meshlets, const MeshletCullView& view, tl::Span<MeshletRange> ranges,
+	MeshletCullStats* stats = nullptr);
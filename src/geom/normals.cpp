@@ -0,0 +1,191 @@
+#include "normals.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <math.h>
+#include "tl/parallel.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define GEOM_SSE
+	#include <xmmintrin.h>
+#endif
+
+namespace
+{
+
+constexpr size_t FACE_GRAIN = 16 << 10; // faces per parallel chunk, a multiple of 4
+constexpr size_t VERT_GRAIN = 8 << 10;
+
+struct FaceData {
+	float* nx; // face normal, its length is twice the area in Area mode, unit length in Angle mode
+	float* ny;
+	float* nz;
+	float* angles; // Angle mode: 3 per face, the angles at the corners
+};
+
+struct Positions {
+	const u8* data;
+	size_t stride;
+	vec3 operator[](u32 i)const { return *(const vec3*)(data + i * stride); }
+};
+
+inline float cornerAngle(float c)
+{
+	return acosf(c < -1 ? -1 : (c > 1 ? 1 : c));
+}
+
+void computeFace(const Positions& pos, const u32* tri, bool angle, FaceData& faces, size_t f)
+{
+	const vec3 a = pos[tri[0]], b = pos[tri[1]], c = pos[tri[2]];
+	const vec3 e0 = b - a, e1 = c - b, e2 = a - c;
+	vec3 n = cross(e0, -e2);
+	if(angle) {
+		const float l0 = length(e0), l1 = length(e1), l2 = length(e2);
+		const float ln = length(n);
+		n = ln > 0 ? n / ln : vec3(0);
+		faces.angles[3*f + 0] = l0 * l2 > 0 ? cornerAngle(-dot(e0, e2) / (l0 * l2)) : 0;
+		faces.angles[3*f + 1] = l0 * l1 > 0 ? cornerAngle(-dot(e0, e1) / (l0 * l1)) : 0;
+		faces.angles[3*f + 2] = l1 * l2 > 0 ? cornerAngle(-dot(e1, e2) / (l1 * l2)) : 0;
+	}
+	faces.nx[f] = n.x;
+	faces.ny[f] = n.y;
+	faces.nz[f] = n.z;
+}
+
+#ifdef GEOM_SSE
+struct Vec3x4 {
+	__m128 x, y, z;
+};
+
+inline Vec3x4 operator-(const Vec3x4& a, const Vec3x4& b)
+{
+	return {_mm_sub_ps(a.x, b.x), _mm_sub_ps(a.y, b.y), _mm_sub_ps(a.z, b.z)};
+}
+
+inline Vec3x4 cross4(const Vec3x4& a, const Vec3x4& b)
+{
+	return {
+		_mm_sub_ps(_mm_mul_ps(a.y, b.z), _mm_mul_ps(a.z, b.y)),
+		_mm_sub_ps(_mm_mul_ps(a.z, b.x), _mm_mul_ps(a.x, b.z)),
+		_mm_sub_ps(_mm_mul_ps(a.x, b.y), _mm_mul_ps(a.y, b.x))};
+}
+
+inline __m128 dot4(const Vec3x4& a, const Vec3x4& b)
+{
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)), _mm_mul_ps(a.z, b.z));
+}
+
+// the corners k of the 4 triangles starting at tri, transposed to SoA
+inline Vec3x4 loadCorners(const Positions& pos, const u32* tri, int k)
+{
+	const vec3 p0 = pos[tri[k]], p1 = pos[tri[3 + k]], p2 = pos[tri[6 + k]], p3 = pos[tri[9 + k]];
+	return {_mm_setr_ps(p0.x, p1.x, p2.x, p3.x), _mm_setr_ps(p0.y, p1.y, p2.y, p3.y), _mm_setr_ps(p0.z, p1.z, p2.z, p3.z)};
+}
+
+// 1/sqrt(x) for x > 0, and 0 for x == 0 (degenerate triangles)
+inline __m128 safeRcpSqrt(__m128 x)
+{
+	const __m128 nonZero = _mm_cmpgt_ps(x, _mm_setzero_ps());
+	return _mm_and_ps(nonZero, _mm_div_ps(_mm_set1_ps(1), _mm_sqrt_ps(x)));
+}
+
+void computeFaces4(const Positions& pos, const u32* tri, bool angle, FaceData& faces, size_t f)
+{
+	const Vec3x4 a = loadCorners(pos, tri, 0), b = loadCorners(pos, tri, 1), c = loadCorners(pos, tri, 2);
+	const Vec3x4 e0 = b - a, e1 = c - b, e2 = a - c;
+	Vec3x4 n = cross4(e2, e0); // == cross(e0, -e2)
+	if(angle) {
+		const __m128 r0 = safeRcpSqrt(dot4(e0, e0)), r1 = safeRcpSqrt(dot4(e1, e1)), r2 = safeRcpSqrt(dot4(e2, e2));
+		const __m128 rn = safeRcpSqrt(dot4(n, n));
+		n = {_mm_mul_ps(n.x, rn), _mm_mul_ps(n.y, rn), _mm_mul_ps(n.z, rn)};
+		const __m128 negOne = _mm_set1_ps(-1);
+		alignas(16) float cosines[3][4];
+		_mm_store_ps(cosines[0], _mm_mul_ps(_mm_mul_ps(dot4(e0, e2), negOne), _mm_mul_ps(r0, r2)));
+		_mm_store_ps(cosines[1], _mm_mul_ps(_mm_mul_ps(dot4(e0, e1), negOne), _mm_mul_ps(r0, r1)));
+		_mm_store_ps(cosines[2], _mm_mul_ps(_mm_mul_ps(dot4(e1, e2), negOne), _mm_mul_ps(r1, r2)));
+		// a degenerate corner gets cos = 0, so the face still gets weight, but its normal is 0
+		for(int i = 0; i < 4; i++)
+			for(int k = 0; k < 3; k++)
+				faces.angles[3*(f + i) + k] = cornerAngle(cosines[k][i]);
+	}
+	_mm_storeu_ps(faces.nx + f, n.x);
+	_mm_storeu_ps(faces.ny + f, n.y);
+	_mm_storeu_ps(faces.nz + f, n.z);
+}
+#endif
+
+}
+
+void computeVertexNormals(tl::Arena& scratch,
+	const vec3* positions, size_t positionStride, u32 numVerts, tl::CSpan<u32> inds,
+	vec3* normals, size_t normalStride, NormalWeighting weighting)
+{
+	assert(inds.size() % 3 == 0);
+	const size_t numFaces = inds.size() / 3;
+	const bool angle = weighting == NormalWeighting::Angle;
+	const Positions pos = {(const u8*)positions, positionStride};
+
+	FaceData faces;
+	{
+		tl::Span<float> mem = scratch.alloc<float>(2 * inds.size());
+		faces.nx = mem.begin();
+		faces.ny = faces.nx + numFaces;
+		faces.nz = faces.ny + numFaces;
+		faces.angles = faces.nz + numFaces;
+	}
+	tl::Span<std::atomic<u32>> counters = scratch.alloc<std::atomic<u32>>(numVerts);
+	tl::Span<u32> offsets = scratch.alloc<u32>(numVerts + 1);
+	tl::Span<u32> corners = scratch.alloc<u32>(inds.size());
+
+	// faces
+	tl::parallelForRanges(0, numFaces, FACE_GRAIN, [&](size_t from, size_t to) {
+		size_t f = from;
+	#ifdef GEOM_SSE
+		for(; f + 4 <= to; f += 4)
+			computeFaces4(pos, inds.begin() + 3*f, angle, faces, f);
+	#endif
+		for(; f < to; f++)
+			computeFace(pos, inds.begin() + 3*f, angle, faces, f);
+	});
+
+	// vertex -> corners adjacency: count, prefix sum, fill
+	tl::parallelForRanges(0, numVerts, VERT_GRAIN, [&](size_t from, size_t to) {
+		for(size_t v = from; v < to; v++)
+			counters[v].store(0, std::memory_order_relaxed);
+	});
+	tl::parallelForRanges(0, inds.size(), 3 * FACE_GRAIN, [&](size_t from, size_t to) {
+		for(size_t i = from; i < to; i++)
+			counters[inds[i]].fetch_add(1, std::memory_order_relaxed);
+	});
+	u32 sum = 0;
+	for(u32 v = 0; v < numVerts; v++) {
+		offsets[v] = sum;
+		sum += counters[v].load(std::memory_order_relaxed);
+		counters[v].store(offsets[v], std::memory_order_relaxed);
+	}
+	offsets[numVerts] = sum;
+	tl::parallelForRanges(0, inds.size(), 3 * FACE_GRAIN, [&](size_t from, size_t to) {
+		for(size_t i = from; i < to; i++)
+			corners[counters[inds[i]].fetch_add(1, std::memory_order_relaxed)] = u32(i);
+	});
+
+	// vertices
+	tl::parallelForRanges(0, numVerts, VERT_GRAIN, [&](size_t from, size_t to) {
+		for(size_t v = from; v < to; v++) {
+			u32* first = corners.begin() + offsets[v];
+			u32* last = corners.begin() + offsets[v + 1];
+			// the fill order depends on the threads, sort the corners so the sum doesn't
+			for(u32* i = first + 1; i < last; i++)
+				for(u32* j = i; j > first && j[-1] > j[0]; j--)
+					std::swap(j[-1], j[0]);
+			vec3 n(0);
+			for(u32* i = first; i < last; i++) {
+				const u32 f = *i / 3;
+				const float w = angle ? faces.angles[*i] : 1.f;
+				n += w * vec3(faces.nx[f], faces.ny[f], faces.nz[f]);
+			}
+			const float l = length(n);
+			*(vec3*)((u8*)normals + v * normalStride) = l > 0 ? n / l : vec3(0);
+		}
+	});
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "mesh.hpp"
+#include "tl/arena.hpp"
+#include "tl/strided_span.hpp"
+
+// Smooth vertex normals of an indexed triangle mesh (counterclockwise front faces)
+// The faces are processed 4 at a time with SSE, then every vertex sums the faces around it through a
+// vertex -> corner adjacency table, so the vertices can be written in parallel without races and the
+// result doesn't depend on the number of threads
+// The temporary memory comes from the scratch arena, size it with vertexNormalsArenaBytes()
+
+enum class NormalWeighting {
+	Area, // faces weighted by their area, cheap and good for even meshes
+	Angle, // faces weighted by the angle of the corner at the vertex, independent of how the faces are split
+};
+
+constexpr size_t vertexNormalsArenaBytes(u32 numVerts, u32 numInds)
+{
+	return
+		tl::Arena::bytesFor<float>(2 * numInds) + // face normals (SoA) and corner angles
+		tl::Arena::bytesFor<u32>(numVerts) + // counters
+		tl::Arena::bytesFor<u32>(numVerts + 1) + // adjacency offsets
+		tl::Arena::bytesFor<u32>(numInds); // adjacent corners
+}
+
+// positions and normals are read and written with the given strides in bytes, so they can point inside
+// vertex structs. Vertices without faces get a zero normal
+void computeVertexNormals(tl::Arena& scratch,
+	const vec3* positions, size_t positionStride, u32 numVerts, tl::CSpan<u32> inds,
+	vec3* normals, size_t normalStride, NormalWeighting weighting = NormalWeighting::Area);
+
+// positions and normals can be streams of a SoaMesh or members of vertex structs, see geom/soa_mesh.hpp
+inline void computeVertexNormals(tl::Arena& scratch, tl::CStridedSpan<vec3> positions, tl::CSpan<u32> inds,
+	tl::StridedSpan<vec3> normals, NormalWeighting weighting = NormalWeighting::Area)
+{
+	assert(normals.size() == positions.size());
+	computeVertexNormals(scratch, positions.data(), positions.stride(), u32(positions.size()), inds,
+		normals.data(), normals.stride(), weighting);
+}
+
+template <typename V>
+void computeVertexNormals(tl::Arena& scratch, tl::Span<V> verts, tl::CSpan<u32> inds,
+	NormalWeighting weighting = NormalWeighting::Area)
+{
+	computeVertexNormals(scratch, tl::stridedMember(verts, &V::pos), inds, tl::stridedMember(verts, &V::normal), weighting);
+}
@@ -0,0 +1,192 @@
+#include "overdraw.hpp"
+
+#include <float.h>
+#include <string.h>
+#include <algorithm>
+#include "tl/parallel.hpp"
+
+namespace
+{
+
+struct Positions {
+	const u8* data;
+	size_t stride;
+	vec3 operator[](u32 i)const { return *(const vec3*)(data + i * stride); }
+};
+
+// depth buffer rasterization from the positive (sign > 0) or negative side of an axis
+OverdrawStats rasterizeView(const Positions& pos, tl::CSpan<u32> inds, int axis, float sign,
+	vec3 boundsMin, vec3 boundsMax, float* depth)
+{
+	constexpr u32 RES = OVERDRAW_RESOLUTION;
+	const int ax1 = (axis + 1) % 3, ax2 = (axis + 2) % 3;
+	const float scale1 = boundsMax[ax1] > boundsMin[ax1] ? RES / (boundsMax[ax1] - boundsMin[ax1]) : 0;
+	const float scale2 = boundsMax[ax2] > boundsMin[ax2] ? RES / (boundsMax[ax2] - boundsMin[ax2]) : 0;
+	std::fill(depth, depth + RES * RES, FLT_MAX);
+
+	OverdrawStats stats = {};
+	for(size_t i = 0; i < inds.size(); i += 3) {
+		const vec3 p[3] = {pos[inds[i]], pos[inds[i+1]], pos[inds[i+2]]};
+		if(cross(p[1] - p[0], p[2] - p[0])[axis] * sign <= 0)
+			continue; // back face
+		float x[3], y[3], z[3];
+		for(int k = 0; k < 3; k++) {
+			x[k] = (p[k][ax1] - boundsMin[ax1]) * scale1;
+			y[k] = (p[k][ax2] - boundsMin[ax2]) * scale2;
+			z[k] = -sign * p[k][axis]; // smaller is closer
+		}
+		float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+		if(area == 0)
+			continue;
+		if(area < 0) {
+			std::swap(x[1], x[2]);
+			std::swap(y[1], y[2]);
+			std::swap(z[1], z[2]);
+			area = -area;
+		}
+		const int minX = std::max(0, int(std::min({x[0], x[1], x[2]})));
+		const int maxX = std::min(int(RES) - 1, int(std::max({x[0], x[1], x[2]})));
+		const int minY = std::max(0, int(std::min({y[0], y[1], y[2]})));
+		const int maxY = std::min(int(RES) - 1, int(std::max({y[0], y[1], y[2]})));
+		const float invArea = 1 / area;
+		for(int py = minY; py <= maxY; py++)
+		for(int px = minX; px <= maxX; px++) {
+			const float cx = px + 0.5f, cy = py + 0.5f;
+			const float w0 = (x[2] - x[1]) * (cy - y[1]) - (y[2] - y[1]) * (cx - x[1]);
+			const float w1 = (x[0] - x[2]) * (cy - y[2]) - (y[0] - y[2]) * (cx - x[2]);
+			const float w2 = (x[1] - x[0]) * (cy - y[0]) - (y[1] - y[0]) * (cx - x[0]);
+			if(w0 < 0 || w1 < 0 || w2 < 0)
+				continue;
+			const float d = (w0 * z[0] + w1 * z[1] + w2 * z[2]) * invArea;
+			float& dst = depth[py * RES + px];
+			if(d < dst) {
+				dst = d;
+				stats.numShaded++;
+			}
+		}
+	}
+	for(u32 i = 0; i < RES * RES; i++)
+		stats.numCovered += depth[i] < FLT_MAX;
+	return stats;
+}
+
+}
+
+OverdrawStats computeOverdrawStats(tl::Arena& scratch,
+	const vec3* positions, size_t positionStride, u32 numVerts, tl::CSpan<u32> inds)
+{
+	const Positions pos = {(const u8*)positions, positionStride};
+	vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+	for(u32 v = 0; v < numVerts; v++) {
+		boundsMin = glm::min(boundsMin, pos[v]);
+		boundsMax = glm::max(boundsMax, pos[v]);
+	}
+
+	constexpr u32 RES = OVERDRAW_RESOLUTION;
+	float* depth = scratch.alloc<float>(6 * RES * RES).begin();
+	OverdrawStats views[6];
+	tl::parallelFor(0, 6, 1, [&](size_t v) {
+		views[v] = rasterizeView(pos, inds, int(v / 2), v % 2 ? -1.f : 1.f, boundsMin, boundsMax, depth + v * RES * RES);
+	});
+
+	OverdrawStats stats = {};
+	for(const OverdrawStats& view : views) {
+		stats.numCovered += view.numCovered;
+		stats.numShaded += view.numShaded;
+	}
+	stats.overdraw = stats.numCovered ? float(stats.numShaded) / stats.numCovered : 0;
+	return stats;
+}
+
+void optimizeOverdraw(tl::Arena& scratch,
+	const vec3* positions, size_t positionStride, u32 numVerts, tl::Span<u32> inds)
+{
+	constexpr u32 CACHE_SIZE = 16;
+	constexpr float SOFT_BOUNDARY_THRESHOLD = 1.05f; // how much worse the ACMR of a cluster can be
+	constexpr u32 MIN_SOFT_CLUSTER = 32; // triangles
+	const Positions pos = {(const u8*)positions, positionStride};
+	const u32 numTris = u32(inds.size() / 3);
+	if(numTris == 0)
+		return;
+
+	// Clusters: a new one starts where the 3 vertices of a triangle miss the cache (hard boundary), and where
+	// the ACMR of the cluster so far is close to the one of the whole mesh (soft boundary), because reordering
+	// the clusters there doesn't cost many cache misses. Every cluster is simulated with a cold cache
+	tl::Span<u32> loadTime = scratch.alloc<u32>(numVerts);
+	tl::Span<u32> clusterStart = scratch.alloc<u32>(numTris + 1);
+	auto simulateTriangle = [&](u32 t, u32& numMisses) {
+		int triMisses = 0;
+		for(int k = 0; k < 3; k++) {
+			const u32 v = inds[3*t + k];
+			if(loadTime[v] && numMisses + 1 - loadTime[v] <= CACHE_SIZE)
+				continue;
+			loadTime[v] = ++numMisses;
+			triMisses++;
+		}
+		return triMisses;
+	};
+	memset(loadTime.begin(), 0, numVerts * sizeof(u32));
+	u32 numMisses = 0;
+	for(u32 t = 0; t < numTris; t++)
+		simulateTriangle(t, numMisses);
+	const float maxClusterAcmr = SOFT_BOUNDARY_THRESHOLD * numMisses / numTris;
+
+	memset(loadTime.begin(), 0, numVerts * sizeof(u32));
+	numMisses = 0;
+	u32 numClusters = 0;
+	u32 clusterMisses = 0, clusterTris = 0;
+	for(u32 t = 0; t < numTris; t++) {
+		u32 missesBefore = numMisses;
+		const int triMisses = simulateTriangle(t, numMisses);
+		if(t == 0 || triMisses == 3 || clusterTris == 0) {
+			clusterStart[numClusters++] = t;
+			clusterMisses = clusterTris = 0;
+			if(t > 0 && triMisses < 3) { // soft boundary: simulate the triangle again with a cold cache
+				missesBefore = numMisses + CACHE_SIZE;
+				numMisses = missesBefore;
+				simulateTriangle(t, numMisses);
+			}
+		}
+		clusterMisses += numMisses - missesBefore;
+		clusterTris++;
+		if(clusterTris >= MIN_SOFT_CLUSTER && clusterMisses <= maxClusterAcmr * clusterTris)
+			clusterTris = 0; // the next triangle starts a cluster
+	}
+	clusterStart[numClusters] = numTris;
+
+	vec3 meshCentroid(0);
+	for(u32 v = 0; v < numVerts; v++)
+		meshCentroid += pos[v];
+	meshCentroid /= float(numVerts);
+
+	// clusters that face away from the centroid go first
+	tl::Span<float> key = scratch.alloc<float>(numClusters);
+	tl::Span<u32> order = scratch.alloc<u32>(numClusters);
+	tl::parallelFor(0, numClusters, 256, [&](size_t c) {
+		vec3 centroid(0), normal(0);
+		float area = 0;
+		for(u32 t = clusterStart[c]; t < clusterStart[c + 1]; t++) {
+			const vec3 a = pos[inds[3*t]], b = pos[inds[3*t+1]], d = pos[inds[3*t+2]];
+			const vec3 n = cross(b - a, d - a);
+			const float triArea = length(n);
+			centroid += triArea * (a + b + d) * (1.f / 3);
+			normal += n;
+			area += triArea;
+		}
+		const float normalLength = length(normal);
+		key[c] = area > 0 && normalLength > 0 ? dot(centroid / area - meshCentroid, normal / normalLength) : 0;
+		order[c] = u32(c);
+	});
+	std::sort(order.begin(), order.end(), [&](u32 a, u32 b) {
+		return key[a] > key[b] || (key[a] == key[b] && a < b);
+	});
+
+	tl::Span<u32> out = scratch.alloc<u32>(inds.size());
+	u32 n = 0;
+	for(u32 c : order) {
+		const u32 first = 3 * clusterStart[c], last = 3 * clusterStart[c + 1];
+		memcpy(out.begin() + n, inds.begin() + first, (last - first) * sizeof(u32));
+		n += last - first;
+	}
+	memcpy(inds.begin(), out.begin(), inds.size() * sizeof(u32));
+}
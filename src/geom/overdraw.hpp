@@ -0,0 +1,54 @@
+#pragma once
+
+#include "mesh.hpp"
+#include "tl/arena.hpp"
+#include "tl/strided_span.hpp"
+
+// Triangle order for less overdraw
+// optimizeOverdraw() keeps the vertex cache order but splits it in clusters where the cache starts over
+// (the 3 vertices of a triangle miss) or the cluster is about as cache efficient as the whole mesh, then draws
+// first the clusters that face outwards from the centroid of the mesh, they are likely in front of the others
+// from most points of view. It costs around 5% more vertex cache misses, and it's a heuristic, check the result
+// with computeOverdrawStats()
+// computeOverdrawStats() rasterizes the mesh from the 6 axis directions with depth test and backface culling
+// and counts how many pixels pass the depth test versus how many are covered
+
+struct OverdrawStats {
+	u64 numCovered; // pixels
+	u64 numShaded; // pixels that passed the depth test, with early-z these are the fragments we pay for
+	float overdraw; // shaded / covered, 1 is the best possible
+};
+
+constexpr u32 OVERDRAW_RESOLUTION = 256;
+
+constexpr size_t overdrawStatsArenaBytes()
+{
+	return tl::Arena::bytesFor<float>(6 * OVERDRAW_RESOLUTION * OVERDRAW_RESOLUTION);
+}
+
+OverdrawStats computeOverdrawStats(tl::Arena& scratch,
+	const vec3* positions, size_t positionStride, u32 numVerts, tl::CSpan<u32> inds);
+
+inline OverdrawStats computeOverdrawStats(tl::Arena& scratch, tl::CStridedSpan<vec3> positions, tl::CSpan<u32> inds)
+{
+	return computeOverdrawStats(scratch, positions.data(), positions.stride(), u32(positions.size()), inds);
+}
+
+constexpr size_t optimizeOverdrawArenaBytes(u32 numVerts, u32 numInds)
+{
+	return
+		tl::Arena::bytesFor<u32>(numVerts) + // cache simulation
+		tl::Arena::bytesFor<u32>(numInds / 3 + 1) + // cluster starts
+		tl::Arena::bytesFor<float>(numInds / 3) + // cluster sort keys
+		tl::Arena::bytesFor<u32>(numInds / 3) + // cluster order
+		tl::Arena::bytesFor<u32>(numInds); // new order
+}
+
+// reorders the triangles in place, run it after optimizeVertexCache()
+void optimizeOverdraw(tl::Arena& scratch,
+	const vec3* positions, size_t positionStride, u32 numVerts, tl::Span<u32> inds);
+
+inline void optimizeOverdraw(tl::Arena& scratch, tl::CStridedSpan<vec3> positions, tl::Span<u32> inds)
+{
+	optimizeOverdraw(scratch, positions.data(), positions.stride(), u32(positions.size()), inds);
+}
@@ -0,0 +1,142 @@
+#include "parametric.hpp"
+
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define GEOM_SSE
+	#include <xmmintrin.h>
+#endif
+
+void generateGridIndices(tl::Span<u32> inds, u32 nu, u32 nv)
+{
+	assert(inds.size() == 0 || inds.size() == gridNumInds(nu, nv));
+	if(inds.size() == 0)
+		return;
+	tl::parallelFor(0, nv, geom_detail::gridRowsPerChunk(nu), [&](size_t iv) {
+		u32* band = inds.begin() + 6 * nu * iv;
+		const u32 row0 = u32(iv) * (nu + 1);
+		const u32 row1 = row0 + nu + 1;
+		for(u32 iu = 0; iu < nu; iu++) {
+			band[6*iu + 0] = row0 + iu;
+			band[6*iu + 1] = row0 + iu + 1;
+			band[6*iu + 2] = row1 + iu + 1;
+			band[6*iu + 3] = row0 + iu;
+			band[6*iu + 4] = row1 + iu + 1;
+			band[6*iu + 5] = row1 + iu;
+		}
+	});
+}
+
+namespace geom_detail
+{
+
+void getCircleTable(u32 nu, const float*& cosTable, const float*& sinTable)
+{
+	// a few tables by nu, so the shapes of a frame with different nu don't rebuild each other's. A table
+	// replaced keeps its storage, so regenerating the shapes doesn't allocate once every entry has grown
+	struct CircleTable {
+		u32 nu = 0;
+		std::vector<float> cos, sin;
+	};
+	constexpr u32 NUM_TABLES = 4;
+	static thread_local CircleTable s_tables[NUM_TABLES];
+	static thread_local u32 s_next = 0;
+	CircleTable* table = nullptr;
+	for(CircleTable& t : s_tables)
+		if(t.nu == nu)
+			table = &t;
+	if(!table) {
+		table = &s_tables[s_next];
+		s_next = (s_next + 1) % NUM_TABLES;
+		table->cos.resize(nu + 1);
+		table->sin.resize(nu + 1);
+		for(u32 i = 0; i <= nu; i++) {
+			const double a = 2 * glm::pi<double>() * i / nu;
+			table->cos[i] = float(cos(a));
+			table->sin[i] = float(sin(a));
+		}
+		table->cos[nu] = 1; // exactly the first column
+		table->sin[nu] = 0;
+		table->nu = nu;
+	}
+	cosTable = table->cos.data();
+	sinTable = table->sin.data();
+}
+
+void writeRevolutionRow(Vert_pos_normal_tc* row, u32 nu, float v, SurfacePoint p,
+	const float* cosTable, const float* sinTable)
+{
+	// the profile point (r, y) rotated around Y: (r*cos, y, -r*sin), the same for the normal
+	const float r = p.pos.x, y = p.pos.y;
+	const float nr = p.normal.x, ny = p.normal.y;
+	const float du = 1.f / nu;
+	u32 iu = 0;
+#ifdef GEOM_SSE
+	// 4 vertices at a time: compute the 8 attributes as SoA and transpose them to the vertex layout
+	const __m128 vr = _mm_set1_ps(r), vnr = _mm_set1_ps(nr);
+	const __m128 vy = _mm_set1_ps(y), vny = _mm_set1_ps(ny);
+	const __m128 vv = _mm_set1_ps(v);
+	const __m128 negZero = _mm_set1_ps(-0.f);
+	for(; iu + 4 <= nu + 1; iu += 4) {
+		const __m128 c = _mm_loadu_ps(cosTable + iu);
+		const __m128 s = _mm_xor_ps(_mm_loadu_ps(sinTable + iu), negZero);
+		__m128 a0 = _mm_mul_ps(vr, c); // x
+		__m128 a1 = vy;
+		__m128 a2 = _mm_mul_ps(vr, s); // z
+		__m128 a3 = _mm_mul_ps(vnr, c); // nx
+		__m128 b0 = vny;
+		__m128 b1 = _mm_mul_ps(vnr, s); // nz
+		__m128 b2 = _mm_mul_ps(_mm_set_ps(float(iu+3), float(iu+2), float(iu+1), float(iu)), _mm_set1_ps(du)); // u
+		__m128 b3 = vv;
+		_MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+		_MM_TRANSPOSE4_PS(b0, b1, b2, b3);
+		float* out = (float*)(row + iu);
+		_mm_storeu_ps(out + 0, a0); _mm_storeu_ps(out + 4, b0);
+		_mm_storeu_ps(out + 8, a1); _mm_storeu_ps(out + 12, b1);
+		_mm_storeu_ps(out + 16, a2); _mm_storeu_ps(out + 20, b2);
+		_mm_storeu_ps(out + 24, a3); _mm_storeu_ps(out + 28, b3);
+	}
+#endif
+	for(; iu <= nu; iu++) {
+		const float c = cosTable[iu], s = -sinTable[iu];
+		row[iu] = {{r * c, y, r * s}, {nr * c, ny, nr * s}, {iu * du, v}};
+	}
+}
+
+}
+
+static_assert(sizeof(Vert_pos_normal_tc) == 8 * sizeof(float), "writeRevolutionRow() relies on this layout");
+
+void generateTorus(tl::Span<Vert_pos_normal_tc> verts, tl::Span<u32> inds, u32 nu, u32 nv, float majorRadius, float minorRadius)
+{
+	generateRevolutionSurface(verts, inds, nu, nv, [&](float v) {
+		const float a = 2*PI * v;
+		const vec3 n(glm::cos(a), glm::sin(a), 0);
+		return SurfacePoint{vec3(majorRadius, 0, 0) + minorRadius * n, n};
+	});
+}
+
+void generateUvSphere(tl::Span<Vert_pos_normal_tc> verts, tl::Span<u32> inds, u32 nu, u32 nv, float radius)
+{
+	generateRevolutionSurface(verts, inds, nu, nv, [&](float v) {
+		const float a = PI * (v - 0.5f); // from the south pole to the north pole
+		const vec3 n(glm::cos(a), glm::sin(a), 0);
+		return SurfacePoint{radius * n, n};
+	});
+}
+
+void generateCone(tl::Span<Vert_pos_normal_tc> verts, tl::Span<u32> inds, u32 nu, u32 nv, float radius, float height)
+{
+	const vec3 n = glm::normalize(vec3(height, radius, 0));
+	generateRevolutionSurface(verts, inds, nu, nv, [&](float v) {
+		return SurfacePoint{vec3(radius * (1 - v), height * v, 0), n}; // from the base up to the apex
+	});
+}
+
+MeshSpans<Vert_pos_normal_tc> allocGrid(tl::Arena& arena, u32 nu, u32 nv)
+{
+	MeshSpans<Vert_pos_normal_tc> mesh;
+	mesh.verts = arena.alloc<Vert_pos_normal_tc>(gridNumVerts(nu, nv));
+	mesh.inds = arena.alloc<u32>(gridNumInds(nu, nv));
+	return mesh;
+}
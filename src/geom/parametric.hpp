@@ -0,0 +1,99 @@
+#pragma once
+
+#include "mesh.hpp"
+#include "tl/arena.hpp"
+#include "tl/parallel.hpp"
+
+// Surfaces evaluated over a grid of (nu+1) x (nv+1) vertices, u and v go from 0 to 1.
+// The first and last columns (and rows) are separate vertices even when they coincide, so the texture
+// coordinates (u, v) don't wrap. Rows of vertices and bands of triangles are generated in parallel
+// The triangles are counterclockwise seen from the side cross(dP/du, dP/dv) points to
+
+constexpr u32 gridNumVerts(u32 nu, u32 nv)
+{
+	return (nu + 1) * (nv + 1);
+}
+
+constexpr u32 gridNumInds(u32 nu, u32 nv)
+{
+	return 6 * nu * nv;
+}
+
+constexpr size_t gridArenaBytes(u32 nu, u32 nv)
+{
+	return tl::Arena::bytesFor<Vert_pos_normal_tc>(gridNumVerts(nu, nv)) + tl::Arena::bytesFor<u32>(gridNumInds(nu, nv));
+}
+
+struct SurfacePoint {
+	vec3 pos;
+	vec3 normal; // normalized
+};
+
+// the indices are the same for every grid surface
+void generateGridIndices(tl::Span<u32> inds, u32 nu, u32 nv);
+
+// generic surface, f(u, v) -> SurfacePoint is called once per vertex
+template <typename F>
+void generateParametricSurface(tl::Span<Vert_pos_normal_tc> verts, tl::Span<u32> inds, u32 nu, u32 nv, F&& f);
+
+// Surface of revolution around the Y axis. profile(v) -> SurfacePoint is called once per row and gives
+// the point and normal of the profile in the XY plane (z = 0, x is the radius); the rotation uses a table of
+// the unit circle instead of calling sin/cos per vertex. u goes counterclockwise seen from +Y, so the faces
+// point outwards when the profile goes upwards on its outer side
+template <typename F>
+void generateRevolutionSurface(tl::Span<Vert_pos_normal_tc> verts, tl::Span<u32> inds, u32 nu, u32 nv, F&& profile);
+
+// common shapes, they are revolution surfaces
+void generateTorus(tl::Span<Vert_pos_normal_tc> verts, tl::Span<u32> inds, u32 nu, u32 nv, float majorRadius, float minorRadius);
+void generateUvSphere(tl::Span<Vert_pos_normal_tc> verts, tl::Span<u32> inds, u32 nu, u32 nv, float radius);
+void generateCone(tl::Span<Vert_pos_normal_tc> verts, tl::Span<u32> inds, u32 nu, u32 nv, float radius, float height);
+
+MeshSpans<Vert_pos_normal_tc> allocGrid(tl::Arena& arena, u32 nu, u32 nv);
+
+// ---------------------------------------------------------------------------------------------
+namespace geom_detail
+{
+	// rows of vertices per parallel chunk, we want a few thousand vertices per chunk
+	inline size_t gridRowsPerChunk(u32 nu) { return 4096 / (nu + 1) + 1; }
+
+	// writes row iv of a revolution surface, cosTable and sinTable have nu+1 entries
+	void writeRevolutionRow(Vert_pos_normal_tc* row, u32 nu, float v, SurfacePoint p,
+		const float* cosTable, const float* sinTable);
+
+	// the unit circle sampled in nu steps, valid until the next call from the same thread
+	void getCircleTable(u32 nu, const float*& cosTable, const float*& sinTable);
+}
+
+template <typename F>
+void generateParametricSurface(tl::Span<Vert_pos_normal_tc> verts, tl::Span<u32> inds, u32 nu, u32 nv, F&& f)
+{
+	assert(verts.size() == 0 || verts.size() == gridNumVerts(nu, nv));
+	if(verts.size()) {
+		tl::parallelFor(0, nv + 1, geom_detail::gridRowsPerChunk(nu), [&](size_t iv) {
+			const float v = float(iv) / nv;
+			Vert_pos_normal_tc* row = verts.begin() + iv * (nu + 1);
+			for(u32 iu = 0; iu <= nu; iu++) {
+				const float u = float(iu) / nu;
+				const SurfacePoint p = f(u, v);
+				row[iu] = {p.pos, p.normal, {u, v}};
+			}
+		});
+	}
+	generateGridIndices(inds, nu, nv);
+}
+
+template <typename F>
+void generateRevolutionSurface(tl::Span<Vert_pos_normal_tc> verts, tl::Span<u32> inds, u32 nu, u32 nv, F&& profile)
+{
+	assert(verts.size() == 0 || verts.size() == gridNumVerts(nu, nv));
+	if(verts.size()) {
+		const float* cosTable;
+		const float* sinTable;
+		geom_detail::getCircleTable(nu, cosTable, sinTable);
+		tl::parallelFor(0, nv + 1, geom_detail::gridRowsPerChunk(nu), [&](size_t iv) {
+			const float v = float(iv) / nv;
+			geom_detail::writeRevolutionRow(verts.begin() + iv * (nu + 1), nu, v, profile(v), cosTable, sinTable);
+		});
+	}
+	generateGridIndices(inds, nu, nv);
+}
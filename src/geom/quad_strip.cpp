@@ -0,0 +1,174 @@
+#include "quad_strip.hpp"
+
+#include <assert.h>
+#include <string.h>
+#include <vector>
+
+void MeshBuilder::reserve(u32 moreVerts, u32 moreInds)
+{
+	if(arena) {
+		if(numVerts + moreVerts > verts.size()) {
+			const size_t n = std::max<size_t>(numVerts + moreVerts, 2 * verts.size());
+			tl::Span<Vert_pos_normal_tc> newVerts = arena->alloc<Vert_pos_normal_tc>(n);
+			if(numVerts)
+				memcpy(newVerts.begin(), verts.begin(), numVerts * sizeof(Vert_pos_normal_tc));
+			verts = newVerts;
+		}
+		if(numInds + moreInds > inds.size()) {
+			const size_t n = std::max<size_t>(numInds + moreInds, 2 * inds.size());
+			tl::Span<u32> newInds = arena->alloc<u32>(n);
+			if(numInds)
+				memcpy(newInds.begin(), inds.begin(), numInds * sizeof(u32));
+			inds = newInds;
+		}
+	}
+	assert(numVerts + moreVerts <= verts.size());
+	assert(numInds + moreInds <= inds.size());
+}
+
+void MeshBuilder::addQuadStrip(tl::CSpan<Vert_pos_tc> v)
+{
+	assert(v.size() >= 4 && v.size() % 2 == 0);
+	addQuadStrips(1, u32(v.size() / 2), [&](u32, u32 e, Vert_pos_tc& a, Vert_pos_tc& b) {
+		a = v[2*e + 0];
+		b = v[2*e + 1];
+	});
+}
+
+void MeshBuilder::addExtrude(tl::CSpan<vec3> outline, bool closed, vec3 offset)
+{
+	assert(outline.size() >= 2);
+	const u32 n = u32(outline.size());
+	const u32 numSegments = closed ? n : n - 1;
+	addQuadStrips(numSegments, 2, [&](u32 s, u32 e, Vert_pos_tc& a, Vert_pos_tc& b) {
+		const u32 s1 = s + 1 == n ? 0 : s + 1;
+		const vec3 o = float(e) * offset;
+		a = {outline[s] + o, {float(e), float(s) / numSegments}};
+		b = {outline[s1] + o, {float(e), float(s + 1) / numSegments}};
+	});
+}
+
+void MeshBuilder::addLoft(tl::CSpan<vec3> sections, u32 sectionSize, bool closed)
+{
+	assert(sectionSize >= 2 && sections.size() % sectionSize == 0);
+	const u32 numSections = u32(sections.size() / sectionSize);
+	const u32 numSegments = closed ? sectionSize : sectionSize - 1;
+	addQuadStrips(numSegments, numSections, [&](u32 s, u32 e, Vert_pos_tc& a, Vert_pos_tc& b) {
+		const u32 s1 = s + 1 == sectionSize ? 0 : s + 1;
+		const float u = float(e) / (numSections - 1);
+		a = {sections[e * sectionSize + s], {u, float(s) / numSegments}};
+		b = {sections[e * sectionSize + s1], {u, float(s + 1) / numSegments}};
+	});
+}
+
+struct SweepFrame {
+	vec3 normal, binormal;
+	float u;
+};
+
+// parallel transport of the frame along the path with the double reflection method
+// (Wang et al. "Computation of rotation minimizing frames")
+static void computeSweepFrames(tl::CSpan<vec3> path, SweepFrame* frames)
+{
+	const size_t n = path.size();
+	auto tangent = [&](size_t i) {
+		const vec3 d = path[std::min(i + 1, n - 1)] - path[i == 0 ? 0 : i - 1];
+		return normalize(d);
+	};
+
+	vec3 t = tangent(0);
+	// any vector perpendicular to the first tangent
+	vec3 r = fabsf(t.y) < 0.9f ? cross(t, vec3(0, 1, 0)) : cross(t, vec3(1, 0, 0));
+	r = normalize(r);
+	float length = 0;
+	frames[0] = {r, cross(t, r), 0};
+	for(size_t i = 1; i < n; i++) {
+		const vec3 v1 = path[i] - path[i-1];
+		const float c1 = dot(v1, v1);
+		const vec3 t1 = tangent(i);
+		if(c1 > 0) {
+			const vec3 rL = r - (2 / c1) * dot(v1, r) * v1;
+			const vec3 tL = t - (2 / c1) * dot(v1, t) * v1;
+			const vec3 v2 = t1 - tL;
+			const float c2 = dot(v2, v2);
+			r = c2 > 0 ? rL - (2 / c2) * dot(v2, rL) * v2 : rL;
+		}
+		t = t1;
+		length += sqrtf(c1);
+		frames[i] = {r, cross(t, r), length};
+	}
+	for(size_t i = 1; i < n; i++)
+		frames[i].u = length > 0 ? frames[i].u / length : 0;
+}
+
+void MeshBuilder::addSweep(tl::CSpan<vec2> profile, bool closed, tl::CSpan<vec3> path)
+{
+	assert(profile.size() >= 2 && path.size() >= 2);
+	// grows to the longest path seen, so sweeping every frame doesn't allocate
+	static thread_local std::vector<SweepFrame> s_frames;
+	if(s_frames.size() < path.size())
+		s_frames.resize(path.size());
+	const SweepFrame* frames = s_frames.data();
+	computeSweepFrames(path, s_frames.data());
+
+	const u32 n = u32(profile.size());
+	const u32 numSegments = closed ? n : n - 1;
+	addQuadStrips(numSegments, u32(path.size()), [&](u32 s, u32 e, Vert_pos_tc& a, Vert_pos_tc& b) {
+		const u32 s1 = s + 1 == n ? 0 : s + 1;
+		const SweepFrame& f = frames[e];
+		a = {path[e] + profile[s].x * f.normal + profile[s].y * f.binormal, {f.u, float(s) / numSegments}};
+		b = {path[e] + profile[s1].x * f.normal + profile[s1].y * f.binormal, {f.u, float(s + 1) / numSegments}};
+	});
+}
+
+namespace geom_detail
+{
+
+void computeQuadStripNormals(Vert_pos_normal_tc* v, u32 numEdges, u32 from, u32 to)
+{
+	for(u32 e = from; e < to; e++)
+	{
+		const u32 i = 2 * e;
+		const vec3 vm = v[i+1].pos - v[i].pos;
+		vec3 N[2];
+		if(e == 0) { // first edge
+			const vec3 a1 = v[i+2].pos - v[i].pos;
+			const vec3 b1 = v[i+3].pos - v[i+1].pos;
+			N[0] = cross(vm, a1);
+			N[1] = cross(vm, b1);
+		}
+		else if(e == numEdges - 1) { // last edge
+			const vec3 a0 = v[i].pos - v[i-2].pos;
+			const vec3 b0 = v[i+1].pos - v[i-1].pos;
+			N[0] = cross(vm, a0);
+			N[1] = cross(vm, b0);
+		}
+		else { // one edge in the middle
+			const vec3 a0 = v[i].pos - v[i-2].pos;
+			const vec3 b0 = v[i+1].pos - v[i-1].pos;
+			const vec3 a1 = v[i+2].pos - v[i].pos;
+			const vec3 b1 = v[i+3].pos - v[i+1].pos;
+			N[0] = normalize(cross(vm, a0)) + normalize(cross(vm, a1));
+			N[1] = normalize(cross(vm, b0)) + normalize(cross(vm, b1));
+		}
+		v[i+0].normal = normalize(N[0]);
+		v[i+1].normal = normalize(N[1]);
+	}
+}
+
+void writeQuadStripIndices(u32* inds, u32 firstVert, u32 from, u32 to)
+{
+	// one quad between edge e and edge e+1
+	for(u32 e = from; e < to; e++)
+	{
+		const u32 i = 2 * e;
+		inds[3*i + 0] = firstVert + i + 0;
+		inds[3*i + 1] = firstVert + i + 1;
+		inds[3*i + 2] = firstVert + i + 3;
+		inds[3*i + 3] = firstVert + i + 0;
+		inds[3*i + 4] = firstVert + i + 3;
+		inds[3*i + 5] = firstVert + i + 2;
+	}
+}
+
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include "mesh.hpp"
+#include "tl/arena.hpp"
+#include "tl/parallel.hpp"
+
+// A quad strip is given as pairs of vertices, one pair per edge across the strip:
+// v[0]-v[1] is the first edge, v[2]-v[3] the second one...
+
+constexpr u32 quadStripNumVerts(u32 numStripVerts)
+{
+	return numStripVerts;
+}
+
+constexpr u32 quadStripNumInds(u32 numStripVerts)
+{
+	return 3 * (numStripVerts - 2);
+}
+
+// appends meshes to caller-provided memory
+// If arena is set, verts and inds are reallocated from it (twice as big) when they run out of space; the old
+// memory isn't reused, so size the arena for about twice the final mesh
+struct MeshBuilder {
+	tl::Span<Vert_pos_normal_tc> verts; // reserved memory for writing vertices
+	tl::Span<u32> inds; // reserved memory for writing indices
+	u32 numVerts = 0;
+	u32 numInds = 0;
+	tl::Arena* arena = nullptr;
+
+	// makes sure there is room for this many more vertices and indices
+	void reserve(u32 moreVerts, u32 moreInds);
+
+	// the normals are smooth along the strip
+	void addQuadStrip(tl::CSpan<Vert_pos_tc> v);
+
+	// numStrips strips of numEdges edges each, edge(strip, edge, a, b) gives the two vertices of an edge and is
+	// called exactly once per edge. The strips are generated in parallel, so edge() must be thread safe
+	template <typename F>
+	void addQuadStrips(u32 numStrips, u32 numEdges, F&& edge);
+
+	// The operations below emit one strip per segment of the outline or profile, so the normals are smooth
+	// along the strips and hard across them. The texture coords are (distance along the strips in [0, 1],
+	// position in the outline in [0, 1])
+
+	// side walls of a polyline moved by offset
+	void addExtrude(tl::CSpan<vec3> outline, bool closed, vec3 offset);
+	// surface through numSections cross sections of sectionSize points each, stored one after the other
+	void addLoft(tl::CSpan<vec3> sections, u32 sectionSize, bool closed);
+	// 2d profile moved along a path, the profile is in the plane of the path's parallel transport frame
+	// (rotation minimizing), x goes along the frame normal and y along the binormal. A profile that goes
+	// counterclockwise gives outward faces
+	void addSweep(tl::CSpan<vec2> profile, bool closed, tl::CSpan<vec3> path);
+
+	CMeshSpans<Vert_pos_normal_tc> mesh()const { return {{verts.begin(), numVerts}, {inds.begin(), numInds}}; }
+};
+
+// ---------------------------------------------------------------------------------------------
+namespace geom_detail
+{
+	// edges per parallel chunk
+	constexpr u32 QUAD_STRIP_CHUNK = 2048;
+
+	// computes the normals of the edges [from, to) of the strip v with numEdges edges, the positions
+	// must be already written
+	void computeQuadStripNormals(Vert_pos_normal_tc* v, u32 numEdges, u32 from, u32 to);
+	void writeQuadStripIndices(u32* inds, u32 firstVert, u32 from, u32 to);
+}
+
+template <typename F>
+void MeshBuilder::addQuadStrips(u32 numStrips, u32 numEdges, F&& edge)
+{
+	assert(numEdges >= 2);
+	const u32 stripVerts = quadStripNumVerts(2 * numEdges);
+	const u32 stripInds = quadStripNumInds(2 * numEdges);
+	reserve(numStrips * stripVerts, numStrips * stripInds);
+
+	const u32 chunksPerStrip = (numEdges + geom_detail::QUAD_STRIP_CHUNK - 1) / geom_detail::QUAD_STRIP_CHUNK;
+	auto chunkRange = [&](size_t chunk, u32& strip, u32& from, u32& to) {
+		strip = u32(chunk / chunksPerStrip);
+		from = u32(chunk % chunksPerStrip) * geom_detail::QUAD_STRIP_CHUNK;
+		to = std::min(from + geom_detail::QUAD_STRIP_CHUNK, numEdges);
+	};
+	// the normals need the positions of the neighbour edges, so they go in a second pass
+	tl::parallelFor(0, numStrips * chunksPerStrip, 1, [&](size_t chunk) {
+		u32 strip, from, to;
+		chunkRange(chunk, strip, from, to);
+		const u32 firstVert = numVerts + strip * stripVerts;
+		for(u32 e = from; e < to; e++) {
+			Vert_pos_tc a, b;
+			edge(strip, e, a, b);
+			verts[firstVert + 2*e + 0] = {a.pos, vec3(0), a.tc};
+			verts[firstVert + 2*e + 1] = {b.pos, vec3(0), b.tc};
+		}
+		geom_detail::writeQuadStripIndices(inds.begin() + numInds + strip * stripInds, firstVert, from, std::min(to, numEdges - 1));
+	});
+	tl::parallelFor(0, numStrips * chunksPerStrip, 1, [&](size_t chunk) {
+		u32 strip, from, to;
+		chunkRange(chunk, strip, from, to);
+		geom_detail::computeQuadStripNormals(verts.begin() + numVerts + strip * stripVerts, numEdges, from, to);
+	});
+
+	numVerts += numStrips * stripVerts;
+	numInds += numStrips * stripInds;
+}
@@ -0,0 +1,107 @@
+#include "quantize.hpp"
+
+#include <float.h>
+#include <math.h>
+#include "tl/parallel.hpp"
+
+namespace
+{
+
+constexpr u32 QUANTIZE_CHUNK = 4096;
+constexpr u32 MAX_RANGES = 256; // the partial stats of the ranges, merged in order so the result is deterministic
+
+struct PartialStats {
+	float maxPos2;
+	double sumPos2;
+};
+
+inline vec3 getPos(const vec3* positions, size_t stride, u32 i)
+{
+	return *(const vec3*)((const u8*)positions + i * stride);
+}
+
+inline u16 quantizeUnorm16(float x)
+{
+	return u16(glm::clamp(x, 0.f, 1.f) * 65535.f + 0.5f);
+}
+
+void quantizePosition(const PositionQuantization& quantization, vec3 invScale, vec3 p, u16* q, PartialStats& stats)
+{
+	const vec3 t = (p - quantization.offset) * invScale;
+	for(int k = 0; k < 3; k++)
+		q[k] = quantizeUnorm16(t[k]);
+	const vec3 d = dequantizePosition(quantization, q) - p;
+	const float d2 = glm::dot(d, d);
+	stats.maxPos2 = glm::max(stats.maxPos2, d2);
+	stats.sumPos2 += d2;
+}
+
+vec3 getInvScale(const PositionQuantization& quantization)
+{
+	vec3 inv;
+	for(int k = 0; k < 3; k++)
+		inv[k] = quantization.scale[k] > 0 ? 1 / quantization.scale[k] : 0;
+	return inv;
+}
+
+// f(i, stats) quantizes the vertex i and adds its errors to stats
+template <typename F>
+QuantizationStats quantizeRanges(u32 numVerts, F&& f)
+{
+	PartialStats partials[MAX_RANGES];
+	const u32 grainSize = glm::max(QUANTIZE_CHUNK, (numVerts + MAX_RANGES - 1) / MAX_RANGES);
+	const u32 numRanges = (numVerts + grainSize - 1) / grainSize;
+	tl::parallelForRanges(0, numVerts, grainSize, [&](size_t from, size_t to) {
+		PartialStats stats = {0, 0};
+		for(u32 i = u32(from); i < u32(to); i++)
+			f(i, stats);
+		partials[from / grainSize] = stats;
+	});
+
+	PartialStats total = {0, 0};
+	for(u32 r = 0; r < numRanges; r++) {
+		total.maxPos2 = glm::max(total.maxPos2, partials[r].maxPos2);
+		total.sumPos2 += partials[r].sumPos2;
+	}
+	QuantizationStats stats;
+	stats.maxPosError = sqrtf(total.maxPos2);
+	stats.rmsPosError = numVerts ? float(sqrt(total.sumPos2 / numVerts)) : 0;
+	return stats;
+}
+
+}
+
+PositionQuantization getPositionQuantization(const vec3* positions, size_t positionStride, u32 numVerts)
+{
+	vec3 lo(FLT_MAX), hi(-FLT_MAX);
+	for(u32 i = 0; i < numVerts; i++) {
+		lo = glm::min(lo, getPos(positions, positionStride, i));
+		hi = glm::max(hi, getPos(positions, positionStride, i));
+	}
+	if(numVerts == 0)
+		return {vec3(0), vec3(0)};
+	return {lo, hi - lo};
+}
+
+mat4 getDequantizationMatrix(const PositionQuantization& quantization)
+{
+	mat4 m(1);
+	for(int k = 0; k < 3; k++)
+		m[k][k] = quantization.scale[k];
+	m[3] = vec4(quantization.offset, 1);
+	return m;
+}
+
+vec3 dequantizePosition(const PositionQuantization& quantization, const u16* q)
+{
+	return quantization.offset + quantization.scale * (vec3(q[0], q[1], q[2]) * (1.f / 65535));
+}
+
+QuantizationStats quantizePositions(const vec3* positions, size_t positionStride, u32 numVerts,
+	const PositionQuantization& quantization, u16* dst, size_t dstStride)
+{
+	const vec3 invScale = getInvScale(quantization);
+	return quantizeRanges(numVerts, [&](u32 i, PartialStats& stats) {
+		quantizePosition(quantization, invScale, getPos(positions, positionStride, i), (u16*)((u8*)dst + i * dstStride), stats);
+	});
+}
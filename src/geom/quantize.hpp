@@ -0,0 +1,35 @@
+#pragma once
+
+#include "mesh.hpp"
+
+// Compact positions for the GPU: 16 bit unsigned normalized coords in the bounding box of the mesh. Their decode
+// is a scale and an offset, which goes into the model matrix, so the vertex shader reads them with the GL
+// normalization (GL_UNSIGNED_SHORT, normalized) and the matrix it already applies does the rest
+// The retained meshes only have positions, the normals and texture coords would need their own shader decode
+// The errors against the float positions are measured while quantizing, nothing is allocated
+
+// pos = offset + scale * q / 65535
+struct PositionQuantization {
+	vec3 offset, scale;
+};
+
+// 4 u16 per position, the last one is padding: GL wants the attributes 4 byte aligned
+struct QuantizedVert_pos {
+	u16 pos[4];
+};
+
+struct QuantizationStats {
+	float maxPosError, rmsPosError; // in the units of the positions
+};
+
+// the bounding box of the positions
+PositionQuantization getPositionQuantization(const vec3* positions, size_t positionStride, u32 numVerts);
+
+// the matrix that turns the normalized coords ([0, 1] after the GL normalization) into positions
+mat4 getDequantizationMatrix(const PositionQuantization& quantization);
+
+vec3 dequantizePosition(const PositionQuantization& quantization, const u16* q);
+
+// the positions go to dst, 3 u16 each, dstStride bytes apart
+QuantizationStats quantizePositions(const vec3* positions, size_t positionStride, u32 numVerts,
+	const PositionQuantization& quantization, u16* dst, size_t dstStride);
@@ -0,0 +1,230 @@
+#include "simplify.hpp"
+
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+using geom_detail::Quadric;
+using geom_detail::EdgeCollapse;
+
+namespace
+{
+
+inline vec3 getPos(const vec3* positions, size_t stride, u32 i)
+{
+	return *(const vec3*)((const u8*)positions + i * stride);
+}
+
+void addPlane(Quadric& q, vec3 n, float d, float w)
+{
+	q.a00 += w * n.x * n.x; q.a01 += w * n.x * n.y; q.a02 += w * n.x * n.z;
+	q.a11 += w * n.y * n.y; q.a12 += w * n.y * n.z;
+	q.a22 += w * n.z * n.z;
+	q.b0 += w * d * n.x; q.b1 += w * d * n.y; q.b2 += w * d * n.z;
+	q.c += w * d * d;
+	q.w += w;
+}
+
+void addQuadric(Quadric& q, const Quadric& o)
+{
+	q.a00 += o.a00; q.a01 += o.a01; q.a02 += o.a02;
+	q.a11 += o.a11; q.a12 += o.a12;
+	q.a22 += o.a22;
+	q.b0 += o.b0; q.b1 += o.b1; q.b2 += o.b2;
+	q.c += o.c;
+	q.w += o.w;
+}
+
+// the sum of the area weighted squared distances of p to the planes of q and o
+double evaluate(const Quadric& q, const Quadric& o, vec3 p)
+{
+	const double x = p.x, y = p.y, z = p.z;
+	const double e =
+		(q.a00 + o.a00) * x * x + 2 * (q.a01 + o.a01) * x * y + 2 * (q.a02 + o.a02) * x * z +
+		(q.a11 + o.a11) * y * y + 2 * (q.a12 + o.a12) * y * z +
+		(q.a22 + o.a22) * z * z +
+		2 * ((q.b0 + o.b0) * x + (q.b1 + o.b1) * y + (q.b2 + o.b2) * z) +
+		(q.c + o.c);
+	return e > 0 ? e : 0; // rounding
+}
+
+void buildVertexTriangles(tl::CSpan<u32> inds, u32 numVerts, u32* offsets, u32* vertTris)
+{
+	memset(offsets, 0, (numVerts + 1) * sizeof(u32));
+	for(u32 v : inds)
+		offsets[v + 1]++;
+	for(u32 v = 0; v < numVerts; v++)
+		offsets[v + 1] += offsets[v];
+	for(u32 i = 0; i < inds.size(); i++)
+		vertTris[offsets[inds[i]]++] = i / 3;
+	for(u32 v = numVerts; v > 0; v--) // the fill moved every offset to the next vertex
+		offsets[v] = offsets[v - 1];
+	offsets[0] = 0;
+}
+
+struct Mesh {
+	const vec3* positions;
+	size_t stride;
+	const u32* inds;
+	const u32* offsets;
+	const u32* vertTris;
+};
+
+// the distinct vertices of the triangles around v, except v, up to maxNeighbours
+// returns maxNeighbours + 1 if there are more
+u32 getNeighbours(const Mesh& m, u32 v, u32* neighbours, u32 maxNeighbours)
+{
+	u32 n = 0;
+	for(u32 i = m.offsets[v]; i < m.offsets[v + 1]; i++) {
+		const u32* tri = m.inds + 3 * m.vertTris[i];
+		for(int k = 0; k < 3; k++) {
+			const u32 w = tri[k];
+			if(w == v || std::find(neighbours, neighbours + n, w) != neighbours + n)
+				continue;
+			if(n == maxNeighbours)
+				return maxNeighbours + 1;
+			neighbours[n++] = w;
+		}
+	}
+	return n;
+}
+
+bool canCollapse(const Mesh& m, u32 from, u32 to)
+{
+	// link condition: an interior edge has exactly 2 vertices connected to both ends, more would pinch the
+	// surface into a non manifold edge
+	constexpr u32 MAX_NEIGHBOURS = 32;
+	u32 fromNeighbours[MAX_NEIGHBOURS], toNeighbours[MAX_NEIGHBOURS];
+	const u32 numFrom = getNeighbours(m, from, fromNeighbours, MAX_NEIGHBOURS);
+	const u32 numTo = getNeighbours(m, to, toNeighbours, MAX_NEIGHBOURS);
+	if(numFrom > MAX_NEIGHBOURS || numTo > MAX_NEIGHBOURS)
+		return false;
+	u32 numShared = 0;
+	for(u32 i = 0; i < numFrom; i++)
+		numShared += std::find(toNeighbours, toNeighbours + numTo, fromNeighbours[i]) != toNeighbours + numTo;
+	if(numShared != 2)
+		return false;
+
+	// the triangles that survive must keep facing about the same side, a bigger turn is a fold or a sliver
+	const vec3 pTo = getPos(m.positions, m.stride, to);
+	for(u32 i = m.offsets[from]; i < m.offsets[from + 1]; i++) {
+		const u32* tri = m.inds + 3 * m.vertTris[i];
+		if(tri[0] == to || tri[1] == to || tri[2] == to)
+			continue;
+		vec3 p[3];
+		for(int k = 0; k < 3; k++)
+			p[k] = getPos(m.positions, m.stride, tri[k]);
+		const vec3 n0 = glm::cross(p[1] - p[0], p[2] - p[0]);
+		for(int k = 0; k < 3; k++)
+			if(tri[k] == from)
+				p[k] = pTo;
+		const vec3 n1 = glm::cross(p[1] - p[0], p[2] - p[0]);
+		if(glm::dot(n0, n1) <= 0.25f * glm::length(n0) * glm::length(n1))
+			return false;
+	}
+	return true;
+}
+
+}
+
+u32 simplifyMesh(tl::Arena& scratch, const vec3* positions, size_t positionStride, u32 numVerts, tl::CSpan<u32> inds,
+	u32 targetNumInds, tl::Span<u32> dst, float* error)
+{
+	assert(inds.size() % 3 == 0);
+	assert(dst.size() >= inds.size());
+	Quadric* quadrics = scratch.alloc<Quadric>(numVerts).begin();
+	u32* offsets = scratch.alloc<u32>(numVerts + 1).begin();
+	u32* vertTris = scratch.alloc<u32>(inds.size()).begin();
+	u32* remap = scratch.alloc<u32>(numVerts).begin();
+	u8* locked = scratch.alloc<u8>(numVerts).begin();
+	u8* touched = scratch.alloc<u8>(numVerts).begin();
+	EdgeCollapse* collapses = scratch.alloc<EdgeCollapse>(inds.size()).begin();
+
+	memset(quadrics, 0, numVerts * sizeof(Quadric));
+	for(size_t i = 0; i < inds.size(); i += 3) {
+		const vec3 p0 = getPos(positions, positionStride, inds[i]);
+		const vec3 p1 = getPos(positions, positionStride, inds[i + 1]);
+		const vec3 p2 = getPos(positions, positionStride, inds[i + 2]);
+		const vec3 c = glm::cross(p1 - p0, p2 - p0);
+		const float l = glm::length(c);
+		if(l == 0)
+			continue;
+		const vec3 n = c / l;
+		for(int k = 0; k < 3; k++)
+			addPlane(quadrics[inds[i + k]], n, -glm::dot(n, p0), 0.5f * l);
+	}
+
+	// the ends of the edges without an opposite half edge are locked
+	buildVertexTriangles(inds, numVerts, offsets, vertTris);
+	memset(locked, 0, numVerts);
+	for(u32 i = 0; i < inds.size(); i++) {
+		const u32 a = inds[i], b = inds[i - i % 3 + (i + 1) % 3];
+		bool opposite = false;
+		for(u32 j = offsets[b]; j < offsets[b + 1] && !opposite; j++) {
+			const u32* tri = inds.begin() + 3 * vertTris[j];
+			opposite = (tri[0] == b && tri[1] == a) || (tri[1] == b && tri[2] == a) || (tri[2] == b && tri[0] == a);
+		}
+		if(!opposite)
+			locked[a] = locked[b] = 1;
+	}
+
+	memcpy(dst.begin(), inds.begin(), inds.size() * sizeof(u32));
+	u32 numInds = u32(inds.size());
+	double maxError = 0;
+	const Mesh m = {positions, positionStride, dst.begin(), offsets, vertTris};
+	while(numInds > targetNumInds) {
+		buildVertexTriangles({dst.begin(), numInds}, numVerts, offsets, vertTris);
+
+		// every interior edge appears once as a < b, the boundary edges are locked anyway
+		u32 numCollapses = 0;
+		for(u32 i = 0; i < numInds; i++) {
+			const u32 a = dst[i], b = dst[i - i % 3 + (i + 1) % 3];
+			if(a > b || (locked[a] && locked[b]))
+				continue;
+			const double costAB = locked[a] ? 1e300 : evaluate(quadrics[a], quadrics[b], getPos(positions, positionStride, b));
+			const double costBA = locked[b] ? 1e300 : evaluate(quadrics[a], quadrics[b], getPos(positions, positionStride, a));
+			collapses[numCollapses++] = costAB <= costBA ? EdgeCollapse{a, b, float(costAB)} : EdgeCollapse{b, a, float(costBA)};
+		}
+		std::sort(collapses, collapses + numCollapses, [](const EdgeCollapse& x, const EdgeCollapse& y) { return x.cost < y.cost; });
+
+		// each collapse removes 2 triangles. The neighbourhood of a collapse is touched so the others of the
+		// pass see the triangles they were evaluated on
+		const u32 numNeeded = (numInds - targetNumInds + 5) / 6;
+		u32 numDone = 0;
+		memset(touched, 0, numVerts);
+		for(u32 v = 0; v < numVerts; v++)
+			remap[v] = v;
+		for(u32 i = 0; i < numCollapses && numDone < numNeeded; i++) {
+			const EdgeCollapse c = collapses[i];
+			if(touched[c.from] || touched[c.to] || !canCollapse(m, c.from, c.to))
+				continue;
+			for(u32 v : {c.from, c.to})
+				for(u32 j = offsets[v]; j < offsets[v + 1]; j++)
+					for(int k = 0; k < 3; k++)
+						touched[dst[3 * vertTris[j] + k]] = 1;
+			const double w = quadrics[c.from].w + quadrics[c.to].w;
+			if(w > 0)
+				maxError = std::max(maxError, double(c.cost) / w);
+			addQuadric(quadrics[c.to], quadrics[c.from]);
+			remap[c.from] = c.to;
+			numDone++;
+		}
+		if(numDone == 0)
+			break;
+
+		u32 n = 0;
+		for(u32 i = 0; i < numInds; i += 3) {
+			const u32 a = remap[dst[i]], b = remap[dst[i + 1]], c = remap[dst[i + 2]];
+			if(a == b || b == c || a == c)
+				continue;
+			dst[n++] = a;
+			dst[n++] = b;
+			dst[n++] = c;
+		}
+		numInds = n;
+	}
+
+	if(error)
+		*error = float(sqrt(maxError));
+	return numInds;
+}
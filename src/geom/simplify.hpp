@@ -0,0 +1,47 @@
+#pragma once
+
+#include "mesh.hpp"
+#include "tl/arena.hpp"
+
+// Mesh simplification by edge collapses ordered by the quadric error metric (Garland and Heckbert)
+// Every vertex accumulates the area weighted planes of its triangles, collapsing the edge a -> b costs the
+// squared distance of b to the planes of both. The vertices never move: a collapse keeps one of the two
+// vertices of the edge, so the simplified index buffers index the original vertices and the LODs of a mesh
+// can share its vertex buffer
+// Each pass sorts the edges by cost and collapses the cheapest ones whose neighbourhoods don't overlap. A
+// collapse is rejected if it flips a triangle or breaks the manifold (the link condition). The boundary
+// vertices, which include the seams where vertices are duplicated, are kept
+// The scratch memory comes from an arena, size it with simplifyArenaBytes()
+
+namespace geom_detail
+{
+// v^T A v + 2 b.v + c, with the sum of the areas in w
+struct Quadric {
+	double a00, a01, a02, a11, a12, a22;
+	double b0, b1, b2;
+	double c;
+	double w;
+};
+struct EdgeCollapse {
+	u32 from, to;
+	float cost;
+};
+}
+
+constexpr size_t simplifyArenaBytes(u32 numVerts, u32 numInds)
+{
+	return
+		tl::Arena::bytesFor<geom_detail::Quadric>(numVerts) +
+		tl::Arena::bytesFor<u32>(numVerts + 1) + // vertex -> triangles offsets
+		tl::Arena::bytesFor<u32>(numInds) + // vertex -> triangles
+		tl::Arena::bytesFor<u32>(numVerts) + // remap of the collapsed vertices
+		tl::Arena::bytesFor<u8>(numVerts) + // locked vertices
+		tl::Arena::bytesFor<u8>(numVerts) + // vertices touched by the current pass
+		tl::Arena::bytesFor<geom_detail::EdgeCollapse>(numInds);
+}
+
+// Writes to dst (dst.size() >= inds.size()) a mesh of at most targetNumInds indices, or as close as the
+// collapses allow, and returns its number of indices
+// The error is the RMS distance of the worst collapse to the planes it removed, in the units of the positions
+u32 simplifyMesh(tl::Arena& scratch, const vec3* positions, size_t positionStride, u32 numVerts, tl::CSpan<u32> inds,
+	u32 targetNumInds, tl::Span<u32> dst, float* error = nullptr);
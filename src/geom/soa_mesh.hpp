@@ -0,0 +1,140 @@
+#pragma once
+
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include "mesh.hpp"
+#include "tl/strided_span.hpp"
+
+// Meshes stored as a structure of arrays: one contiguous stream per attribute, e.g.
+//     SoaMesh<Attrib_pos, Attrib_normal> mesh;
+//     computeVertexNormals(scratch, mesh.view<Attrib_pos>(), mesh.indSpan(), mesh.view<Attrib_normal>());
+// The kernels that take tl::StridedSpan views accept the streams of a SoaMesh and the members of the vertex
+// structs (attribView<Attrib_pos>(verts)) alike, without copying. Copying between the layouts is only needed
+// to keep one, see assignFrom() and copyTo()
+
+// an attribute: its type and the member of the vertex structs that has it
+struct Attrib_pos {
+	using Type = vec3;
+	template <typename V> static auto member() { return &V::pos; }
+};
+
+struct Attrib_normal {
+	using Type = vec3;
+	template <typename V> static auto member() { return &V::normal; }
+};
+
+struct Attrib_tc {
+	using Type = vec2;
+	template <typename V> static auto member() { return &V::tc; }
+};
+
+// the attribute A of the vertex structs, in place
+template <typename A, typename V>
+tl::StridedSpan<typename A::Type> attribView(tl::Span<V> verts)
+{
+	return tl::stridedMember(verts, A::template member<V>());
+}
+
+template <typename A, typename V>
+tl::CStridedSpan<typename A::Type> attribView(tl::CSpan<V> verts)
+{
+	return tl::stridedMember(verts, A::template member<V>());
+}
+
+template <typename... Attribs>
+class SoaMesh {
+public:
+	std::vector<u32> inds; // triangle list
+
+	u32 numVerts()const { return _numVerts; }
+	void resize(u32 numVerts);
+
+	template <typename A> tl::Span<typename A::Type> stream();
+	template <typename A> tl::CSpan<typename A::Type> stream()const;
+	template <typename A> tl::StridedSpan<typename A::Type> view() { return stream<A>(); }
+	template <typename A> tl::CStridedSpan<typename A::Type> view()const { return stream<A>(); }
+	tl::Span<u32> indSpan() { return { inds.data(), inds.size() }; }
+	tl::CSpan<u32> indSpan()const { return { inds.data(), inds.size() }; }
+
+	// the vertex structs need a member for each attribute
+	template <typename V> void assignFrom(CMeshSpans<V> mesh);
+	template <typename V> void copyTo(tl::Span<V> verts)const;
+
+private:
+	template <typename A> std::vector<typename A::Type>& get();
+	template <typename A> const std::vector<typename A::Type>& get()const;
+
+	u32 _numVerts = 0;
+	std::tuple<std::vector<typename Attribs::Type>...> _streams;
+};
+
+// ---------------------------------------------------------------------------------------------
+namespace geom_detail
+{
+	// the position of A in As, the streams are found by their attribute and not by their type
+	template <typename A, typename... As>
+	struct AttribIndex;
+
+	template <typename A, typename... As>
+	struct AttribIndex<A, A, As...> : std::integral_constant<size_t, 0> {};
+
+	template <typename A, typename B, typename... As>
+	struct AttribIndex<A, B, As...> : std::integral_constant<size_t, 1 + AttribIndex<A, As...>::value> {};
+}
+
+template <typename... Attribs>
+template <typename A>
+std::vector<typename A::Type>& SoaMesh<Attribs...>::get()
+{
+	return std::get<geom_detail::AttribIndex<A, Attribs...>::value>(_streams);
+}
+
+template <typename... Attribs>
+template <typename A>
+const std::vector<typename A::Type>& SoaMesh<Attribs...>::get()const
+{
+	return std::get<geom_detail::AttribIndex<A, Attribs...>::value>(_streams);
+}
+
+template <typename... Attribs>
+void SoaMesh<Attribs...>::resize(u32 numVerts)
+{
+	_numVerts = numVerts;
+	(get<Attribs>().resize(numVerts), ...);
+}
+
+template <typename... Attribs>
+template <typename A>
+tl::Span<typename A::Type> SoaMesh<Attribs...>::stream()
+{
+	std::vector<typename A::Type>& s = get<A>();
+	return { s.data(), s.size() };
+}
+
+template <typename... Attribs>
+template <typename A>
+tl::CSpan<typename A::Type> SoaMesh<Attribs...>::stream()const
+{
+	const std::vector<typename A::Type>& s = get<A>();
+	return { s.data(), s.size() };
+}
+
+template <typename... Attribs>
+template <typename V>
+void SoaMesh<Attribs...>::assignFrom(CMeshSpans<V> mesh)
+{
+	resize(u32(mesh.verts.size()));
+	inds.assign(mesh.inds.begin(), mesh.inds.end());
+	for(u32 i = 0; i < _numVerts; i++)
+		((get<Attribs>()[i] = mesh.verts[i].*(Attribs::template member<V>())), ...);
+}
+
+template <typename... Attribs>
+template <typename V>
+void SoaMesh<Attribs...>::copyTo(tl::Span<V> verts)const
+{
+	assert(verts.size() == _numVerts);
+	for(u32 i = 0; i < _numVerts; i++)
+		((verts[i].*(Attribs::template member<V>()) = get<Attribs>()[i]), ...);
+}
@@ -0,0 +1,171 @@
+#include "strips.hpp"
+
+#include <string.h>
+
+namespace
+{
+
+struct Adjacency {
+	tl::Span<u32> offsets, vertTris, neighbours;
+};
+
+// neighbours[3*t + k] is the triangle that has the edge k of t (from corner k to k+1) in the opposite
+// direction, or ~0u
+Adjacency computeAdjacency(tl::Arena& scratch, tl::CSpan<u32> inds, u32 numVerts)
+{
+	Adjacency adj;
+	adj.offsets = scratch.alloc<u32>(numVerts + 1);
+	adj.vertTris = scratch.alloc<u32>(inds.size());
+	adj.neighbours = scratch.alloc<u32>(inds.size());
+
+	memset(adj.offsets.begin(), 0, (numVerts + 1) * sizeof(u32));
+	for(u32 v : inds)
+		adj.offsets[v + 1]++;
+	for(u32 v = 0; v < numVerts; v++)
+		adj.offsets[v + 1] += adj.offsets[v];
+	for(u32 i = 0; i < inds.size(); i++)
+		adj.vertTris[adj.offsets[inds[i]]++] = i / 3;
+	for(u32 v = numVerts; v > 0; v--) // the fill moved every offset to the next vertex
+		adj.offsets[v] = adj.offsets[v - 1];
+	adj.offsets[0] = 0;
+
+	for(u32 i = 0; i < inds.size(); i++) {
+		const u32 t = i / 3;
+		const u32 a = inds[i], b = inds[3*t + (i + 1) % 3];
+		adj.neighbours[i] = ~0u;
+		for(u32 j = adj.offsets[b]; j < adj.offsets[b + 1]; j++) {
+			const u32 n = adj.vertTris[j];
+			if(n == t)
+				continue;
+			const u32* tri = inds.begin() + 3 * n;
+			if((tri[0] == b && tri[1] == a) || (tri[1] == b && tri[2] == a) || (tri[2] == b && tri[0] == a)) {
+				adj.neighbours[i] = n;
+				break;
+			}
+		}
+	}
+	return adj;
+}
+
+inline u32 thirdVertex(const u32* tri, u32 u, u32 w)
+{
+	for(int k = 0; k < 3; k++)
+		if(tri[k] != u && tri[k] != w)
+			return tri[k];
+	return tri[0]; // degenerate triangle
+}
+
+// Walks the strip that starts at the triangle start rotated by rot, calling emit() with every vertex, and
+// returns the number of triangles. Triangle i of a strip is (s[i], s[i+1], s[i+2]) for even i and
+// (s[i+1], s[i], s[i+2]) for odd i. The odd strips begin with a repeated vertex, so the first real triangle
+// is odd and the strip zigzags the other way
+// The triangles go to taken[] as taken, the ones that are taken already are skipped
+template <typename Emit>
+u32 walkStrip(tl::CSpan<u32> inds, const Adjacency& adj, u32* taken, u32 stamp, u32 start, u32 window, int rot, bool odd, Emit emit)
+{
+	const u32* tri = inds.begin() + 3 * start;
+	const u32 a = tri[rot], b = tri[(rot + 1) % 3], c = tri[(rot + 2) % 3];
+	u32 s0, s1;
+	if(odd) {
+		emit(b); emit(b); emit(a); emit(c);
+		s0 = a; s1 = c;
+	}
+	else {
+		emit(a); emit(b); emit(c);
+		s0 = b; s1 = c;
+	}
+	taken[start] = stamp;
+
+	u32 numTris = 1;
+	u32 last = start;
+	for(u32 i = odd ? 2 : 1; ; i++) {
+		// the next triangle has the edge between the last two vertices in the direction that keeps the
+		// winding, in the last triangle that edge goes the other way
+		const u32 u = i % 2 ? s0 : s1, w = i % 2 ? s1 : s0;
+		u32 next = ~0u;
+		for(int k = 0; k < 3; k++)
+			if(inds[3*last + k] == u && inds[3*last + (k + 1) % 3] == w)
+				next = adj.neighbours[3*last + k];
+		if(next == ~0u || next - start >= window || taken[next] >= stamp)
+			break;
+		const u32 x = thirdVertex(inds.begin() + 3 * next, s0, s1);
+		emit(x);
+		taken[next] = stamp;
+		s0 = s1;
+		s1 = x;
+		last = next;
+		numTris++;
+	}
+	return numTris;
+}
+
+}
+
+u32 stripify(tl::Arena& scratch, tl::CSpan<u32> inds, u32 numVerts, tl::Span<u32> strip, u32 window)
+{
+	assert(inds.size() % 3 == 0);
+	assert(strip.size() >= stripifyMaxInds(inds.size()));
+	const u32 numTris = u32(inds.size() / 3);
+	const Adjacency adj = computeAdjacency(scratch, inds, numVerts);
+	// TAKEN for the triangles in the strips, the trial number for the ones that a trial walk went through
+	constexpr u32 TAKEN = ~0u;
+	u32* taken = scratch.alloc<u32>(numTris).begin();
+	memset(taken, 0, numTris * sizeof(u32));
+
+	u32 n = 0;
+	u32 trial = 0;
+	for(u32 start = 0; start < numTris; start++) {
+		if(taken[start] == TAKEN)
+			continue;
+		// the longest of the 3 rotations with both parities, an odd strip costs one more index
+		int bestRot = 0;
+		bool bestOdd = false;
+		u32 bestLen = 0;
+		for(int odd = 0; odd < 2; odd++)
+		for(int rot = 0; rot < 3; rot++) {
+			trial++;
+			assert(trial < TAKEN);
+			const u32 len = walkStrip(inds, adj, taken, trial, start, window, rot, odd, [](u32) {});
+			if(len > bestLen + odd) {
+				bestLen = len;
+				bestRot = rot;
+				bestOdd = odd;
+			}
+		}
+		if(n)
+			strip[n++] = STRIP_RESTART_INDEX;
+		walkStrip(inds, adj, taken, TAKEN, start, window, bestRot, bestOdd, [&](u32 v) { strip[n++] = v; });
+	}
+	return n;
+}
+
+u32 unstripify(tl::CSpan<u32> strip, tl::Span<u32> list)
+{
+	u32 n = 0;
+	u32 first = 0; // of the current strip
+	for(u32 i = 0; i < strip.size(); i++) {
+		if(strip[i] == STRIP_RESTART_INDEX) {
+			first = i + 1;
+			continue;
+		}
+		if(i < first + 2)
+			continue;
+		const u32 k = i - 2 - first; // triangle index in the strip
+		const u32 a = strip[i - 2], b = strip[i - 1], c = strip[i];
+		if(a == b || b == c || a == c)
+			continue; // degenerate
+		list[n++] = k % 2 ? b : a;
+		list[n++] = k % 2 ? a : b;
+		list[n++] = c;
+	}
+	return n;
+}
+
+void copyIndicesU16(tl::Span<u16> dst, tl::CSpan<u32> src)
+{
+	assert(dst.size() == src.size());
+	for(size_t i = 0; i < src.size(); i++) {
+		assert(src[i] == STRIP_RESTART_INDEX || src[i] < 0xFFFF);
+		dst[i] = u16(src[i]);
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "mesh.hpp"
+#include "tl/arena.hpp"
+
+// Triangle lists to triangle strips, joined with primitive restart (glPrimitiveRestartIndex, GL 3.1)
+// Every strip starts at the first unused triangle in the list order and grows greedily through the
+// neighbour across the edge the strip order requires, so the winding is kept. Of the 3 rotations of the first
+// triangle and the 2 directions of the zigzag we keep the longest strip. In the generation order quad strips
+// and grids become one strip per row, about 1 index per triangle instead of 3
+// The scratch memory comes from an arena, size it with stripifyArenaBytes()
+
+constexpr u32 STRIP_RESTART_INDEX = ~0u;
+
+// the worst case: every triangle is its own strip
+constexpr u32 stripifyMaxInds(u32 numInds)
+{
+	return numInds / 3 * 4;
+}
+
+constexpr size_t stripifyArenaBytes(u32 numVerts, u32 numInds)
+{
+	return
+		tl::Arena::bytesFor<u32>(numVerts + 1) + // vertex -> triangles offsets
+		tl::Arena::bytesFor<u32>(numInds) + // vertex -> triangles
+		tl::Arena::bytesFor<u32>(numInds) + // neighbour across each edge
+		tl::Arena::bytesFor<u32>(numInds / 3); // taken triangles
+}
+
+// writes the strips separated by STRIP_RESTART_INDEX to strip, which needs stripifyMaxInds() entries,
+// and returns the number of indices written
+// A strip only takes the triangles that are less than window after its first one in the list, so the strips keep
+// the vertex cache order of the list: 16 costs a few % of ACMR on the Forsyth order and takes ~1.8 indices per
+// triangle, ~0u gives the longest strips (~1 index per triangle on grids) but the ACMR goes to ~1
+constexpr u32 STRIP_WINDOW = 16;
+u32 stripify(tl::Arena& scratch, tl::CSpan<u32> inds, u32 numVerts, tl::Span<u32> strip, u32 window = STRIP_WINDOW);
+
+// the triangles of a strip as a list, e.g. to check it or to compute its vertex cache stats
+// the degenerate triangles are skipped, list needs room for the rest, returns the number of indices written
+u32 unstripify(tl::CSpan<u32> strip, tl::Span<u32> list);
+
+// u16 indices halve the index memory when there are less than 65535 vertices (0xFFFF is the restart index)
+constexpr bool fitsU16Indices(u32 numVerts)
+{
+	return numVerts < 0xFFFF;
+}
+
+// STRIP_RESTART_INDEX becomes 0xFFFF
+void copyIndicesU16(tl::Span<u16> dst, tl::CSpan<u32> src);
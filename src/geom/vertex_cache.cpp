@@ -0,0 +1,174 @@
+#include "vertex_cache.hpp"
+
+#include <math.h>
+#include <string.h>
+
+VertexCacheStats computeVertexCacheStats(tl::Arena& scratch, tl::CSpan<u32> inds, u32 numVerts, u32 cacheSize)
+{
+	// a vertex is in the cache if it was loaded less than cacheSize misses ago
+	tl::Span<u32> loadTime = scratch.alloc<u32>(numVerts);
+	memset(loadTime.begin(), 0, numVerts * sizeof(u32)); // 0 is never loaded
+	u32 numMisses = 0;
+	u32 numUsed = 0;
+	for(u32 v : inds) {
+		if(loadTime[v] == 0)
+			numUsed++;
+		if(loadTime[v] == 0 || numMisses + 1 - loadTime[v] > cacheSize) {
+			numMisses++;
+			loadTime[v] = numMisses;
+		}
+	}
+	VertexCacheStats stats;
+	stats.numTransforms = numMisses;
+	stats.acmr = inds.size() ? float(numMisses) / (inds.size() / 3) : 0;
+	stats.atvr = numUsed ? float(numMisses) / numUsed : 0;
+	return stats;
+}
+
+namespace
+{
+
+constexpr u32 MAX_VALENCE_SCORE = 32;
+
+struct ScoreTables {
+	float cache[VERTEX_CACHE_SIZE];
+	float valence[MAX_VALENCE_SCORE];
+
+	ScoreTables()
+	{
+		// the constants of the paper
+		for(u32 i = 0; i < VERTEX_CACHE_SIZE; i++) {
+			if(i < 3)
+				cache[i] = 0.75f; // the vertices of the last triangle, we don't want to use them right away
+			else
+				cache[i] = powf(1 - float(i - 3) / (VERTEX_CACHE_SIZE - 3), 1.5f);
+		}
+		for(u32 i = 0; i < MAX_VALENCE_SCORE; i++)
+			valence[i] = i ? 2 / sqrtf(float(i)) : 0;
+	}
+};
+
+const ScoreTables s_scores;
+
+inline float vertexScore(i32 cachePos, u32 valence)
+{
+	if(valence == 0)
+		return -1; // no triangles left, it doesn't matter anymore
+	const float v = valence < MAX_VALENCE_SCORE ? s_scores.valence[valence] : 2 / sqrtf(float(valence));
+	return v + (cachePos >= 0 ? s_scores.cache[cachePos] : 0);
+}
+
+}
+
+void optimizeVertexCache(tl::Arena& scratch, tl::Span<u32> inds, u32 numVerts)
+{
+	assert(inds.size() % 3 == 0);
+	const u32 numTris = u32(inds.size() / 3);
+	if(numTris == 0)
+		return;
+
+	tl::Span<u32> valence = scratch.alloc<u32>(numVerts);
+	tl::Span<u32> offsets = scratch.alloc<u32>(numVerts + 1);
+	tl::Span<u32> vertTris = scratch.alloc<u32>(inds.size());
+	tl::Span<float> vertScore = scratch.alloc<float>(numVerts);
+	tl::Span<i32> cachePos = scratch.alloc<i32>(numVerts);
+	tl::Span<float> triScore = scratch.alloc<float>(numTris);
+	tl::Span<u32> out = scratch.alloc<u32>(inds.size());
+
+	// the triangles of every vertex, valence[v] is how many of them are not emitted yet and they are
+	// kept at the start of the vertex's range
+	memset(valence.begin(), 0, numVerts * sizeof(u32));
+	for(u32 v : inds)
+		valence[v]++;
+	u32 sum = 0;
+	for(u32 v = 0; v < numVerts; v++) {
+		offsets[v] = sum;
+		sum += valence[v];
+		valence[v] = 0;
+	}
+	offsets[numVerts] = sum;
+	for(u32 i = 0; i < inds.size(); i++) {
+		const u32 v = inds[i];
+		vertTris[offsets[v] + valence[v]++] = i / 3;
+	}
+
+	for(u32 v = 0; v < numVerts; v++) {
+		cachePos[v] = -1;
+		vertScore[v] = vertexScore(-1, valence[v]);
+	}
+	u32 bestTri = 0;
+	for(u32 t = 0; t < numTris; t++) {
+		triScore[t] = vertScore[inds[3*t]] + vertScore[inds[3*t+1]] + vertScore[inds[3*t+2]];
+		if(triScore[t] > triScore[bestTri])
+			bestTri = t;
+	}
+
+	u32 cache[VERTEX_CACHE_SIZE + 3];
+	u32 cacheSize = 0;
+	u32 nextScan = 0; // when no triangle touches the cache we take the next one in the original order
+	for(u32 i = 0; i < numTris; i++) {
+		if(bestTri == ~0u) {
+			while(triScore[nextScan] < 0)
+				nextScan++;
+			bestTri = nextScan;
+		}
+		const u32* tri = inds.begin() + 3 * bestTri;
+		out[3*i + 0] = tri[0];
+		out[3*i + 1] = tri[1];
+		out[3*i + 2] = tri[2];
+		triScore[bestTri] = -1;
+
+		// the triangle's vertices go to the front of the cache
+		u32 newCache[VERTEX_CACHE_SIZE + 3];
+		u32 newCacheSize = 0;
+		for(int k = 0; k < 3; k++) {
+			const u32 v = tri[k];
+			u32* first = vertTris.begin() + offsets[v];
+			u32* last = first + valence[v];
+			for(u32* t = first; t < last; t++) {
+				if(*t == bestTri) {
+					*t = last[-1];
+					last[-1] = bestTri;
+					break;
+				}
+			}
+			valence[v]--;
+			newCache[newCacheSize++] = v;
+		}
+		for(u32 c = 0; c < cacheSize; c++) {
+			const u32 v = cache[c];
+			if(v != tri[0] && v != tri[1] && v != tri[2])
+				newCache[newCacheSize++] = v;
+		}
+
+		// update the scores of the vertices whose position changed, and of their triangles
+		for(u32 c = 0; c < newCacheSize; c++) {
+			const u32 v = newCache[c];
+			cachePos[v] = c < VERTEX_CACHE_SIZE ? i32(c) : -1;
+			const float score = vertexScore(cachePos[v], valence[v]);
+			const float delta = score - vertScore[v];
+			vertScore[v] = score;
+			const u32* first = vertTris.begin() + offsets[v];
+			for(const u32* t = first; t < first + valence[v]; t++)
+				triScore[*t] += delta;
+		}
+		cacheSize = newCacheSize < VERTEX_CACHE_SIZE ? newCacheSize : VERTEX_CACHE_SIZE;
+		memcpy(cache, newCache, cacheSize * sizeof(u32));
+
+		// the next triangle is the best one that touches the cache
+		bestTri = ~0u;
+		float bestScore = -1;
+		for(u32 c = 0; c < cacheSize; c++) {
+			const u32 v = cache[c];
+			const u32* first = vertTris.begin() + offsets[v];
+			for(const u32* t = first; t < first + valence[v]; t++) {
+				if(triScore[*t] > bestScore) {
+					bestScore = triScore[*t];
+					bestTri = *t;
+				}
+			}
+		}
+	}
+
+	memcpy(inds.begin(), out.begin(), inds.size() * sizeof(u32));
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "mesh.hpp"
+#include "tl/arena.hpp"
+
+// Triangle order for the GPU post-transform vertex cache
+// optimizeVertexCache() reorders the triangles with Forsyth's algorithm ("Linear-Speed Vertex Cache
+// Optimisation"): it greedily emits the triangle whose vertices score best, the score favours vertices
+// that are in a simulated LRU cache and vertices with few triangles left, so they get finished
+// The scratch memory comes from an arena, size it with the ...ArenaBytes() functions
+
+constexpr u32 VERTEX_CACHE_SIZE = 32; // size of the LRU cache the optimizer models
+
+struct VertexCacheStats {
+	u32 numTransforms; // vertex shader invocations with a FIFO cache
+	float acmr; // average cache miss ratio: transforms per triangle, 0.5 is the best possible for big meshes
+	float atvr; // average transform to vertex ratio: transforms per used vertex, 1 is the best possible
+};
+
+constexpr size_t vertexCacheStatsArenaBytes(u32 numVerts)
+{
+	return tl::Arena::bytesFor<u32>(numVerts);
+}
+
+// simulates a FIFO cache of cacheSize vertices, like the ones of most GPUs
+VertexCacheStats computeVertexCacheStats(tl::Arena& scratch, tl::CSpan<u32> inds, u32 numVerts, u32 cacheSize = 16);
+
+constexpr size_t optimizeVertexCacheArenaBytes(u32 numVerts, u32 numInds)
+{
+	return
+		tl::Arena::bytesFor<u32>(numVerts) + // valences
+		tl::Arena::bytesFor<u32>(numVerts + 1) + // vertex -> triangles offsets
+		tl::Arena::bytesFor<u32>(numInds) + // vertex -> triangles
+		tl::Arena::bytesFor<float>(numVerts) + // vertex scores
+		tl::Arena::bytesFor<i32>(numVerts) + // positions in the cache
+		tl::Arena::bytesFor<float>(numInds / 3) + // triangle scores, < 0 for the emitted ones
+		tl::Arena::bytesFor<u32>(numInds); // new order
+}
+
+// reorders the triangles in place, the winding of each triangle is kept
+void optimizeVertexCache(tl::Arena& scratch, tl::Span<u32> inds, u32 numVerts);
@@ -0,0 +1,44 @@
+#include "vertex_fetch.hpp"
+
+#include <string.h>
+
+VertexFetchStats computeVertexFetchStats(tl::Arena& scratch, tl::CSpan<u32> inds, u32 numVerts, size_t vertexSize)
+{
+	constexpr u32 VERTEX_CACHE = 16, LINE_CACHE = 256; // 16 KB, like a small L1
+	const size_t numLines = numVerts * vertexSize / FETCH_LINE_SIZE + 2;
+	// same trick as computeVertexCacheStats(): an entry is cached if it was loaded less than N misses ago
+	tl::Span<u32> vertLoadTime = scratch.alloc<u32>(numVerts);
+	tl::Span<u32> lineLoadTime = scratch.alloc<u32>(numLines);
+	memset(vertLoadTime.begin(), 0, numVerts * sizeof(u32));
+	memset(lineLoadTime.begin(), 0, numLines * sizeof(u32));
+	u32 vertMisses = 0, lineMisses = 0;
+	for(u32 v : inds) {
+		if(vertLoadTime[v] && vertMisses + 1 - vertLoadTime[v] <= VERTEX_CACHE)
+			continue;
+		vertLoadTime[v] = ++vertMisses;
+		const size_t firstLine = v * vertexSize / FETCH_LINE_SIZE;
+		const size_t lastLine = (v * vertexSize + vertexSize - 1) / FETCH_LINE_SIZE;
+		for(size_t l = firstLine; l <= lastLine; l++) {
+			if(lineLoadTime[l] && lineMisses + 1 - lineLoadTime[l] <= LINE_CACHE)
+				continue;
+			lineLoadTime[l] = ++lineMisses;
+		}
+	}
+	VertexFetchStats stats;
+	stats.numBytesFetched = size_t(lineMisses) * FETCH_LINE_SIZE;
+	stats.overfetch = numVerts ? float(stats.numBytesFetched) / (numVerts * vertexSize) : 0;
+	return stats;
+}
+
+u32 optimizeVertexFetch(tl::Span<u32> inds, tl::Span<u32> remap)
+{
+	memset(remap.begin(), 0xFF, remap.size() * sizeof(u32));
+	u32 numUsed = 0;
+	for(u32& v : inds) {
+		assert(v < remap.size());
+		if(remap[v] == ~0u)
+			remap[v] = numUsed++;
+		v = remap[v];
+	}
+	return numUsed;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "mesh.hpp"
+#include "tl/arena.hpp"
+#include "tl/parallel.hpp"
+
+// Vertex order for the vertex fetch: after optimizeVertexFetch() the vertices are stored in the order the
+// triangles first use them, so consecutive vertex shader invocations read consecutive memory
+// Run it after the passes that reorder the triangles (optimizeVertexCache, optimizeOverdraw)
+
+struct VertexFetchStats {
+	size_t numBytesFetched; // 64 byte cache lines loaded from the vertex buffer
+	float overfetch; // fetched bytes / vertex buffer size, 1 is the best possible
+};
+
+constexpr u32 FETCH_LINE_SIZE = 64;
+
+constexpr size_t vertexFetchStatsArenaBytes(u32 numVerts, size_t vertexSize)
+{
+	return tl::Arena::bytesFor<u32>(numVerts) + tl::Arena::bytesFor<u32>(numVerts * vertexSize / FETCH_LINE_SIZE + 2);
+}
+
+// simulates a 16 vertex FIFO post-transform cache in front of a FIFO of 256 cache lines (16 KB)
+VertexFetchStats computeVertexFetchStats(tl::Arena& scratch, tl::CSpan<u32> inds, u32 numVerts, size_t vertexSize);
+
+// rewrites the indices and fills remap (one entry per vertex): remap[oldIndex] = newIndex, ~0u for the
+// vertices no triangle uses. Returns the number of used vertices
+u32 optimizeVertexFetch(tl::Span<u32> inds, tl::Span<u32> remap);
+
+// dst[remap[i]] = src[i], dst must have room for the used vertices
+template <typename V>
+void remapVertices(tl::Span<V> dst, tl::CSpan<V> src, tl::CSpan<u32> remap)
+{
+	assert(src.size() == remap.size());
+	tl::parallelForRanges(0, src.size(), 16 << 10, [&](size_t from, size_t to) {
+		for(size_t i = from; i < to; i++) {
+			if(remap[i] != ~0u)
+				dst[remap[i]] = src[i];
+		}
+	});
+}
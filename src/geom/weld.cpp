@@ -0,0 +1,170 @@
+#include "weld.hpp"
+
+#include <float.h>
+#include <math.h>
+
+namespace
+{
+
+constexpr float MAX_CELL = 1e9f; // the cell coords are clamped so they fit in an i32
+
+inline u32 hashCell(i32 x, i32 y, i32 z)
+{
+	return (u32(x) * 73856093u) ^ (u32(y) * 19349663u) ^ (u32(z) * 83492791u);
+}
+
+// floorf() is a call without SSE4.1
+inline i32 cellCoord(float x)
+{
+	x = glm::clamp(x, -MAX_CELL, MAX_CELL);
+	const i32 i = i32(x);
+	return i - (x < float(i));
+}
+
+// the cell of p, or its bits for exact matches (+ 0.f turns -0 into +0)
+inline u32 hashPos(const geom_detail::WeldGrid& grid, vec3 p)
+{
+	if(grid.invCellSize == 0) {
+		p += vec3(0.f);
+		i32 bits[3];
+		memcpy(bits, &p, sizeof(bits));
+		return hashCell(bits[0], bits[1], bits[2]) & grid.mask;
+	}
+	const vec3 c = p * grid.invCellSize;
+	return hashCell(cellCoord(c.x), cellCoord(c.y), cellCoord(c.z)) & grid.mask;
+}
+
+}
+
+namespace geom_detail
+{
+
+WeldGrid buildWeldGrid(tl::Arena& scratch, const vec3* positions, size_t stride, u32 numVerts, float epsilon)
+{
+	u32 tableSize = 1;
+	while(tableSize < numVerts)
+		tableSize *= 2;
+	auto pos = [&](size_t i) { return *(const vec3*)((const u8*)positions + i * stride); };
+	WeldGrid grid;
+	grid.epsilon = epsilon;
+	grid.cellSize = grid.invCellSize = 0;
+	if(epsilon > 0) {
+		// about the spacing of the vertices if they were on a surface, with fewer we would have to look in
+		// the neighbour cells more often, with more the cells would be crowded
+		vec3 lo(FLT_MAX), hi(-FLT_MAX);
+		for(u32 i = 0; i < numVerts; i++) {
+			lo = glm::min(lo, pos(i));
+			hi = glm::max(hi, pos(i));
+		}
+		const vec3 size = numVerts ? hi - lo : vec3(0);
+		grid.cellSize = glm::max(2 * epsilon, glm::max(size.x, glm::max(size.y, size.z)) / sqrtf(float(numVerts)));
+		grid.invCellSize = 1 / grid.cellSize;
+	}
+	grid.mask = tableSize - 1;
+	u32 tableBits = 0;
+	while((1u << tableBits) < tableSize)
+		tableBits++;
+	const u32 partitionBits = tableBits > WELD_PARTITION_BUCKET_BITS ? glm::min(tableBits - WELD_PARTITION_BUCKET_BITS, WELD_PARTITION_BITS) : 0;
+	const u32 numPartitions = 1u << partitionBits, partitionShift = tableBits - partitionBits;
+	const u32 numBlocks = (numVerts + WELD_BLOCK - 1) / WELD_BLOCK;
+	tl::Span<u32> buckets = scratch.alloc<u32>(numVerts);
+	tl::Span<u32> blockOffsets = scratch.alloc<u32>(numBlocks * WELD_PARTITIONS);
+	tl::Span<WeldEntry> partitioned = scratch.alloc<WeldEntry>(numVerts);
+	tl::Span<u32> cursors = scratch.alloc<u32>(tableSize);
+	tl::Span<u32> offsets = scratch.alloc<u32>(tableSize + 1);
+	tl::Span<WeldEntry> entries = scratch.alloc<WeldEntry>(numVerts);
+
+	// the vertices go to partitions of the hash table with their positions, so the sorts of the partitions only
+	// read contiguous memory (hashing again is cheaper than reading the buckets). Each block of vertices counts its own
+	tl::parallelFor(0, numBlocks, 1, [&](size_t block) {
+		u32* hist = blockOffsets.begin() + block * numPartitions;
+		memset(hist, 0, numPartitions * sizeof(u32));
+		const u32 to = glm::min(numVerts, u32(block + 1) * WELD_BLOCK);
+		for(u32 i = u32(block) * WELD_BLOCK; i < to; i++) {
+			buckets[i] = hashPos(grid, pos(i));
+			hist[buckets[i] >> partitionShift]++;
+		}
+	});
+	u32 sum = 0;
+	for(u32 p = 0; p < numPartitions; p++) {
+		for(u32 block = 0; block < numBlocks; block++) {
+			const u32 n = blockOffsets[block * numPartitions + p];
+			blockOffsets[block * numPartitions + p] = sum;
+			sum += n;
+		}
+	}
+	tl::parallelFor(0, numBlocks, 1, [&](size_t block) {
+		u32* cursor = blockOffsets.begin() + block * numPartitions;
+		const u32 to = glm::min(numVerts, u32(block + 1) * WELD_BLOCK);
+		for(u32 i = u32(block) * WELD_BLOCK; i < to; i++) {
+			partitioned[cursor[buckets[i] >> partitionShift]++] = {pos(i), i};
+		}
+	});
+
+	// then every partition sorts its vertices by bucket in its slice of the table, which stays in the cache
+	// The vertices keep their order, so the ones of a bucket are sorted
+	tl::parallelFor(0, numPartitions, 1, [&](size_t p) {
+		const u32 firstBucket = u32(p) << partitionShift, endBucket = u32(p + 1) << partitionShift;
+		const u32 from = p ? blockOffsets[numBlocks * numPartitions - numPartitions + p - 1] : 0;
+		const u32 to = blockOffsets[numBlocks * numPartitions - numPartitions + p];
+		memset(cursors.begin() + firstBucket, 0, (endBucket - firstBucket) * sizeof(u32));
+		for(u32 k = from; k < to; k++)
+			cursors[hashPos(grid, partitioned[k].pos)]++;
+		u32 sum = from;
+		for(u32 b = firstBucket; b < endBucket; b++) {
+			offsets[b] = sum;
+			sum += cursors[b];
+			cursors[b] = offsets[b];
+		}
+		for(u32 k = from; k < to; k++)
+			entries[cursors[hashPos(grid, partitioned[k].pos)]++] = partitioned[k];
+	});
+	offsets[tableSize] = numVerts;
+
+	grid.offsets = offsets.begin();
+	grid.entries = entries.begin();
+	return grid;
+}
+
+u32 getWeldCells(const WeldGrid& grid, vec3 p, u32 (&buckets)[8])
+{
+	if(grid.invCellSize == 0) {
+		buckets[0] = hashPos(grid, p);
+		return 1;
+	}
+	// the cells are at least 2 * epsilon wide, so the sphere of radius epsilon only reaches the neighbours of
+	// the faces it's closer than epsilon to, at most one per axis
+	const vec3 c = p * grid.invCellSize;
+	const i32 x = cellCoord(c.x), y = cellCoord(c.y), z = cellCoord(c.z);
+	const float e = grid.epsilon * grid.invCellSize;
+	auto side = [e](float f) { return f < e ? -1 : f > 1 - e ? 1 : 0; };
+	const i32 dx = side(c.x - x), dy = side(c.y - y), dz = side(c.z - z);
+	u32 n = 0;
+	for(int k = 0; k < 8; k++) {
+		if(((k & 1) && !dx) || ((k & 2) && !dy) || ((k & 4) && !dz))
+			continue;
+		const u32 b = hashCell(x + (k & 1 ? dx : 0), y + (k & 2 ? dy : 0), z + (k & 4 ? dz : 0)) & grid.mask;
+		bool seen = false;
+		for(u32 i = 0; i < n; i++)
+			seen |= buckets[i] == b;
+		if(!seen)
+			buckets[n++] = b;
+	}
+	return n;
+}
+
+u32 resolveWeld(tl::Span<u32> remap)
+{
+	// remap[i] <= i, so the vertices before i already have their new index
+	u32 n = 0;
+	for(u32 i = 0; i < remap.size(); i++)
+		remap[i] = remap[i] == i ? n++ : remap[remap[i]];
+	return n;
+}
+
+}
+
+u32 weldPositions(tl::Arena& scratch, const vec3* positions, size_t positionStride, u32 numVerts, float epsilon, tl::Span<u32> remap)
+{
+	return weldVertices(scratch, positions, positionStride, numVerts, epsilon, remap, [](u32, u32) { return true; });
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+#include "mesh.hpp"
+#include "tl/arena.hpp"
+#include "tl/parallel.hpp"
+
+// Vertex welding with a spatial hash
+// The positions go into a hash grid with cells of at least 2 * epsilon, about the spacing of the vertices of a
+// surface, so most vertices only have to look in their own cell, and the ones within epsilon of a face in the
+// cell next to it too. The buckets keep a copy of the positions so the search reads them contiguously.
+// The table is built without atomics by a radix sort: the vertices are split into partitions of the buckets,
+// then each partition is sorted by bucket in parallel, in the cache. It's stable so every bucket lists its
+// vertices in order, and the search stops at the first match
+// The buckets of the hash table are split among the threads and every vertex looks for the first vertex
+// before it that is close enough and has the same attributes (a caller predicate, so the seams where the
+// normals or the texture coords differ are kept). The chains of first vertices are resolved in index order
+// The welded vertices are numbered in the order of their first vertex, which keeps the order of the mesh
+// The scratch memory comes from an arena, size it with weldArenaBytes()
+
+namespace geom_detail
+{
+struct WeldEntry {
+	vec3 pos;
+	u32 vert;
+};
+
+struct WeldGrid {
+	float cellSize, invCellSize; // 0 for exact matches, then each vertex only looks in its own cell
+	float epsilon;
+	u32 mask; // of the hash table
+	const u32* offsets; // bucket -> entries
+	const WeldEntry* entries;
+};
+
+WeldGrid buildWeldGrid(tl::Arena& scratch, const vec3* positions, size_t stride, u32 numVerts, float epsilon);
+
+// the buckets of the cells that can have vertices within epsilon of p, returns their number
+u32 getWeldCells(const WeldGrid& grid, vec3 p, u32 (&buckets)[8]);
+
+// turns the first close vertex of every vertex into the new index of every vertex, returns the new count
+u32 resolveWeld(tl::Span<u32> remap);
+
+constexpr u32 WELD_CHUNK = 4096;
+// the sorts of the partitions work on 2^WELD_PARTITION_BUCKET_BITS buckets, up to 2^WELD_PARTITION_BITS partitions
+constexpr u32 WELD_PARTITION_BITS = 10;
+constexpr u32 WELD_PARTITION_BUCKET_BITS = 14;
+constexpr u32 WELD_PARTITIONS = 1 << WELD_PARTITION_BITS;
+constexpr u32 WELD_BLOCK = 1 << 16; // vertices that count their partitions together
+}
+
+constexpr size_t weldArenaBytes(u32 numVerts)
+{
+	u32 tableSize = 1;
+	while(tableSize < numVerts)
+		tableSize *= 2;
+	return
+		tl::Arena::bytesFor<u32>(numVerts) + // bucket of every vertex
+		tl::Arena::bytesFor<u32>((numVerts + geom_detail::WELD_BLOCK - 1) / geom_detail::WELD_BLOCK * geom_detail::WELD_PARTITIONS) +
+		tl::Arena::bytesFor<geom_detail::WeldEntry>(numVerts) + // vertices by partition
+		tl::Arena::bytesFor<u32>(tableSize) + // bucket cursors
+		tl::Arena::bytesFor<u32>(tableSize + 1) + // bucket -> entries offsets
+		tl::Arena::bytesFor<geom_detail::WeldEntry>(numVerts);
+}
+
+// remap[i] gets the new index of the vertex i, returns the number of welded vertices
+// same(i, j) tells whether the attributes of the vertices i and j allow welding them, with j < i
+template <typename Same>
+u32 weldVertices(tl::Arena& scratch, const vec3* positions, size_t positionStride, u32 numVerts, float epsilon,
+	tl::Span<u32> remap, Same&& same)
+{
+	using namespace geom_detail;
+	assert(remap.size() >= numVerts);
+	if(numVerts == 0)
+		return 0;
+	const WeldGrid grid = buildWeldGrid(scratch, positions, positionStride, numVerts, epsilon);
+	const float eps2 = epsilon * epsilon;
+	tl::parallelForRanges(0, grid.mask + 1, WELD_CHUNK, [&](size_t fromBucket, size_t toBucket) {
+		for(u32 k = grid.offsets[fromBucket]; k < grid.offsets[toBucket]; k++) {
+			const u32 i = grid.entries[k].vert;
+			const vec3 p = grid.entries[k].pos;
+			u32 buckets[8];
+			const u32 numBuckets = getWeldCells(grid, p, buckets);
+			u32 first = i;
+			for(u32 b = 0; b < numBuckets; b++) {
+				// the entries of a bucket are sorted by vertex, the first match is the smallest one
+				for(u32 l = grid.offsets[buckets[b]]; l < grid.offsets[buckets[b] + 1]; l++) {
+					const WeldEntry& e = grid.entries[l];
+					if(e.vert >= first)
+						break;
+					const vec3 d = e.pos - p;
+					if(glm::dot(d, d) <= eps2 && same(i, e.vert)) {
+						first = e.vert;
+						break;
+					}
+				}
+			}
+			remap[i] = first;
+		}
+	});
+	return resolveWeld({remap.begin(), numVerts});
+}
+
+// only the positions count, for meshes without other attributes
+u32 weldPositions(tl::Arena& scratch, const vec3* positions, size_t positionStride, u32 numVerts, float epsilon, tl::Span<u32> remap);
+
+// Welds the mesh in place and returns the new number of vertices, the indices are rewritten
+// The attributes after pos (V must start with it) are compared as floats with attribEpsilon
+template <typename V>
+u32 weldMesh(tl::Arena& scratch, tl::Span<V> verts, tl::Span<u32> inds, float epsilon, float attribEpsilon = 1e-4f)
+{
+	static_assert(offsetof(V, pos) == 0 && sizeof(V) % sizeof(float) == 0, "weldMesh() expects pos first and float attributes");
+	constexpr u32 NUM_ATTRIBS = sizeof(V) / sizeof(float) - 3;
+	const u32 numVerts = u32(verts.size());
+	if(numVerts == 0)
+		return 0;
+	tl::Span<u32> remap = scratch.alloc<u32>(numVerts);
+	const u32 numWelded = weldVertices(scratch, &verts[0].pos, sizeof(V), numVerts, epsilon, remap, [&](u32 i, u32 j) {
+		const float* a = (const float*)&verts[i] + 3;
+		const float* b = (const float*)&verts[j] + 3;
+		for(u32 k = 0; k < NUM_ATTRIBS; k++)
+			if(glm::abs(a[k] - b[k]) > attribEpsilon)
+				return false;
+		return true;
+	});
+
+	// the first vertex of each welded vertex moves to its new index, which is never after it
+	u32 n = 0;
+	for(u32 i = 0; i < numVerts; i++) {
+		if(remap[i] == n) {
+			if(n != i)
+				memcpy(&verts[n], &verts[i], sizeof(V));
+			n++;
+		}
+	}
+	assert(n == numWelded);
+	tl::parallelForRanges(0, inds.size(), geom_detail::WELD_CHUNK * 4, [&](size_t from, size_t to) {
+		for(size_t i = from; i < to; i++)
+			inds[i] = remap[inds[i]];
+	});
+	return numWelded;
+}
+
+constexpr size_t weldMeshArenaBytes(u32 numVerts)
+{
+	return tl::Arena::bytesFor<u32>(numVerts) + weldArenaBytes(numVerts);
+}
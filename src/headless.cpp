@@ -0,0 +1,173 @@
+#include "headless.hpp"
+
+#if defined(__linux__)
+
+#include <stdio.h>
+#include <string.h>
+#include <dlfcn.h>
+#include <type_traits>
+
+// we load libEGL at runtime so the build doesn't depend on the EGL headers/libs being installed
+typedef void* EGLDisplay;
+typedef void* EGLConfig;
+typedef void* EGLContext;
+typedef void* EGLSurface;
+typedef int EGLint;
+typedef unsigned EGLenum;
+typedef unsigned EGLBoolean;
+
+#define EGL_NONE 0x3038
+#define EGL_EXTENSIONS 0x3055
+#define EGL_SURFACE_TYPE 0x3033
+#define EGL_PBUFFER_BIT 0x0001
+#define EGL_RENDERABLE_TYPE 0x3040
+#define EGL_OPENGL_BIT 0x0008
+#define EGL_OPENGL_API 0x30a2
+#define EGL_CONTEXT_MAJOR_VERSION 0x3098
+#define EGL_CONTEXT_MINOR_VERSION 0x30fb
+#define EGL_CONTEXT_OPENGL_PROFILE_MASK 0x30fd
+#define EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT 0x00000001
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31dd
+
+typedef void* (*PFN_eglGetProcAddress)(const char*);
+typedef EGLDisplay (*PFN_eglGetDisplay)(void*);
+typedef EGLDisplay (*PFN_eglGetPlatformDisplayEXT)(EGLenum, void*, const EGLint*);
+typedef EGLBoolean (*PFN_eglInitialize)(EGLDisplay, EGLint*, EGLint*);
+typedef EGLBoolean (*PFN_eglTerminate)(EGLDisplay);
+typedef const char* (*PFN_eglQueryString)(EGLDisplay, EGLint);
+typedef EGLBoolean (*PFN_eglBindAPI)(EGLenum);
+typedef EGLBoolean (*PFN_eglChooseConfig)(EGLDisplay, const EGLint*, EGLConfig*, EGLint, EGLint*);
+typedef EGLContext (*PFN_eglCreateContext)(EGLDisplay, EGLConfig, EGLContext, const EGLint*);
+typedef EGLBoolean (*PFN_eglDestroyContext)(EGLDisplay, EGLContext);
+typedef EGLBoolean (*PFN_eglMakeCurrent)(EGLDisplay, EGLSurface, EGLSurface, EGLContext);
+
+static struct Egl {
+	void* lib;
+	PFN_eglGetProcAddress GetProcAddress;
+	PFN_eglGetDisplay GetDisplay;
+	PFN_eglInitialize Initialize;
+	PFN_eglTerminate Terminate;
+	PFN_eglQueryString QueryString;
+	PFN_eglBindAPI BindAPI;
+	PFN_eglChooseConfig ChooseConfig;
+	PFN_eglCreateContext CreateContext;
+	PFN_eglDestroyContext DestroyContext;
+	PFN_eglMakeCurrent MakeCurrent;
+
+	EGLDisplay display;
+	EGLContext context;
+} s_egl;
+
+static bool loadEgl()
+{
+	s_egl.lib = dlopen("libEGL.so.1", RTLD_LAZY | RTLD_LOCAL);
+	if (!s_egl.lib)
+		s_egl.lib = dlopen("libEGL.so", RTLD_LAZY | RTLD_LOCAL);
+	if (!s_egl.lib)
+		return false;
+
+	bool ok = true;
+	auto load = [&](auto& fn, const char* name) {
+		fn = (std::remove_reference_t<decltype(fn)>)dlsym(s_egl.lib, name);
+		ok &= fn != nullptr;
+	};
+	load(s_egl.GetProcAddress, "eglGetProcAddress");
+	load(s_egl.GetDisplay, "eglGetDisplay");
+	load(s_egl.Initialize, "eglInitialize");
+	load(s_egl.Terminate, "eglTerminate");
+	load(s_egl.QueryString, "eglQueryString");
+	load(s_egl.BindAPI, "eglBindAPI");
+	load(s_egl.ChooseConfig, "eglChooseConfig");
+	load(s_egl.CreateContext, "eglCreateContext");
+	load(s_egl.DestroyContext, "eglDestroyContext");
+	load(s_egl.MakeCurrent, "eglMakeCurrent");
+	return ok;
+}
+
+static EGLDisplay getSurfacelessDisplay()
+{
+	// client extensions are queried with EGL_NO_DISPLAY
+	const char* exts = s_egl.QueryString(nullptr, EGL_EXTENSIONS);
+	if (exts && strstr(exts, "EGL_MESA_platform_surfaceless")) {
+		auto getPlatformDisplay = (PFN_eglGetPlatformDisplayEXT)s_egl.GetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay)
+			return getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, nullptr, nullptr);
+	}
+	return s_egl.GetDisplay(nullptr); // EGL_DEFAULT_DISPLAY
+}
+
+bool createHeadlessContext(int glMajor, int glMinor)
+{
+	if (!loadEgl()) {
+		fprintf(stderr, "headless: couldn't load libEGL\n");
+		return false;
+	}
+
+	s_egl.display = getSurfacelessDisplay();
+	if (!s_egl.display || !s_egl.Initialize(s_egl.display, nullptr, nullptr)) {
+		fprintf(stderr, "headless: couldn't initialize the EGL display\n");
+		return false;
+	}
+
+	if (!s_egl.BindAPI(EGL_OPENGL_API)) {
+		fprintf(stderr, "headless: EGL doesn't support desktop OpenGL\n");
+		return false;
+	}
+
+	const EGLint configAttribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config = nullptr;
+	EGLint numConfigs = 0;
+	s_egl.ChooseConfig(s_egl.display, configAttribs, &config, 1, &numConfigs);
+	// without a config we rely on EGL_KHR_no_config_context
+
+	const EGLint contextAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, glMajor,
+		EGL_CONTEXT_MINOR_VERSION, glMinor,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	s_egl.context = s_egl.CreateContext(s_egl.display, numConfigs ? config : nullptr, nullptr, contextAttribs);
+	if (!s_egl.context) {
+		fprintf(stderr, "headless: couldn't create an OpenGL %d.%d core context\n", glMajor, glMinor);
+		s_egl.Terminate(s_egl.display);
+		return false;
+	}
+
+	// requires EGL_KHR_surfaceless_context, we always render into our own FBO anyways
+	if (!s_egl.MakeCurrent(s_egl.display, nullptr, nullptr, s_egl.context)) {
+		fprintf(stderr, "headless: couldn't make the context current without a surface\n");
+		destroyHeadlessContext();
+		return false;
+	}
+	return true;
+}
+
+void destroyHeadlessContext()
+{
+	if (s_egl.context) {
+		s_egl.MakeCurrent(s_egl.display, nullptr, nullptr, nullptr);
+		s_egl.DestroyContext(s_egl.display, s_egl.context);
+		s_egl.context = nullptr;
+	}
+	if (s_egl.display) {
+		s_egl.Terminate(s_egl.display);
+		s_egl.display = nullptr;
+	}
+}
+
+void* getHeadlessProcAddress(const char* name)
+{
+	return s_egl.GetProcAddress(name);
+}
+
+#else
+
+bool createHeadlessContext(int glMajor, int glMinor) { return false; }
+void destroyHeadlessContext() {}
+void* getHeadlessProcAddress(const char* name) { return nullptr; }
+
+#endif
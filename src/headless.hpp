@@ -0,0 +1,9 @@
+#pragma once
+
+// Offscreen OpenGL context that doesn't need a window system (EGL surfaceless, Mesa llvmpipe works)
+// Only implemented on Linux, on other platforms createHeadlessContext() returns false and the caller
+// is expected to fall back to an invisible GLFW window
+
+bool createHeadlessContext(int glMajor, int glMinor);
+void destroyHeadlessContext();
+void* getHeadlessProcAddress(const char* name);
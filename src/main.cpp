@@ -8,10 +8,27 @@
 #include <glm/gtx/euler_angles.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
 #include <vector>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <string.h>
+#include <stdlib.h>
+#include <float.h>
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 #include "user_api.hpp"
+#include "alloc_tracker.hpp"
+#include "state.hpp"
+#include "headless.hpp"
+#include "frame_stats.hpp"
+#include "sw_raster.hpp"
+#include "capture.hpp"
+#include "camera_path.hpp"
+#include "scenes.hpp"
+#include "meshes.hpp"
+#include "spheres.hpp"
+#include "geom/mesh_cache.hpp"
 
 static void glErrorCallback(const char* name, void* funcptr, int len_args, ...) {
 	GLenum error_code;
@@ -27,8 +44,8 @@ R"GLSL(
 #version 330 core
 uniform mat4 u_viewProj;
 
-in layout(location = 0) vec3 a_pos;
-in layout(location = 1) vec4 a_color; 
+layout(location = 0) in vec3 a_pos;
+layout(location = 1) in vec4 a_color;
 
 out vec4 v_color;
 
@@ -42,7 +59,7 @@ void main()
 const char* FRAG_SHAD_SRC =
 R"GLSL(
 #version 330 core
-out layout (location = 0) vec4 o_color;
+layout(location = 0) out vec4 o_color;
 
 in vec4 v_color;
 
@@ -57,6 +74,173 @@ char s_buffer[4 * 1024];
 
 GLFWwindow* window;
 
+constexpr vec4 CLEAR_COLOR = { 0, 0.1f, 0.2f, 1 };
+
+enum class Backend { OpenGL, Software };
+
+enum class FramePacing {
+	Vsync,
+	Uncapped, // render as fast as possible, what we want when measuring throughput
+	FixedRate, // sleep + spin until the next frame is due
+};
+
+struct AppOptions {
+	Backend backend = Backend::OpenGL;
+	FramePacing pacing = FramePacing::Vsync;
+	float targetFps = 60; // for FramePacing::FixedRate
+	bool lazyRedraw = false; // only draw a new frame when something changed, see RedrawState
+	bool strictAlloc = false; // assert on any heap allocation in the loop after the warm-up frames
+	bool compareSoftware = false; // render the last headless GL frame with the software rasterizer too
+	const char* screenshotPath = nullptr; // PPM image of the last headless frame, without the gui
+	const char* capturePath = nullptr; // record the submitted geometry of every frame
+	const char* replayPath = nullptr; // render the frames of a capture instead of running userDraws
+	const char* statsCsvPath = nullptr; // FrameStats of every frame
+	const char* sceneName = "user";
+	const char* cameraPath = nullptr; // drive the camera with this CameraPath file
+	const char* recordPath = nullptr; // record the live camera to this CameraPath file
+	const char* reportPath = nullptr; // JSON with the frame time statistics of the run
+	const char* meshCacheDir = nullptr; // where the MeshCache persists the generated meshes
+	int meshCacheMB = 256;
+	float lodPixelError = 1; // the mesh LODs are chosen to stay below this error on screen, 0 disables them
+	bool quantizeMeshes = false; // 16 bit positions for the retained meshes
+	bool meshletCulling = true; // draw only the meshlets of the big meshes that can be visible
+	bool headless = false;
+	int numFrames = 300; // frames measured in headless mode
+	int numWarmupFrames = 10; // frames rendered before we start measuring
+	int width = 1280, height = 720; // size of the offscreen framebuffer
+} s_options;
+
+static void printUsage()
+{
+	printf(
+		"usage: giterate [options]\n"
+		"  --headless      render offscreen without a window and print frame time statistics\n"
+		"  --frames N      number of measured frames in headless mode (default %d)\n"
+		"  --warmup N      number of frames rendered before measuring (default %d)\n"
+		"  --size WxH      offscreen framebuffer size (default %dx%d)\n"
+		"  --backend B     gl (default) or sw, the software rasterizer\n"
+		"  --pacing P      vsync (default), uncapped or fixed; headless runs are uncapped by default\n"
+		"  --fps N         target frame rate of the fixed pacing (default %.0f)\n"
+		"  --lazy          only redraw when the input, the gui or the user code changes something\n"
+		"  --screenshot F  write the last headless frame to the PPM image F\n"
+		"  --capture F     record the geometry and camera of every frame to the capture file F\n"
+		"  --replay F      render the frames of the capture file F (in a loop) instead of the user code\n"
+		"  --stats-csv F   write the statistics of every frame to the CSV file F\n"
+		"  --strict-alloc  assert when the main loop allocates after the warm-up frames\n"
+		"  --compare-sw    render the last headless frame with the software rasterizer too and exit with 1\n"
+		"                  if the images differ in more than 0.5%% of the pixels; meant for the scenes of\n"
+		"                  triangles (e.g. molecule), GL rasterizes the lines and points with other rules\n"
+		"  --scene S       scene to draw (default user), --scene list shows them\n"
+		"  --camera-path F move the camera along the path in the file F; in headless mode the path\n"
+		"                  is spread over the measured frames so runs are comparable\n"
+		"  --record-path F record the camera movement to the path file F\n"
+		"  --report F      write the frame time percentiles of the run to the JSON file F\n"
+		"  --mesh-cache-dir D  keep the generated meshes in the directory D, later runs map them\n"
+		"  --mesh-cache-mb N   memory budget of the mesh cache (default %d)\n"
+		"  --lod-error P   max error in pixels of the retained mesh LODs, 0 draws the full meshes (default %g)\n"
+		"  --quantize-meshes  store the positions of the retained meshes as 16 bit coords in their bounding box\n"
+		"  --no-meshlet-culling  draw all the meshlets of the big retained meshes\n",
+		s_options.numFrames, s_options.numWarmupFrames, s_options.width, s_options.height, s_options.targetFps, s_options.meshCacheMB,
+		s_options.lodPixelError);
+}
+
+static bool parseArgs(int argc, char** argv)
+{
+	bool pacingGiven = false;
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if (strcmp(arg, "--headless") == 0)
+			s_options.headless = true;
+		else if (strcmp(arg, "--frames") == 0 && hasValue)
+			s_options.numFrames = atoi(argv[++i]);
+		else if (strcmp(arg, "--warmup") == 0 && hasValue)
+			s_options.numWarmupFrames = atoi(argv[++i]);
+		else if (strcmp(arg, "--size") == 0 && hasValue) {
+			if (sscanf(argv[++i], "%dx%d", &s_options.width, &s_options.height) != 2)
+				return false;
+		}
+		else if (strcmp(arg, "--backend") == 0 && hasValue) {
+			const char* backend = argv[++i];
+			if (strcmp(backend, "gl") == 0)
+				s_options.backend = Backend::OpenGL;
+			else if (strcmp(backend, "sw") == 0)
+				s_options.backend = Backend::Software;
+			else
+				return false;
+		}
+		else if (strcmp(arg, "--pacing") == 0 && hasValue) {
+			const char* pacing = argv[++i];
+			pacingGiven = true;
+			if (strcmp(pacing, "vsync") == 0)
+				s_options.pacing = FramePacing::Vsync;
+			else if (strcmp(pacing, "uncapped") == 0)
+				s_options.pacing = FramePacing::Uncapped;
+			else if (strcmp(pacing, "fixed") == 0)
+				s_options.pacing = FramePacing::FixedRate;
+			else
+				return false;
+		}
+		else if (strcmp(arg, "--fps") == 0 && hasValue)
+			s_options.targetFps = atof(argv[++i]);
+		else if (strcmp(arg, "--lazy") == 0)
+			s_options.lazyRedraw = true;
+		else if (strcmp(arg, "--screenshot") == 0 && hasValue)
+			s_options.screenshotPath = argv[++i];
+		else if (strcmp(arg, "--capture") == 0 && hasValue)
+			s_options.capturePath = argv[++i];
+		else if (strcmp(arg, "--replay") == 0 && hasValue)
+			s_options.replayPath = argv[++i];
+		else if (strcmp(arg, "--stats-csv") == 0 && hasValue)
+			s_options.statsCsvPath = argv[++i];
+		else if (strcmp(arg, "--strict-alloc") == 0)
+			s_options.strictAlloc = true;
+		else if (strcmp(arg, "--compare-sw") == 0)
+			s_options.compareSoftware = true;
+		else if (strcmp(arg, "--scene") == 0 && hasValue)
+			s_options.sceneName = argv[++i];
+		else if (strcmp(arg, "--camera-path") == 0 && hasValue)
+			s_options.cameraPath = argv[++i];
+		else if (strcmp(arg, "--record-path") == 0 && hasValue)
+			s_options.recordPath = argv[++i];
+		else if (strcmp(arg, "--report") == 0 && hasValue)
+			s_options.reportPath = argv[++i];
+		else if (strcmp(arg, "--mesh-cache-dir") == 0 && hasValue)
+			s_options.meshCacheDir = argv[++i];
+		else if (strcmp(arg, "--mesh-cache-mb") == 0 && hasValue)
+			s_options.meshCacheMB = atoi(argv[++i]);
+		else if (strcmp(arg, "--lod-error") == 0 && hasValue)
+			s_options.lodPixelError = atof(argv[++i]);
+		else if (strcmp(arg, "--quantize-meshes") == 0)
+			s_options.quantizeMeshes = true;
+		else if (strcmp(arg, "--no-meshlet-culling") == 0)
+			s_options.meshletCulling = false;
+		else
+			return false;
+	}
+	if (s_options.headless && !pacingGiven)
+		s_options.pacing = FramePacing::Uncapped;
+	return s_options.numFrames > 0 && s_options.numWarmupFrames >= 0 &&
+		s_options.width > 0 && s_options.height > 0 && s_options.targetFps > 0 && s_options.meshCacheMB >= 0;
+}
+
+static double getTime()
+{
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+// size of the framebuffer we are rendering to: the window, or the offscreen one in headless mode
+static void getFramebufferSize(int& w, int& h)
+{
+	if (s_options.headless) {
+		w = s_options.width;
+		h = s_options.height;
+	}
+	else
+		glfwGetWindowSize(window, &w, &h);
+}
+
 char* getShaderCompileErrors(u32 shader)
 {
 	i32 ok;
@@ -78,19 +262,6 @@ char* getShaderLinkErrors(u32 prog)
 	return nullptr;
 }
 
-struct Point {
-	vec3 pos;
-	vec4 color;
-};
-
-struct Line {
-	Point a, b;
-};
-
-struct Triangle {
-	Point a, b, c;
-};
-
 struct FpsCamera {
 	float rotateSpeed = PI;
 	float moveSpeed = 1;
@@ -142,12 +313,63 @@ struct RenderData {
 	u32 linesVbo, linesVao;
 	u32 trianglesVbo, trianglesVao;
 	u32 transparentTrianglesVbo, transparentTrianglesVao;
+	u32 offscreenFbo, offscreenColorRbo, offscreenDepthRbo;
+	u32 swTexture, swFbo; // the image of the software rasterizer is uploaded here and blitted to the screen
+	u32 cacheFbo, cacheColorRbo; // copy of the last presented frame, for the lazy redraw
+	int cacheW, cacheH;
 
 	struct UnifLocs {
 		i32 viewProj;
 	} unifLocs;
 } s_renderData;
 
+static struct SoftwareRenderer {
+	SwFramebuffer fb;
+	SwRasterStats stats;
+	// accumulated over the measured frames of a headless run
+	double totalTriangles;
+	double totalTime;
+} s_swRenderer;
+
+// with lazy redraw we only run userDraws/endRender when something could have changed the image:
+// input events, the camera moving, the gui settling after an interaction or the user code asking for it
+static struct RedrawState {
+	static constexpr int FRAMES_AFTER_EVENT = 3; // imgui needs a couple of frames to react to an event
+	int numPendingFrames = 1;
+	bool continuous = false; // set by the user code for animations
+	bool exposed = false; // the window contents were damaged, we present the cached frame again
+
+	void markDirty() { numPendingFrames = FRAMES_AFTER_EVENT; }
+} s_redraw;
+
+static FrameStats s_frameStats; // being accumulated for the current frame
+static FrameStats s_lastFrameStats;
+
+static void countGlCall(const char* name, void* funcptr, int len_args, ...)
+{
+	s_frameStats.numGlCalls++;
+	if (strncmp(name, "glDraw", 6) == 0 || strncmp(name, "glMultiDraw", 11) == 0)
+		s_frameStats.numDrawCalls++;
+}
+
+const FrameStats& getFrameStats()
+{
+	return s_lastFrameStats;
+}
+
+static FrameTimeHistory s_frameTimeHistory;
+static int s_swapInterval = -1;
+
+static const Scene* s_scene = nullptr;
+static CameraPath s_cameraPath;
+static float s_cameraPathTime = 0;
+static CameraPathRecorder s_pathRecorder;
+static bool s_recordingPath = false;
+
+static CaptureWriter s_captureWriter;
+static CaptureReader s_captureReader;
+static u32 s_replayFrame = 0;
+
 struct UserData {
 	struct Camera {
 		float fovY = PI / 4;
@@ -171,97 +393,101 @@ void UserData::init()
 	flags.showAxes = true;
 }
 
-struct State { // this current state of the frame
-	std::vector<vec4> color;
-	std::vector<mat4> mtx;
-	std::vector<Point> points;
-	std::vector<Line> lines;
-	std::vector<Triangle> triangles;
-	std::vector<Triangle> transparentTriangles;
-} s_state;
-
-void pushColor(vec4 c) { s_state.color.push_back(c); }
-void popColor() { s_state.color.pop_back(); }
-
-void pushMtx(mat4 m)
+static void startRender()
 {
-	s_state.mtx.push_back(s_state.mtx.back() * m);
-}
-void popMtx() { s_state.mtx.pop_back(); }
+	resetState();
 
-void drawPoint(vec3 a)
-{
-	const mat4 m = s_state.mtx.back();
-	const vec4 color = s_state.color.back();
-	a = m * vec4(a, 1);
-	s_state.points.push_back(Point{ a, color });
+	int w, h;
+	getFramebufferSize(w, h);
+	glViewport(0, 0, w, h);
+	glScissor(0, 0, w, h);
+
+	glDisable(GL_DEPTH_TEST);
+	glDepthMask(GL_TRUE);
+	glClearColor(CLEAR_COLOR.r, CLEAR_COLOR.g, CLEAR_COLOR.b, CLEAR_COLOR.a);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
-void drawLine(vec3 a, vec3 b)
+// the framebuffer we render the scene into
+static u32 getTargetFbo()
 {
-	const mat4 m = s_state.mtx.back();
-	const vec4 color = s_state.color.back();
-	a = m * vec4(a, 1);
-	b = m * vec4(b, 1);
-	s_state.lines.push_back({
-		Point{a, color},
-		Point{b, color}
-	});
+	return s_options.headless ? s_renderData.offscreenFbo : 0;
 }
 
-void drawTriangle(vec3 a, vec3 b, vec3 c)
+static void endRenderSoftware(const DrawLists& lists, const mat4& viewProjMtx, int w, int h)
 {
-	const mat4 m = s_state.mtx.back();
-	const vec4 color = s_state.color.back();
-	a = m * vec4(a, 1);
-	b = m * vec4(b, 1);
-	c = m * vec4(c, 1);
-	if(color.a >= 1) {
-		s_state.triangles.push_back({
-			Point{a, color},
-			Point{b, color},
-			Point{c, color}
-		});
+	SwFramebuffer& fb = s_swRenderer.fb;
+	const bool resized = fb.width != w || fb.height != h;
+	if (resized)
+		fb.resize(w, h);
+
+	swRender(fb, lists, viewProjMtx, CLEAR_COLOR, s_swRenderer.stats);
+	s_swRenderer.totalTriangles += s_swRenderer.stats.numTriangles;
+	s_swRenderer.totalTime += s_swRenderer.stats.totalTime();
+
+	if (s_renderData.swTexture == 0) {
+		glGenTextures(1, &s_renderData.swTexture);
+		glGenFramebuffers(1, &s_renderData.swFbo);
 	}
-	else {
-		s_state.transparentTriangles.push_back({
-			Point{a, color},
-			Point{b, color},
-			Point{c, color}
-		});
+	glBindTexture(GL_TEXTURE_2D, s_renderData.swTexture);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, fb.stride);
+	if (resized) {
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, fb.color.data());
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, s_renderData.swFbo);
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, s_renderData.swTexture, 0);
 	}
+	else
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, fb.color.data());
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	s_frameStats.imageBytes = size_t(w) * h * sizeof(u32);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, s_renderData.swFbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, getTargetFbo());
+	glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, getTargetFbo());
 }
 
-static void startRender()
+static void getCameraMatrices(mat4& viewMtx, mat4& projMtx)
 {
-	s_state.color.resize(1);
-	s_state.color[0] = { 1,1,1,1 };
-	s_state.mtx.resize(1);
-	s_state.mtx[0] = mat4(1);
-	s_state.points.clear();
-	s_state.lines.clear();
-	s_state.triangles.clear();
-	s_state.transparentTriangles.clear();
+	int w, h;
+	getFramebufferSize(w, h);
+	viewMtx = glm::affineInverse(g_userData.camera.fps.getMtx());
+	projMtx = glm::perspective(g_userData.camera.fovY, float(w) / h, 0.02f, 10000.f);
+}
 
+ViewInfo getViewInfo()
+{
 	int w, h;
-	glfwGetWindowSize(window, &w, &h);
-	glViewport(0, 0, w, h);
-	glScissor(0, 0, w, h);
+	getFramebufferSize(w, h);
+	return { g_userData.camera.fps.pos, 0.5f * h / tanf(0.5f * g_userData.camera.fovY) };
+}
 
-	glDisable(GL_DEPTH_TEST);
-	glDepthMask(GL_TRUE);
-	glClearColor(0, 0.1f, 0.2f, 1);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+static MeshLodView getMeshLodView()
+{
+	const ViewInfo info = getViewInfo();
+	MeshLodView view;
+	view.cameraPos = info.cameraPos;
+	view.pixelsPerUnit = info.pixelsPerUnit;
+	view.maxPixelError = s_options.lodPixelError;
+	view.cullMeshlets = s_options.meshletCulling;
+	return view;
 }
 
-static void endRender()
+static void endRender(const DrawLists& lists, const mat4& viewProjMtx)
 {
 	int w, h;
-	glfwGetWindowSize(window, &w, &h);
+	getFramebufferSize(w, h);
+
+	s_frameStats.numPoints = lists.points.size();
+	s_frameStats.numLines = lists.lines.size();
+	s_frameStats.numTriangles = lists.triangles.size();
+	s_frameStats.numTransparentTriangles = lists.transparentTriangles.size();
+
+	if (s_options.backend == Backend::Software) {
+		endRenderSoftware(lists, viewProjMtx, w, h);
+		return;
+	}
 
-	const mat4 viewMtx = glm::affineInverse(g_userData.camera.fps.getMtx());
-	const mat4 projMtx = glm::perspective(g_userData.camera.fovY, float(w) / h, 0.02f, 10000.f);
-	const mat4 viewProjMtx = projMtx * viewMtx;
 	glUniformMatrix4fv(s_renderData.unifLocs.viewProj, 1, GL_FALSE, &viewProjMtx[0][0]);
 
 	glEnable(GL_DEPTH_TEST);
@@ -271,19 +497,23 @@ static void endRender()
 
 	// triangles
 	{
-		const u32 n = s_state.triangles.size();
+		const u32 n = lists.triangles.size();
 		glBindBuffer(GL_ARRAY_BUFFER, s_renderData.trianglesVbo);
-		glBufferData(GL_ARRAY_BUFFER, n * sizeof(Triangle), s_state.triangles.data(), GL_STREAM_DRAW);
+		glBufferData(GL_ARRAY_BUFFER, n * sizeof(Triangle), lists.triangles.begin(), GL_STREAM_DRAW);
+		s_frameStats.triangleBytes = n * sizeof(Triangle);
 		//glBufferSubData(GL_VERTEX_ARRAY, 0, n * sizeof(Line), s_state.lines.data());
 		glBindVertexArray(s_renderData.trianglesVao);
 		glDrawArrays(GL_TRIANGLES, 0, 3*n);
 	}
+	drawMeshes({s_state.meshDraws.data(), s_state.meshDraws.size()}, viewProjMtx, s_renderData.unifLocs.viewProj, getMeshLodView(), false, s_frameStats);
+	drawSpheres({s_state.sphereDraws.data(), s_state.sphereDraws.size()}, viewProjMtx, false, s_renderData.shaderProg, s_frameStats);
 
 	// lines
 	{
-		const u32 n = s_state.lines.size();
+		const u32 n = lists.lines.size();
 		glBindBuffer(GL_ARRAY_BUFFER, s_renderData.linesVbo);
-		glBufferData(GL_ARRAY_BUFFER, n * sizeof(Line), s_state.lines.data(), GL_STREAM_DRAW);
+		glBufferData(GL_ARRAY_BUFFER, n * sizeof(Line), lists.lines.begin(), GL_STREAM_DRAW);
+		s_frameStats.lineBytes = n * sizeof(Line);
 		//glBufferSubData(GL_VERTEX_ARRAY, 0, n * sizeof(Line), s_state.lines.data());
 		glBindVertexArray(s_renderData.linesVao);
 		glDrawArrays(GL_LINES, 0, 2*n);
@@ -291,9 +521,10 @@ static void endRender()
 
 	// points
 	{
-		const u32 n = s_state.points.size();
+		const u32 n = lists.points.size();
 		glBindBuffer(GL_ARRAY_BUFFER, s_renderData.pointsVbo);
-		glBufferData(GL_ARRAY_BUFFER, n * sizeof(Point), s_state.points.data(), GL_STREAM_DRAW);
+		glBufferData(GL_ARRAY_BUFFER, n * sizeof(Point), lists.points.begin(), GL_STREAM_DRAW);
+		s_frameStats.pointBytes = n * sizeof(Point);
 		//glBufferSubData(GL_VERTEX_ARRAY, 0, n * sizeof(Line), s_state.lines.data());
 		glBindVertexArray(s_renderData.pointsVao);
 		glDrawArrays(GL_POINTS, 0, n);
@@ -305,18 +536,22 @@ static void endRender()
 
 	// transparent triangles
 	{
-		const u32 n = s_state.transparentTriangles.size();
+		const u32 n = lists.transparentTriangles.size();
 		glBindBuffer(GL_ARRAY_BUFFER, s_renderData.transparentTrianglesVbo);
-		glBufferData(GL_ARRAY_BUFFER, n * sizeof(Triangle), s_state.transparentTriangles.data(), GL_STREAM_DRAW);
+		glBufferData(GL_ARRAY_BUFFER, n * sizeof(Triangle), lists.transparentTriangles.begin(), GL_STREAM_DRAW);
+		s_frameStats.transparentTriangleBytes = n * sizeof(Triangle);
 		//glBufferSubData(GL_VERTEX_ARRAY, 0, n * sizeof(Line), s_state.lines.data());
 		glBindVertexArray(s_renderData.transparentTrianglesVao);
 		glDrawArrays(GL_TRIANGLES, 0, 3*n);
 	}
+	drawMeshes({s_state.meshDraws.data(), s_state.meshDraws.size()}, viewProjMtx, s_renderData.unifLocs.viewProj, getMeshLodView(), true, s_frameStats);
+	drawSpheres({s_state.sphereDraws.data(), s_state.sphereDraws.size()}, viewProjMtx, true, s_renderData.shaderProg, s_frameStats);
 
 }
 
 static void onKey(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
+	s_redraw.markDirty();
 	const bool pressed = action == GLFW_PRESS || action == GLFW_REPEAT;
 	switch (key)
 	{
@@ -340,6 +575,7 @@ static void onKey(GLFWwindow* window, int key, int scancode, int action, int mod
 
 static void onMouseButton(GLFWwindow* window, int button, int action, int mods)
 {
+	s_redraw.markDirty();
 	if (ImGui::GetIO().WantCaptureMouse)
 		return; // the mouse is captured by imgui
 	switch (button)
@@ -351,6 +587,7 @@ static void onMouseButton(GLFWwindow* window, int button, int action, int mods)
 
 static void onMouseMove(GLFWwindow* window, double x, double y)
 {
+	s_redraw.markDirty();
 	if (s_pressed.leftMouse)
 	{
 		int w, h;
@@ -361,6 +598,32 @@ static void onMouseMove(GLFWwindow* window, double x, double y)
 	s_mousePos = { x, y };
 }
 
+// the events below are handled by imgui, we only need to know that something happened
+static void onScroll(GLFWwindow* window, double dx, double dy)
+{
+	s_redraw.markDirty();
+}
+
+static void onChar(GLFWwindow* window, unsigned c)
+{
+	s_redraw.markDirty();
+}
+
+static void onFramebufferSize(GLFWwindow* window, int w, int h)
+{
+	s_redraw.markDirty();
+}
+
+static void onWindowFocus(GLFWwindow* window, int focused)
+{
+	s_redraw.markDirty();
+}
+
+static void onWindowRefresh(GLFWwindow* window)
+{
+	s_redraw.exposed = true;
+}
+
 void processInput(float dt)
 {
 	vec2 dir = { 0, 0 };
@@ -379,6 +642,90 @@ void processInput(float dt)
 	}
 }
 
+void setContinuousRedraw(bool continuous)
+{
+	s_redraw.continuous = continuous;
+}
+
+void requestRedraw()
+{
+	s_redraw.numPendingFrames = glm::max(s_redraw.numPendingFrames, 1);
+}
+
+// moves the camera along the path, or records the camera if we are recording
+// headless runs spread the path over the measured frames, so the result doesn't depend on the speed of the machine
+static void updateCameraPath(int frameInd, float dt)
+{
+	FpsCamera& camera = g_userData.camera.fps;
+	if (!s_cameraPath.keys.empty()) {
+		if (s_options.headless) {
+			const int measuredFrame = glm::max(0, frameInd - s_options.numWarmupFrames);
+			s_cameraPathTime = s_cameraPath.duration() * measuredFrame / glm::max(1, s_options.numFrames - 1);
+		}
+		else {
+			s_cameraPathTime += dt;
+			if (s_cameraPathTime > s_cameraPath.duration())
+				s_cameraPathTime = 0;
+		}
+		const CameraKey key = s_cameraPath.sample(s_cameraPathTime);
+		camera.pos = key.pos;
+		camera.heading = key.heading;
+		camera.pitch = key.pitch;
+	}
+	if (s_recordingPath)
+		s_pathRecorder.feed(dt, camera.pos, camera.heading, camera.pitch);
+}
+
+static void saveRecordedPath()
+{
+	const char* path = s_options.recordPath ? s_options.recordPath : "camera_path.txt";
+	if (s_pathRecorder.path.save(path))
+		printf("recorded a camera path of %.1f s to %s\n", s_pathRecorder.path.duration(), path);
+	else
+		fprintf(stderr, "Couldn't write the camera path to %s\n", path);
+}
+
+static const char* getBackendName(Backend backend)
+{
+	return backend == Backend::Software ? "sw" : "gl";
+}
+
+static void writeJsonString(FILE* file, const char* str)
+{
+	fputc('"', file);
+	for (const char* c = str; *c; c++) {
+		if (*c == '"' || *c == '\\')
+			fputc('\\', file);
+		fputc(*c, file);
+	}
+	fputc('"', file);
+}
+
+static bool writeReport(const char* path, const FrameTimeStats& stats)
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+		return false;
+	fprintf(file, "{\n  \"scene\": ");
+	writeJsonString(file, s_scene->name);
+	fprintf(file, ",\n  \"camera_path\": ");
+	if (s_options.cameraPath)
+		writeJsonString(file, s_options.cameraPath);
+	else
+		fprintf(file, "null");
+	fprintf(file, ",\n  \"backend\": \"%s\",\n  \"renderer\": ", getBackendName(s_options.backend));
+	writeJsonString(file, (const char*)glGetString(GL_RENDERER));
+	int w, h;
+	getFramebufferSize(w, h);
+	fprintf(file, ",\n  \"headless\": %s,\n  \"width\": %d,\n  \"height\": %d,\n  \"warmup_frames\": %d,\n",
+		s_options.headless ? "true" : "false", w, h, s_options.numWarmupFrames);
+	fprintf(file, "  \"frame_time_ms\": ");
+	writeFrameTimeStatsJson(file, stats);
+	fprintf(file, "\n}\n");
+	fclose(file);
+	return true;
+}
+
 static void appDraws()
 {
 	if (g_userData.flags.showAxes)
@@ -408,11 +755,310 @@ static void drawGui()
 		ImGui::SliderFloat("Move speed", &g_userData.camera.fps.moveSpeed, 0, 10000, "%.5f", 5);
 		ImGui::TreePop();
 	}
+	if (ImGui::TreeNodeEx("Frame times", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		ImGui::Combo("Pacing", (int*)&s_options.pacing, "Vsync\0Uncapped\0Fixed rate\0");
+		if (s_options.pacing == FramePacing::FixedRate)
+			ImGui::SliderFloat("Target FPS", &s_options.targetFps, 10, 1000, "%.0f", 2);
+
+		static float times[FrameTimeHistory::CAPACITY], plotTimes[FrameTimeHistory::CAPACITY];
+		const size_t numTimes = s_frameTimeHistory.copyTimes(times);
+		// the plot always has all the points, the missing ones at the start repeat the oldest time, so its geometry
+		// and the draw buffers of the gui don't grow while the history fills
+		const size_t numMissing = FrameTimeHistory::CAPACITY - numTimes;
+		std::fill(plotTimes, plotTimes + numMissing, numTimes ? times[0] : 0.f);
+		std::copy(times, times + numTimes, plotTimes + numMissing);
+		ImGui::PlotLines("##frameTimes", plotTimes, FrameTimeHistory::CAPACITY, 0, "frame times", 0, FLT_MAX, ImVec2(0, 60));
+		const FrameTimeStats stats = computeFrameTimeStats(times, numTimes);
+		constexpr int NUM_BINS = 40;
+		float bins[NUM_BINS];
+		const float maxTime = 1.05f * stats.max;
+		computeFrameTimeHistogram(times, numTimes, maxTime, bins, NUM_BINS);
+		char overlay[64];
+		snprintf(overlay, sizeof(overlay), "0 - %.1f ms", 1e3f * maxTime);
+		ImGui::PlotHistogram("##frameTimeHistogram", bins, NUM_BINS, 0, overlay, 0, FLT_MAX, ImVec2(0, 60));
+		ImGui::Text("p50 %.2f | p95 %.2f | p99 %.2f | max %.2f ms",
+			1e3f * stats.p50, 1e3f * stats.p95, 1e3f * stats.p99, 1e3f * stats.max);
+		ImGui::TreePop();
+	}
+	if (ImGui::TreeNode("Frame stats"))
+	{
+		const FrameStats& stats = s_lastFrameStats;
+		auto kb = [](size_t bytes) { return bytes / 1024.f; };
+		ImGui::Text("points: %u (%.1f KB)", stats.numPoints, kb(stats.pointBytes));
+		ImGui::Text("lines: %u (%.1f KB)", stats.numLines, kb(stats.lineBytes));
+		ImGui::Text("triangles: %u (%.1f KB)", stats.numTriangles, kb(stats.triangleBytes));
+		ImGui::Text("transparent triangles: %u (%.1f KB)", stats.numTransparentTriangles, kb(stats.transparentTriangleBytes));
+		if (stats.imageBytes)
+			ImGui::Text("image: %.1f KB", kb(stats.imageBytes));
+		ImGui::Text("spheres: %u (%u triangles)", stats.numSphereDraws, stats.numSphereTriangles);
+		ImGui::Text("draw calls: %u | GL calls: %u", stats.numDrawCalls, stats.numGlCalls);
+		ImGui::Text("userDraws %.2fms | endRender %.2fms | gui %.2fms",
+			1e3f * stats.userDrawsTime, 1e3f * stats.endRenderTime, 1e3f * stats.guiTime);
+		ImGui::Text("state: %.1f KB used of %.1f KB", kb(stats.stateSize), kb(stats.stateCapacity));
+		ImGui::TreePop();
+	}
+	if (ImGui::TreeNode("Mesh cache"))
+	{
+		const MeshCache::Stats& stats = getMeshCache().stats();
+		ImGui::Text("hits: %u memory, %u disk | misses: %u", stats.memoryHits, stats.diskHits, stats.misses);
+		ImGui::Text("%u meshes, %.1f MB, %u evictions", stats.numMeshes, stats.numBytes / (1024. * 1024.), stats.evictions);
+		if (ImGui::Button("Clear"))
+			getMeshCache().clear();
+		ImGui::TreePop();
+	}
+	if (ImGui::TreeNode("Meshes"))
+	{
+		const FrameStats& stats = s_lastFrameStats;
+		ImGui::Text("last frame: %u draws, %u triangles", stats.numMeshDraws, stats.numMeshTriangles);
+		ImGui::Text("meshlets: %u drawn, %u culled", stats.numMeshlets, stats.numCulledMeshlets);
+		ImGui::SliderFloat("LOD error (pixels)", &s_options.lodPixelError, 0, 8);
+		ImGui::Checkbox("Meshlet culling", &s_options.meshletCulling);
+		const tl::CSpan<RetainedMesh> meshes = getRetainedMeshes();
+		for (size_t i = 0; i < meshes.size(); i++) {
+			const RetainedMesh& mesh = meshes[i];
+			if (!mesh.alive)
+				continue;
+			ImGui::Text("%zu: %u tris, %u verts (%u before the weld), optimized in %.1f ms", i + 1, mesh.lods[0].numInds / 3,
+				u32(mesh.positions.size()), mesh.numInputVerts, 1e3f * mesh.optimizeTime);
+			ImGui::Text("  ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", mesh.cacheBefore.acmr, mesh.cacheAfter.acmr, mesh.cacheBefore.atvr, mesh.cacheAfter.atvr);
+			ImGui::Text("  overfetch %.3f -> %.3f, overdraw %.3f -> %.3f", mesh.fetchBefore.overfetch, mesh.fetchAfter.overfetch,
+				mesh.overdrawBefore.overdraw, mesh.overdrawAfter.overdraw);
+			ImGui::Text("  indices: %s %s, %.1f KB (%.1f KB as u32 triangles)", mesh.lods[0].strips ? "strips" : "triangles", mesh.u16Inds ? "u16" : "u32",
+				mesh.lods[0].indexBytes / 1024., mesh.lods[0].numInds * sizeof(u32) / 1024.);
+			ImGui::Text("  vertices: %.1f KB%s", mesh.vertexBytes / 1024., mesh.quantized ? ", quantized" : "");
+			if (!mesh.meshlets.empty())
+				ImGui::Text("  %zu meshlets", mesh.meshlets.size());
+			if (mesh.quantized)
+				ImGui::Text("  quantization error: max %.3g, rms %.3g", mesh.quantizationStats.maxPosError, mesh.quantizationStats.rmsPosError);
+			ImGui::Text("  %u LODs in %.1f ms", mesh.numLods, 1e3f * mesh.lodTime);
+			for (u32 l = 1; l < mesh.numLods; l++)
+				ImGui::Text("    %u: %u tris, error %.2g", l, mesh.lods[l].numInds / 3, mesh.lods[l].error);
+		}
+		ImGui::TreePop();
+	}
+	if (ImGui::TreeNode("Allocations"))
+	{
+		const FrameStats& stats = s_lastFrameStats;
+		ImGui::Text("last frame: %zu allocs, %.1f KB", stats.numAllocs, stats.allocBytes / 1024.f);
+		AllocScopeStats scopes[8];
+		const int numScopes = getAllocScopeStats(scopes, 8);
+		ImGui::Columns(3);
+		ImGui::Text("scope"); ImGui::NextColumn();
+		ImGui::Text("frame"); ImGui::NextColumn();
+		ImGui::Text("total"); ImGui::NextColumn();
+		ImGui::Separator();
+		for (int i = 0; i < numScopes; i++) {
+			const AllocScopeStats& scope = scopes[i];
+			ImGui::Text("%s", scope.name); ImGui::NextColumn();
+			ImGui::Text("%zu (%.1f KB)", scope.frame.numAllocs, scope.frame.numBytes / 1024.f); ImGui::NextColumn();
+			ImGui::Text("%zu (%.1f KB)", scope.total.numAllocs, scope.total.numBytes / 1024.f); ImGui::NextColumn();
+		}
+		ImGui::Columns(1);
+		ImGui::TreePop();
+	}
+	ImGui::Combo("Renderer", (int*)&s_options.backend, "OpenGL\0Software\0");
+	if (!s_options.headless)
+		ImGui::Checkbox("Lazy redraw", &s_options.lazyRedraw);
+	if (!s_cameraPath.keys.empty())
+		ImGui::Text("Camera path: %.1f/%.1f s", s_cameraPathTime, s_cameraPath.duration());
+	if (ImGui::Button(s_recordingPath ? "Stop recording the camera" : "Record the camera")) {
+		if (s_recordingPath)
+			saveRecordedPath();
+		else
+			s_pathRecorder.reset();
+		s_recordingPath = !s_recordingPath;
+	}
+	if (s_recordingPath) {
+		ImGui::SameLine();
+		ImGui::Text("%zu keys", s_pathRecorder.path.keys.size());
+	}
+	if (s_captureReader.isOpen())
+		ImGui::Text("Replaying frame %u/%u", s_replayFrame + 1, s_captureReader.numFrames());
+	else if (s_captureWriter.isOpen())
+	{
+		ImGui::Text("Capturing: %u frames, %.1f MB, %u stalls", s_captureWriter.numFrames(),
+			s_captureWriter.numBytes() / (1024. * 1024.), s_captureWriter.numStalls());
+		if (ImGui::Button("Stop capture"))
+			s_captureWriter.close();
+	}
+	if (s_options.backend == Backend::Software)
+	{
+		const SwRasterStats& stats = s_swRenderer.stats;
+		ImGui::Text("%u tris (%u rasterized), %u tiles, %u threads",
+			stats.numTriangles, stats.numRasterizedTriangles, stats.numTiles, stats.numThreads);
+		ImGui::Text("setup %.2fms | bin %.2fms | raster %.2fms",
+			1e3 * stats.setupTime, 1e3 * stats.binTime, 1e3 * stats.rasterTime);
+		ImGui::Text("%.0f tri/s", stats.trisPerSec());
+	}
 
 	ImGui::End();
 }
 
-int main()
+// renders the draws of the state with the software rasterizer and compares the image with the current read
+// framebuffer, which has the same frame from GL. Returns whether they match: the pixels that differ by more
+// than the rounding of the colors are at most 0.5%. The rounding adds up over the blended layers, a few steps.
+// The lines and points don't match, GL rasterizes them with the diamond rule and not as two triangles
+static bool compareWithSoftware(const mat4& viewProjMtx, int w, int h)
+{
+	std::vector<u8> pixels(size_t(w) * h * 4);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+	expandMeshDraws(s_state, viewProjMtx, getMeshLodView(), s_frameStats);
+	expandSphereDraws(s_state, s_frameStats);
+	SwFramebuffer fb;
+	fb.resize(w, h);
+	SwRasterStats stats;
+	swRender(fb, getDrawLists(s_state), viewProjMtx, CLEAR_COLOR, stats);
+
+	size_t numDiffering = 0;
+	for (int y = 0; y < h; y++)
+	for (int x = 0; x < w; x++) {
+		const u8* gl = &pixels[(size_t(y) * w + x) * 4];
+		const u32 sw = fb.color[size_t(y) * fb.stride + x];
+		for (int c = 0; c < 3; c++) {
+			if (abs(int(gl[c]) - int((sw >> (8 * c)) & 0xFF)) > 8) {
+				numDiffering++;
+				break;
+			}
+		}
+	}
+	const double fraction = double(numDiffering) / (size_t(w) * h);
+	printf("software rasterizer vs GL: %zu of %zu pixels differ (%.2f%%)\n", numDiffering, size_t(w) * h, 100 * fraction);
+	return fraction <= 0.005;
+}
+
+// writes the color buffer of the current read framebuffer to a binary PPM
+static bool saveScreenshot(const char* path, int w, int h)
+{
+	std::vector<u8> pixels(size_t(w) * h * 4);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+	FILE* file = fopen(path, "wb");
+	if (!file)
+		return false;
+	fprintf(file, "P6\n%d %d\n255\n", w, h);
+	std::vector<u8> row(size_t(w) * 3);
+	for (int y = h - 1; y >= 0; y--) { // GL gives us the bottom row first
+		const u8* src = &pixels[size_t(y) * w * 4];
+		for (int x = 0; x < w; x++)
+			for (int c = 0; c < 3; c++)
+				row[3 * x + c] = src[4 * x + c];
+		fwrite(row.data(), 1, row.size(), file);
+	}
+	fclose(file);
+	return true;
+}
+
+static void applySwapInterval()
+{
+	const int interval = s_options.pacing == FramePacing::Vsync ? 1 : 0;
+	if (window && interval != s_swapInterval) {
+		glfwSwapInterval(interval);
+		s_swapInterval = interval;
+	}
+}
+
+// sleeps most of the remaining time and spins the rest, because the sleep granularity of the OS is too coarse
+static void waitForNextFrame(double& nextFrameTime)
+{
+	constexpr double SPIN_TIME = 0.002;
+	const double period = 1.0 / s_options.targetFps;
+	const double now = getTime();
+	nextFrameTime += period;
+	if (nextFrameTime < now - period)
+		nextFrameTime = now; // we are too late to catch up, start again from now
+	const double sleepTime = nextFrameTime - now - SPIN_TIME;
+	if (sleepTime > 0)
+		std::this_thread::sleep_for(std::chrono::duration<double>(sleepTime));
+	while (getTime() < nextFrameTime)
+		std::this_thread::yield();
+}
+
+static bool needsRedraw()
+{
+	if (!s_options.lazyRedraw || s_redraw.continuous || s_redraw.numPendingFrames > 0)
+		return true;
+	if (s_pressed.w || s_pressed.a || s_pressed.s || s_pressed.d)
+		return true; // the camera is moving
+	return s_captureReader.isOpen(); // the replay is an animation
+}
+
+// copies the frame we are about to present, so we can present it again without drawing it
+static void cacheFrame(int w, int h)
+{
+	if (s_renderData.cacheFbo == 0) {
+		glGenFramebuffers(1, &s_renderData.cacheFbo);
+		glGenRenderbuffers(1, &s_renderData.cacheColorRbo);
+	}
+	if (s_renderData.cacheW != w || s_renderData.cacheH != h) {
+		glBindRenderbuffer(GL_RENDERBUFFER, s_renderData.cacheColorRbo);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+		glBindFramebuffer(GL_FRAMEBUFFER, s_renderData.cacheFbo);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, s_renderData.cacheColorRbo);
+		s_renderData.cacheW = w;
+		s_renderData.cacheH = h;
+	}
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, s_renderData.cacheFbo);
+	glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+static void presentCachedFrame()
+{
+	int w, h;
+	getFramebufferSize(w, h);
+	if (s_renderData.cacheW != w || s_renderData.cacheH != h) {
+		s_redraw.markDirty(); // the cache is stale, we have to draw
+		return;
+	}
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, s_renderData.cacheFbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glfwSwapBuffers(window);
+}
+
+// blocks while the window is minimized, or while there is nothing new to draw in lazy mode
+// returns whether it had to wait
+static bool waitForRedraw()
+{
+	bool waited = false;
+	for (;;) {
+		if (glfwWindowShouldClose(window))
+			return waited;
+		const bool iconified = glfwGetWindowAttrib(window, GLFW_ICONIFIED);
+		if (!iconified && needsRedraw())
+			return waited;
+		glfwWaitEventsTimeout(0.1);
+		waited = true;
+		if (s_redraw.exposed && !iconified && !needsRedraw())
+			presentCachedFrame();
+		s_redraw.exposed = false;
+	}
+}
+
+static void createOffscreenFramebuffer(int w, int h)
+{
+	glGenRenderbuffers(1, &s_renderData.offscreenColorRbo);
+	glBindRenderbuffer(GL_RENDERBUFFER, s_renderData.offscreenColorRbo);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+
+	glGenRenderbuffers(1, &s_renderData.offscreenDepthRbo);
+	glBindRenderbuffer(GL_RENDERBUFFER, s_renderData.offscreenDepthRbo);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, w, h);
+
+	glGenFramebuffers(1, &s_renderData.offscreenFbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, s_renderData.offscreenFbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, s_renderData.offscreenColorRbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, s_renderData.offscreenDepthRbo);
+	assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+}
+
+static int createWindowAndContext()
 {
 	glfwSetErrorCallback(+[](int error, const char* description) {
 		fprintf(stderr, "Glfw Error %d: %s\n", error, description);
@@ -423,38 +1069,91 @@ int main()
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	glfwWindowHint(GLFW_MAXIMIZED, GLFW_TRUE); // https://github.com/glfw/glfw/issues/1499
+	if (s_options.headless)
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	else
+		glfwWindowHint(GLFW_MAXIMIZED, GLFW_TRUE); // https://github.com/glfw/glfw/issues/1499
 
 	window = glfwCreateWindow(1360, 960, "giterate", nullptr, nullptr);
 	if (window == nullptr)
 		return 2;
 
 	glfwMakeContextCurrent(window);
-	glfwSwapInterval(1); // Enable vsync
 
 	if (gladLoadGL() == 0) {
 		fprintf(stderr, "Failed to initialize OpenGL loader!\n");
 		return 3;
 	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	if (!parseArgs(argc, argv)) {
+		printUsage();
+		return 4;
+	}
+	s_scene = findScene(s_options.sceneName);
+	if (!s_scene) {
+		if (strcmp(s_options.sceneName, "list") != 0)
+			fprintf(stderr, "Unknown scene %s\n", s_options.sceneName);
+		printf("scenes:\n");
+		for (const Scene& scene : getScenes())
+			printf("  %-10s %s\n", scene.name, scene.description);
+		return strcmp(s_options.sceneName, "list") == 0 ? 0 : 4;
+	}
+	if (s_options.cameraPath && !s_cameraPath.load(s_options.cameraPath)) {
+		fprintf(stderr, "Couldn't read the camera path %s\n", s_options.cameraPath);
+		return 5;
+	}
+	s_recordingPath = s_options.recordPath != nullptr;
+	getMeshCache().setMaxBytes(size_t(s_options.meshCacheMB) << 20);
+	getMeshCache().setDiskDir(s_options.meshCacheDir);
+	setMeshQuantization(s_options.quantizeMeshes);
+
+	// in headless mode we try a surfaceless EGL context first because it doesn't need a display server
+	bool eglHeadless = false;
+	if (s_options.headless && createHeadlessContext(3, 3)) {
+		eglHeadless = true;
+		if (gladLoadGLLoader(getHeadlessProcAddress) == 0) {
+			fprintf(stderr, "Failed to initialize OpenGL loader!\n");
+			return 3;
+		}
+	}
+	else if (const int error = createWindowAndContext())
+		return error;
+	glad_set_pre_callback(countGlCall);
 	glad_set_post_callback(glErrorCallback);
 
-	glfwSetMouseButtonCallback(window, onMouseButton);
-	glfwSetCursorPosCallback(window, onMouseMove);
-	glfwSetKeyCallback(window, onKey);
-	//glfwSetScrollCallback(window, onMouseWheel);
+	if (s_options.headless)
+		createOffscreenFramebuffer(s_options.width, s_options.height);
+	else {
+		glfwSetMouseButtonCallback(window, onMouseButton);
+		glfwSetCursorPosCallback(window, onMouseMove);
+		glfwSetKeyCallback(window, onKey);
+		glfwSetScrollCallback(window, onScroll);
+		glfwSetCharCallback(window, onChar);
+		glfwSetFramebufferSizeCallback(window, onFramebufferSize);
+		glfwSetWindowFocusCallback(window, onWindowFocus);
+		glfwSetWindowRefreshCallback(window, onWindowRefresh);
+	}
 
 	{
+		ImGui::SetAllocatorFunctions(allocTrackerImGuiAlloc, allocTrackerImGuiFree);
 		ImGui::CreateContext();
 		ImGuiIO& io = ImGui::GetIO(); (void)io;
 		//io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;     // Enable Keyboard Controls
 		//io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;      // Enable Gamepad Controls
+		if (s_options.headless)
+			io.IniFilename = nullptr; // don't touch the user's imgui.ini from batch runs
 
 		// Setup Dear ImGui style
 		ImGui::StyleColorsDark();
 		//ImGui::StyleColorsClassic();
 
 		// Setup Platform/Renderer bindings
-		ImGui_ImplGlfw_InitForOpenGL(window, true);
+		if (!s_options.headless)
+			ImGui_ImplGlfw_InitForOpenGL(window, true);
 		ImGui_ImplOpenGL3_Init();
 	}
 	
@@ -486,8 +1185,9 @@ int main()
 			assert(false);
 		}
 		glUseProgram(s_renderData.shaderProg);
-		glGetUniformLocation(s_renderData.shaderProg, "u_viewProj");
+		s_renderData.unifLocs.viewProj = glGetUniformLocation(s_renderData.shaderProg, "u_viewProj");
 	}
+	initSphereRenderer();
 
 	auto setupVaoVbo = [&](u32& vao, u32& vbo)
 	{
@@ -507,36 +1207,241 @@ int main()
 	setupVaoVbo(s_renderData.trianglesVao, s_renderData.trianglesVbo);
 	setupVaoVbo(s_renderData.transparentTrianglesVao, s_renderData.transparentTrianglesVbo);
 
-	userInit();
+	if (s_options.replayPath) {
+		if (!s_captureReader.open(s_options.replayPath) || s_captureReader.numFrames() == 0) {
+			fprintf(stderr, "Couldn't read the capture %s\n", s_options.replayPath);
+			return 5;
+		}
+	}
+	else
+		s_scene->init();
+	if (s_options.capturePath && !s_captureWriter.open(s_options.capturePath)) {
+		fprintf(stderr, "Couldn't open %s for writing the capture\n", s_options.capturePath);
+		return 5;
+	}
+	FILE* statsCsvFile = nullptr;
+	if (s_options.statsCsvPath) {
+		statsCsvFile = fopen(s_options.statsCsvPath, "w");
+		if (!statsCsvFile) {
+			fprintf(stderr, "Couldn't open %s for writing the stats\n", s_options.statsCsvPath);
+			return 5;
+		}
+		writeFrameStatsCsvHeader(statsCsvFile);
+	}
+
+	// headless runs and runs with a report measure the frames after the warm-up
+	const bool measureFrames = s_options.headless || s_options.reportPath;
+	std::vector<float> frameTimes;
+	frameTimes.reserve(s_options.headless ? s_options.numFrames : s_options.reportPath ? 1 << 16 : 0);
+	bool softwareMatches = true; // see --compare-sw
+	auto keepRunning = [&](int frameInd) {
+		if (s_options.headless)
+			return frameInd < s_options.numWarmupFrames + s_options.numFrames;
+		return !glfwWindowShouldClose(window);
+	};
 
-	float t0 = glfwGetTime();
-	while (!glfwWindowShouldClose(window))
+	double t0 = getTime();
+	double nextFrameTime = t0;
+	int frameInd = 0;
+	for (; keepRunning(frameInd); frameInd++)
 	{
-		const float t1 = glfwGetTime();
+		bool waited = false;
+		if (!s_options.headless) {
+			glfwPollEvents();
+			waited = waitForRedraw();
+			if (glfwWindowShouldClose(window))
+				break;
+			if (waited)
+				t0 = getTime() - 1.0 / 60; // the time we spent idle is not a frame time
+		}
+
+		const double t1 = getTime();
 		const float dt = t1 - t0;
 		t0 = t1;
+		if (frameInd > 0 && !waited)
+			s_frameTimeHistory.add(dt);
+		if (measureFrames && frameInd > s_options.numWarmupFrames && !waited)
+			frameTimes.push_back(dt);
+		if (frameInd == s_options.numWarmupFrames) {
+			s_swRenderer.totalTriangles = s_swRenderer.totalTime = 0;
+			setAllocStrictMode(s_options.strictAlloc);
+		}
+		allocTrackerEndFrame();
+		if (frameInd > 0) {
+			const AllocCounts allocs = getFrameAllocCounts();
+			s_frameStats.numAllocs = allocs.numAllocs;
+			s_frameStats.allocBytes = allocs.numBytes;
+			s_lastFrameStats = s_frameStats;
+			if (statsCsvFile)
+				writeFrameStatsCsvRow(statsCsvFile, frameInd - 1, dt, s_lastFrameStats);
+		}
+		s_frameStats = {};
+
+		const double guiT0 = getTime();
+		{
+			AllocScope allocScope("gui");
+			ImGui_ImplOpenGL3_NewFrame();
+			if (s_options.headless) {
+				ImGuiIO& io = ImGui::GetIO();
+				io.DisplaySize = ImVec2(s_options.width, s_options.height);
+				io.DeltaTime = dt > 0 ? dt : 1.f / 60;
+			}
+			else
+				ImGui_ImplGlfw_NewFrame();
+			ImGui::NewFrame();
+
+			drawGui();
+		}
+		s_frameStats.guiTime = getTime() - guiT0;
+
+		processInput(dt);
+		updateCameraPath(frameInd, dt);
 
-		glfwPollEvents();
+		// headless runs wait for the LODs so they don't depend on the speed of the background thread
+		updateMeshLods(s_options.headless);
+		startRender();
+		if (s_captureReader.isOpen()) {
+			// the frame comes straight from the mapped file, the user code doesn't run
+			const CaptureFrame frame = s_captureReader.getFrame(s_replayFrame);
+			const double renderT0 = getTime();
+			{
+				AllocScope allocScope("endRender");
+				endRender(frame.lists, frame.projMtx * frame.viewMtx);
+			}
+			s_frameStats.endRenderTime = getTime() - renderT0;
+			s_replayFrame = (s_replayFrame + 1) % s_captureReader.numFrames();
+		}
+		else {
+			const double userT0 = getTime();
+			{
+				AllocScope allocScope("userDraws");
+				appDraws();
+				s_scene->draw(dt);
+			}
+			s_frameStats.userDrawsTime = getTime() - userT0;
+			s_frameStats.stateSize = getStateSize(s_state);
+			s_frameStats.stateCapacity = getStateCapacity(s_state);
+			mat4 viewMtx, projMtx;
+			getCameraMatrices(viewMtx, projMtx);
+			// the software renderer and the captures only see triangles
+			if (s_options.backend == Backend::Software || s_captureWriter.isOpen()) {
+				expandMeshDraws(s_state, projMtx * viewMtx, getMeshLodView(), s_frameStats);
+				expandSphereDraws(s_state, s_frameStats);
+			}
+			const DrawLists lists = getDrawLists(s_state);
+			if (s_captureWriter.isOpen()) {
+				AllocScope allocScope("capture");
+				s_captureWriter.writeFrame(lists, viewMtx, projMtx, dt);
+			}
+			const double renderT0 = getTime();
+			{
+				AllocScope allocScope("endRender");
+				endRender(lists, projMtx * viewMtx);
+			}
+			s_frameStats.endRenderTime = getTime() - renderT0;
+			if (s_options.compareSoftware && s_options.headless && s_options.backend == Backend::OpenGL && !keepRunning(frameInd + 1)) {
+				setAllocStrictMode(false); // the comparison is not part of the frame
+				softwareMatches = compareWithSoftware(projMtx * viewMtx, s_options.width, s_options.height);
+			}
+		}
 
-		ImGui_ImplOpenGL3_NewFrame();
-		ImGui_ImplGlfw_NewFrame();
-		ImGui::NewFrame();
+		const bool lastHeadlessFrame = s_options.headless && !keepRunning(frameInd + 1);
+		if (lastHeadlessFrame && s_options.screenshotPath) {
+			setAllocStrictMode(false); // the screenshot is not part of the frame
+			if (!saveScreenshot(s_options.screenshotPath, s_options.width, s_options.height))
+				fprintf(stderr, "Couldn't write the screenshot to %s\n", s_options.screenshotPath);
+		}
 
-		drawGui();
+		const double guiT1 = getTime();
+		{
+			AllocScope allocScope("gui");
+			ImGui::Render();
+			ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		}
+		s_frameStats.guiTime += getTime() - guiT1;
+
+		if (s_options.headless)
+			glFinish(); // so the frame times include the GPU work
+		else {
+			if (s_options.lazyRedraw) {
+				int w, h;
+				getFramebufferSize(w, h);
+				cacheFrame(w, h);
+			}
+			applySwapInterval();
+			glfwSwapBuffers(window);
+			if (s_redraw.numPendingFrames > 0)
+				s_redraw.numPendingFrames--;
+		}
 
-		processInput(dt);
+		if (s_options.pacing == FramePacing::FixedRate)
+			waitForNextFrame(nextFrameTime);
+		else
+			nextFrameTime = getTime();
+	}
 
-		startRender();
-		appDraws();
-		userDraws(dt);
-		endRender();
+	const float lastFrameTime = getTime() - t0; // the last frame isn't closed by the loop above
+	setAllocStrictMode(false);
+	if (statsCsvFile) {
+		writeFrameStatsCsvRow(statsCsvFile, frameInd - 1, lastFrameTime, s_frameStats);
+		fclose(statsCsvFile);
+	}
+	if (s_options.headless)
+		frameTimes.push_back(lastFrameTime);
+	const FrameTimeStats stats = computeFrameTimeStats(frameTimes.data(), frameTimes.size());
+	if (s_options.headless) {
+		printf("headless: %dx%d, %s\n", s_options.width, s_options.height,
+			eglHeadless ? "EGL surfaceless" : "GLFW invisible window");
+		printf("renderer: %s\n", glGetString(GL_RENDERER));
+		printFrameTimeStats(stats);
+		const tl::CSpan<RetainedMesh> meshes = getRetainedMeshes();
+		for (size_t i = 0; i < meshes.size(); i++) {
+			const RetainedMesh& mesh = meshes[i];
+			if (!mesh.alive)
+				continue;
+			printf("mesh %zu: %u tris, %u verts (%u before the weld), optimized in %.1f ms: ACMR %.3f -> %.3f | ATVR %.3f -> %.3f | overfetch %.3f -> %.3f | overdraw %.3f -> %.3f"
+				" | %s %s indices %.1f KB (u32 triangles %.1f KB)\n",
+				i + 1, mesh.lods[0].numInds / 3, u32(mesh.positions.size()), mesh.numInputVerts, 1e3f * mesh.optimizeTime,
+				mesh.cacheBefore.acmr, mesh.cacheAfter.acmr, mesh.cacheBefore.atvr, mesh.cacheAfter.atvr,
+				mesh.fetchBefore.overfetch, mesh.fetchAfter.overfetch, mesh.overdrawBefore.overdraw, mesh.overdrawAfter.overdraw,
+				mesh.lods[0].strips ? "strip" : "triangle", mesh.u16Inds ? "u16" : "u32", mesh.lods[0].indexBytes / 1024., mesh.lods[0].numInds * sizeof(u32) / 1024.);
+			printf("  vertex buffer %.1f KB (%zu bytes per vertex)", mesh.vertexBytes / 1024., mesh.vertexBytes / glm::max<size_t>(mesh.positions.size(), 1));
+			if (mesh.quantized)
+				printf(", quantization error max %.3g rms %.3g (%.2g%% of the radius)", mesh.quantizationStats.maxPosError,
+					mesh.quantizationStats.rmsPosError, 100 * mesh.quantizationStats.maxPosError / mesh.radius);
+			if (!mesh.meshlets.empty())
+				printf(", %zu meshlets", mesh.meshlets.size());
+			printf("\n");
+			printf("  %u LODs built in %.1f ms:", mesh.numLods, 1e3f * mesh.lodTime);
+			for (u32 l = 1; l < mesh.numLods; l++)
+				printf(" %u tris (error %.2g)%s", mesh.lods[l].numInds / 3, mesh.lods[l].error, l + 1 < mesh.numLods ? "," : "");
+			printf("\n");
+		}
+		if (s_options.backend == Backend::Software && s_swRenderer.totalTime > 0) {
+			printf("software rasterizer: %.0f tri/s (%u threads)\n",
+				s_swRenderer.totalTriangles / s_swRenderer.totalTime, s_swRenderer.stats.numThreads);
+		}
+	}
 
-		ImGui::Render();
-		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+	if (s_options.reportPath && !writeReport(s_options.reportPath, stats))
+		fprintf(stderr, "Couldn't write the report to %s\n", s_options.reportPath);
+	if (s_recordingPath)
+		saveRecordedPath();
 
-		glfwSwapBuffers(window);
-		//glfwWaitEventsTimeout(0.01);
+	if (s_captureWriter.isOpen()) {
+		printf("captured %u frames (%.1f MB) to %s\n", s_captureWriter.numFrames(),
+			s_captureWriter.numBytes() / (1024. * 1024.), s_options.capturePath);
+		s_captureWriter.close();
 	}
 
-	return 0;
-}
\ No newline at end of file
+	ImGui_ImplOpenGL3_Shutdown();
+	if (!s_options.headless)
+		ImGui_ImplGlfw_Shutdown();
+	ImGui::DestroyContext();
+	if (eglHeadless)
+		destroyHeadlessContext();
+	else
+		glfwTerminate();
+
+	return softwareMatches ? 0 : 1;
+}
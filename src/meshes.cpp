@@ -0,0 +1,606 @@
+#include "meshes.hpp"
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <glad/glad.h>
+#include "geom/simplify.hpp"
+#include "geom/weld.hpp"
+
+static std::vector<RetainedMesh> s_meshes;
+static std::vector<u8> s_scratch; // for the optimization passes, it only grows
+static std::vector<u32> s_indsCopy;
+static std::vector<u32> s_strip; // the GL indices of the last optimized mesh
+static std::vector<u32> s_fetchOrder; // s_strip without the restarts
+static std::vector<u16> s_inds16;
+static std::vector<QuantizedVert_pos> s_quantizedVerts;
+static std::vector<u32> s_meshletOffsets; // of the last optimized mesh
+static std::vector<MeshletRange> s_meshletRanges; // of the last culled mesh, it only grows
+static std::vector<GLsizei> s_multiDrawCounts;
+static std::vector<const void*> s_multiDrawOffsets;
+static bool s_quantize = false;
+
+// the vertices closer than this, relative to the size of the mesh, are welded
+constexpr float MESH_WELD_EPSILON = 1e-6f;
+// the meshes with fewer triangles are drawn whole, for them the strips save more than the culling
+constexpr u32 MESH_MESHLET_MIN_TRIANGLES = 1 << 16;
+
+static double getTime()
+{
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static tl::Arena getScratch(size_t size)
+{
+	if (s_scratch.size() < size)
+		s_scratch.resize(size);
+	return tl::Arena(s_scratch.data(), s_scratch.size());
+}
+
+// removes the triangles with a repeated index in place, they draw nothing and the strips drop them. Returns the
+// new number of indices
+static u32 removeDegenerateTriangles(tl::Span<u32> inds)
+{
+	u32 numInds = 0;
+	for (size_t i = 0; i + 2 < inds.size(); i += 3) {
+		const u32 a = inds[i], b = inds[i + 1], c = inds[i + 2];
+		if (a == b || b == c || a == c)
+			continue;
+		inds[numInds++] = a;
+		inds[numInds++] = b;
+		inds[numInds++] = c;
+	}
+	return numInds;
+}
+
+// appends the GL indices of the triangles to gpuInds: strips when they are smaller than the list. Each strip
+// starts at the first free triangle and stays close to it so they keep most of the cache locality
+// The triangles take the order of the strips, which is what the GPU sees, without the degenerate ones: inds
+// shrinks to what is drawn. Returns whether it's strips
+static bool appendGpuIndices(tl::Arena& scratch, u32 numVerts, tl::Span<u32>& inds, std::vector<u32>& gpuInds)
+{
+	inds = inds.subArray(0, removeDegenerateTriangles(inds));
+	const size_t first = gpuInds.size();
+	gpuInds.resize(first + stripifyMaxInds(inds.size()));
+	const u32 numStripInds = stripify(scratch, inds, numVerts, { gpuInds.data() + first, gpuInds.size() - first });
+	if (numStripInds < inds.size()) {
+		gpuInds.resize(first + numStripInds);
+		const u32 numInds = unstripify({ gpuInds.data() + first, numStripInds }, inds);
+		inds = inds.subArray(0, numInds);
+		return true;
+	}
+	gpuInds.resize(first);
+	gpuInds.insert(gpuInds.end(), inds.begin(), inds.end());
+	return false;
+}
+
+// the generators and the files often duplicate the vertices of the seams, where the other attributes differ,
+// but here they only split the mesh: they cost fetches and the simplifier has to keep them
+static void weldMeshVertices(RetainedMesh& mesh)
+{
+	const u32 numVerts = u32(mesh.positions.size());
+	vec3 lo(FLT_MAX), hi(-FLT_MAX);
+	for (const vec3& p : mesh.positions) {
+		lo = glm::min(lo, p);
+		hi = glm::max(hi, p);
+	}
+	const vec3 size = numVerts ? hi - lo : vec3(0);
+	const float epsilon = MESH_WELD_EPSILON * glm::max(size.x, glm::max(size.y, size.z));
+
+	tl::Arena scratch = getScratch(weldArenaBytes(numVerts));
+	std::vector<u32> remap(numVerts);
+	const u32 numWelded = weldPositions(scratch, mesh.positions.data(), sizeof(vec3), numVerts, epsilon, { remap.data(), remap.size() });
+	if (numWelded < numVerts) {
+		// the first vertex of each welded vertex moves to its new index, which is never after it
+		u32 n = 0;
+		for (u32 i = 0; i < numVerts; i++)
+			if (remap[i] == n)
+				mesh.positions[n++] = mesh.positions[i];
+		mesh.positions.resize(numWelded);
+		for (u32& v : mesh.inds)
+			v = remap[v];
+	}
+
+	// the triangles that the weld collapsed, and the ones that came degenerate
+	mesh.inds.resize(removeDegenerateTriangles({ mesh.inds.data(), mesh.inds.size() }));
+}
+
+// the vertices are welded, the triangles are reordered for the vertex cache, then for overdraw and then into strips, or
+// meshlets for the big meshes, and the vertices for the fetch. The GL indices end up in s_strip
+static void optimizeMesh(RetainedMesh& mesh)
+{
+	const double t0 = getTime();
+	mesh.numInputVerts = u32(mesh.positions.size());
+	weldMeshVertices(mesh);
+	u32 numVerts = u32(mesh.positions.size());
+	tl::Span<u32> inds = { mesh.inds.data(), mesh.inds.size() };
+	const size_t vertexSize = s_quantize ? sizeof(QuantizedVert_pos) : sizeof(vec3); // of the GL vertices
+	auto analyze = [&](VertexCacheStats& cache, VertexFetchStats& fetch, OverdrawStats& overdraw) {
+		tl::Arena scratch = getScratch(0);
+		cache = computeVertexCacheStats(scratch, inds, numVerts);
+		scratch.reset();
+		fetch = computeVertexFetchStats(scratch, inds, numVerts, vertexSize);
+		scratch.reset();
+		overdraw = computeOverdrawStats(scratch, mesh.positions.data(), sizeof(vec3), numVerts, inds);
+	};
+
+	getScratch(std::max({
+		optimizeVertexCacheArenaBytes(numVerts, inds.size()),
+		optimizeOverdrawArenaBytes(numVerts, inds.size()),
+		vertexFetchStatsArenaBytes(numVerts, vertexSize),
+		overdrawStatsArenaBytes(),
+		stripifyArenaBytes(numVerts, inds.size()),
+		buildMeshletsArenaBytes(numVerts, inds.size()),
+	}));
+	analyze(mesh.cacheBefore, mesh.fetchBefore, mesh.overdrawBefore);
+
+	tl::Arena scratch = getScratch(0);
+	optimizeVertexCache(scratch, inds, numVerts);
+
+	// the cluster order costs some cache misses and it's a heuristic, we keep it only if it helps
+	s_indsCopy.assign(mesh.inds.begin(), mesh.inds.end());
+	scratch.reset();
+	optimizeOverdraw(scratch, mesh.positions.data(), sizeof(vec3), numVerts, inds);
+	scratch.reset();
+	const OverdrawStats cacheOrder = computeOverdrawStats(scratch, mesh.positions.data(), sizeof(vec3), numVerts, { s_indsCopy.data(), s_indsCopy.size() });
+	scratch.reset();
+	const OverdrawStats clusterOrder = computeOverdrawStats(scratch, mesh.positions.data(), sizeof(vec3), numVerts, inds);
+	if (clusterOrder.overdraw > 0.99f * cacheOrder.overdraw)
+		std::copy(s_indsCopy.begin(), s_indsCopy.end(), mesh.inds.begin());
+
+	scratch.reset();
+	s_strip.clear();
+	mesh.meshlets.clear();
+	if (inds.size() / 3 >= MESH_MESHLET_MIN_TRIANGLES) {
+		// the meshlets keep the cache order inside them, the ranges that are drawn have to be lists
+		s_meshletOffsets.resize(maxMeshlets(inds.size()) + 1);
+		const u32 numMeshlets = buildMeshlets(scratch, mesh.positions.data(), sizeof(vec3), numVerts, inds,
+			{ s_meshletOffsets.data(), s_meshletOffsets.size() });
+		s_meshletOffsets.resize(numMeshlets + 1);
+		mesh.meshlets.resize(numMeshlets);
+		s_strip.assign(inds.begin(), inds.end());
+		mesh.lods[0].strips = false;
+	}
+	else {
+		mesh.lods[0].strips = appendGpuIndices(scratch, numVerts, inds, s_strip);
+		mesh.inds.resize(inds.size());
+	}
+
+	// the vertices in the order the GPU first fetches them, i.e. in the order of the strips or the meshlets, unless
+	// the generation order was better already. The restarts don't fetch anything
+	s_fetchOrder.clear();
+	for (u32 v : s_strip)
+		if (v != STRIP_RESTART_INDEX)
+			s_fetchOrder.push_back(v);
+	const tl::Span<u32> fetchOrder = { s_fetchOrder.data(), s_fetchOrder.size() };
+	scratch.reset();
+	const VertexFetchStats oldOrder = computeVertexFetchStats(scratch, fetchOrder, numVerts, vertexSize);
+	std::vector<u32> remap(numVerts);
+	const u32 numUsedVerts = optimizeVertexFetch(fetchOrder, { remap.data(), remap.size() });
+	scratch.reset();
+	const VertexFetchStats newOrder = computeVertexFetchStats(scratch, fetchOrder, numUsedVerts, vertexSize);
+	if (newOrder.numBytesFetched < oldOrder.numBytesFetched) {
+		std::vector<vec3> positions(numUsedVerts);
+		remapVertices<vec3>({ positions.data(), positions.size() }, { mesh.positions.data(), mesh.positions.size() }, { remap.data(), remap.size() });
+		mesh.positions.swap(positions);
+		numVerts = numUsedVerts;
+		for (u32& v : s_strip)
+			if (v != STRIP_RESTART_INDEX)
+				v = remap[v];
+		for (u32& v : mesh.inds)
+			v = remap[v];
+	}
+
+	mesh.u16Inds = fitsU16Indices(numVerts);
+	mesh.lods[0].numInds = u32(inds.size());
+	mesh.lods[0].numGpuInds = u32(s_strip.size());
+	mesh.lods[0].indexBytes = s_strip.size() * (mesh.u16Inds ? sizeof(u16) : sizeof(u32));
+	mesh.numLods = 1;
+	mesh.optimizeTime = float(getTime() - t0);
+	analyze(mesh.cacheAfter, mesh.fetchAfter, mesh.overdrawAfter);
+	mesh.fetchAfter = newOrder.numBytesFetched < oldOrder.numBytesFetched ? newOrder : oldOrder; // what the GPU fetches
+}
+
+// the GL vertices go to s_quantizedVerts, the positions become what the GPU will decode
+static void quantizeMesh(RetainedMesh& mesh)
+{
+	const u32 numVerts = u32(mesh.positions.size());
+	mesh.quantization = getPositionQuantization(mesh.positions.data(), sizeof(vec3), numVerts);
+	s_quantizedVerts.resize(numVerts);
+	mesh.quantizationStats = quantizePositions(mesh.positions.data(), sizeof(vec3), numVerts, mesh.quantization,
+		(u16*)s_quantizedVerts.data(), sizeof(QuantizedVert_pos));
+	for (u32 i = 0; i < numVerts; i++) {
+		s_quantizedVerts[i].pos[3] = 0;
+		mesh.positions[i] = dequantizePosition(mesh.quantization, s_quantizedVerts[i].pos);
+	}
+}
+
+// the sphere around the center of the bounding box
+static void computeBoundingSphere(RetainedMesh& mesh)
+{
+	vec3 lo(FLT_MAX), hi(-FLT_MAX);
+	for (const vec3& p : mesh.positions) {
+		lo = glm::min(lo, p);
+		hi = glm::max(hi, p);
+	}
+	mesh.center = 0.5f * (lo + hi);
+	float r2 = 0;
+	for (const vec3& p : mesh.positions)
+		r2 = glm::max(r2, glm::dot(p - mesh.center, p - mesh.center));
+	mesh.radius = sqrtf(r2);
+}
+
+static u32 createIndexBuffer(const u32* inds, size_t numInds, bool u16Inds)
+{
+	u32 ebo;
+	glGenBuffers(1, &ebo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+	if (u16Inds) {
+		s_inds16.resize(numInds);
+		copyIndicesU16({ s_inds16.data(), s_inds16.size() }, { inds, numInds });
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, numInds * sizeof(u16), s_inds16.data(), GL_STATIC_DRAW);
+	}
+	else
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, numInds * sizeof(u32), inds, GL_STATIC_DRAW);
+	return ebo;
+}
+
+// A LOD job simplifies a copy of the LOD 0 of a mesh, the results stay in the job until updateMeshLods()
+// applies them, if the mesh is still the same
+struct LodJob {
+	u32 slot, generation;
+	bool u16Inds;
+	std::vector<vec3> positions;
+	std::vector<u32> inds; // the LOD 0 and then the triangles of the new LODs
+	std::vector<u32> gpuInds; // of the new LODs, one after the other
+	MeshLod lods[MAX_MESH_LODS];
+	u32 numLods;
+	float time;
+};
+
+// Builds the LOD chains in its own thread, the GL objects are created by updateMeshLods() in the GL thread
+class LodBuilder
+{
+public:
+	~LodBuilder();
+
+	void push(LodJob&& job);
+	// moves the finished jobs to done
+	void takeDone(std::vector<LodJob>& done, bool wait);
+
+private:
+	void threadLoop();
+
+	std::thread _thread;
+	std::mutex _mutex;
+	std::condition_variable _cv;
+	std::vector<LodJob> _todo, _done;
+	u32 _numRunning = 0;
+	bool _quit = false;
+};
+static LodBuilder s_lodBuilder;
+
+// each LOD simplifies the LOD 0 to half the triangles of the previous one, it stops when the simplification
+// gets stuck (the boundaries are locked)
+static void buildLods(LodJob& job)
+{
+	const double t0 = getTime();
+	const u32 numVerts = u32(job.positions.size());
+	const u32 numInds0 = u32(job.inds.size());
+	std::vector<u8> memory(std::max({
+		simplifyArenaBytes(numVerts, numInds0),
+		optimizeVertexCacheArenaBytes(numVerts, numInds0),
+		stripifyArenaBytes(numVerts, numInds0),
+	}));
+	std::vector<u32> lodInds(numInds0);
+	job.numLods = 1;
+	while (job.numLods < MAX_MESH_LODS) {
+		const u32 prevNumInds = job.numLods == 1 ? numInds0 : job.lods[job.numLods - 1].numInds;
+		const u32 target = prevNumInds / 6 * 3;
+		tl::Arena scratch(memory.data(), memory.size());
+		float error;
+		const u32 numInds = simplifyMesh(scratch, job.positions.data(), sizeof(vec3), numVerts, { job.inds.data(), numInds0 },
+			target, { lodInds.data(), lodInds.size() }, &error);
+		if (numInds == 0 || numInds > prevNumInds * 3 / 4)
+			break;
+
+		MeshLod& lod = job.lods[job.numLods++];
+		lod.firstInd = u32(job.inds.size());
+		lod.numInds = numInds;
+		lod.error = error;
+		job.inds.insert(job.inds.end(), lodInds.begin(), lodInds.begin() + numInds);
+		tl::Span<u32> inds = { job.inds.data() + lod.firstInd, numInds };
+		scratch.reset();
+		optimizeVertexCache(scratch, inds, numVerts);
+		scratch.reset();
+		const size_t firstGpuInd = job.gpuInds.size();
+		lod.strips = appendGpuIndices(scratch, numVerts, inds, job.gpuInds);
+		lod.numInds = u32(inds.size());
+		job.inds.resize(lod.firstInd + lod.numInds);
+		lod.numGpuInds = u32(job.gpuInds.size() - firstGpuInd);
+		lod.indexBytes = lod.numGpuInds * (job.u16Inds ? sizeof(u16) : sizeof(u32));
+	}
+	job.time = float(getTime() - t0);
+}
+
+LodBuilder::~LodBuilder()
+{
+	if (!_thread.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_quit = true;
+	}
+	_cv.notify_all();
+	_thread.join();
+}
+
+void LodBuilder::push(LodJob&& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_todo.push_back(std::move(job));
+	}
+	if (!_thread.joinable())
+		_thread = std::thread([this] { threadLoop(); });
+	_cv.notify_all();
+}
+
+void LodBuilder::takeDone(std::vector<LodJob>& done, bool wait)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (wait)
+		_cv.wait(lock, [&] { return _todo.empty() && _numRunning == 0; });
+	for (LodJob& job : _done)
+		done.push_back(std::move(job));
+	_done.clear();
+}
+
+void LodBuilder::threadLoop()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	for (;;) {
+		_cv.wait(lock, [&] { return _quit || !_todo.empty(); });
+		if (_quit)
+			return;
+		LodJob job = std::move(_todo.front());
+		_todo.erase(_todo.begin());
+		_numRunning++;
+		lock.unlock();
+		buildLods(job);
+		lock.lock();
+		_numRunning--;
+		_done.push_back(std::move(job));
+		_cv.notify_all();
+	}
+}
+
+void updateMeshLods(bool wait)
+{
+	static std::vector<LodJob> done;
+	s_lodBuilder.takeDone(done, wait);
+	for (LodJob& job : done) {
+		RetainedMesh& mesh = s_meshes[job.slot];
+		if (!mesh.alive || mesh.generation != job.generation)
+			continue; // destroyed meanwhile
+		mesh.inds.insert(mesh.inds.end(), job.inds.begin() + mesh.lods[0].numInds, job.inds.end());
+		glBindVertexArray(mesh.vao);
+		size_t firstGpuInd = 0;
+		for (u32 i = 1; i < job.numLods; i++) {
+			MeshLod& lod = mesh.lods[i];
+			lod = job.lods[i];
+			lod.ebo = createIndexBuffer(job.gpuInds.data() + firstGpuInd, lod.numGpuInds, mesh.u16Inds);
+			firstGpuInd += lod.numGpuInds;
+		}
+		glBindVertexArray(0);
+		mesh.numLods = job.numLods;
+		mesh.lodTime = job.time;
+	}
+	done.clear();
+}
+
+MeshHandle createMesh(const vec3* positions, size_t positionStride, u32 numVerts, const u32* inds, u32 numInds)
+{
+	assert(numInds % 3 == 0);
+	size_t slot = 0;
+	while (slot < s_meshes.size() && s_meshes[slot].alive)
+		slot++;
+	if (slot == s_meshes.size())
+		s_meshes.emplace_back();
+	RetainedMesh& mesh = s_meshes[slot];
+	mesh.alive = true;
+	mesh.generation++;
+
+	mesh.positions.resize(numVerts);
+	for (u32 i = 0; i < numVerts; i++)
+		mesh.positions[i] = *(const vec3*)((const u8*)positions + i * positionStride);
+	mesh.inds.assign(inds, inds + numInds);
+	optimizeMesh(mesh);
+	mesh.quantized = s_quantize;
+	if (mesh.quantized)
+		quantizeMesh(mesh);
+	computeBoundingSphere(mesh);
+	if (!mesh.meshlets.empty()) {
+		computeMeshletBounds(mesh.positions.data(), sizeof(vec3), { mesh.inds.data(), mesh.lods[0].numInds },
+			{ s_meshletOffsets.data(), s_meshletOffsets.size() }, { mesh.meshlets.data(), mesh.meshlets.size() });
+	}
+
+	glGenVertexArrays(1, &mesh.vao);
+	glBindVertexArray(mesh.vao);
+	glGenBuffers(1, &mesh.vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+	glEnableVertexAttribArray(0);
+	if (mesh.quantized) {
+		mesh.vertexBytes = s_quantizedVerts.size() * sizeof(QuantizedVert_pos);
+		glBufferData(GL_ARRAY_BUFFER, mesh.vertexBytes, s_quantizedVerts.data(), GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(QuantizedVert_pos), nullptr);
+	}
+	else {
+		mesh.vertexBytes = mesh.positions.size() * sizeof(vec3);
+		glBufferData(GL_ARRAY_BUFFER, mesh.vertexBytes, mesh.positions.data(), GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), nullptr);
+	}
+	// attribute 1 (the color) stays disabled, it comes from glVertexAttrib4fv() when drawing
+	mesh.lods[0].ebo = createIndexBuffer(s_strip.data(), s_strip.size(), mesh.u16Inds);
+	glBindVertexArray(0);
+
+	LodJob job;
+	job.slot = u32(slot);
+	job.generation = mesh.generation;
+	job.u16Inds = mesh.u16Inds;
+	job.positions = mesh.positions;
+	job.inds = mesh.inds;
+	s_lodBuilder.push(std::move(job));
+
+	return MeshHandle(slot + 1);
+}
+
+MeshHandle createMesh(tl::CStridedSpan<vec3> positions, tl::CSpan<u32> inds)
+{
+	return createMesh(positions.data(), positions.stride(), u32(positions.size()), inds.begin(), u32(inds.size()));
+}
+
+void destroyMesh(MeshHandle handle)
+{
+	assert(handle > 0 && handle <= s_meshes.size() && s_meshes[handle - 1].alive);
+	RetainedMesh& mesh = s_meshes[handle - 1];
+	glDeleteVertexArrays(1, &mesh.vao);
+	glDeleteBuffers(1, &mesh.vbo);
+	for (u32 i = 0; i < mesh.numLods; i++)
+		glDeleteBuffers(1, &mesh.lods[i].ebo);
+	const u32 generation = mesh.generation;
+	mesh = {};
+	mesh.generation = generation;
+}
+
+void setMeshQuantization(bool quantize)
+{
+	s_quantize = quantize;
+}
+
+tl::CSpan<RetainedMesh> getRetainedMeshes()
+{
+	return { s_meshes.data(), s_meshes.size() };
+}
+
+u32 selectMeshLod(const RetainedMesh& mesh, const mat4& mtx, const MeshLodView& view)
+{
+	if (view.maxPixelError <= 0 || mesh.numLods == 1)
+		return 0;
+	const float scale = glm::max(glm::length(vec3(mtx[0])), glm::max(glm::length(vec3(mtx[1])), glm::length(vec3(mtx[2]))));
+	const float radius = scale * mesh.radius;
+	const float dist = glm::distance(vec3(mtx * vec4(mesh.center, 1)), view.cameraPos);
+	if (dist <= radius)
+		return 0;
+	const float projectedRadius = view.pixelsPerUnit * radius / dist;
+	u32 lod = 0;
+	while (lod + 1 < mesh.numLods && mesh.lods[lod + 1].error / mesh.radius * projectedRadius <= view.maxPixelError)
+		lod++;
+	return lod;
+}
+
+// the ranges of RetainedMesh::inds to draw for the LOD, the visible meshlets of the LOD 0 or the whole LOD
+static tl::CSpan<MeshletRange> getMeshDrawRanges(const RetainedMesh& mesh, u32 lodInd, const mat4& mtx, const mat4& viewProj,
+	const MeshLodView& view, FrameStats& stats)
+{
+	const MeshLod& lod = mesh.lods[lodInd];
+	if (s_meshletRanges.size() < glm::max(size_t(1), mesh.meshlets.size()))
+		s_meshletRanges.resize(glm::max(size_t(1), mesh.meshlets.size()));
+	if (lodInd != 0 || mesh.meshlets.empty() || !view.cullMeshlets) {
+		s_meshletRanges[0] = { lod.firstInd, lod.numInds };
+		stats.numMeshTriangles += lod.numInds / 3;
+		if (lodInd == 0)
+			stats.numMeshlets += u32(mesh.meshlets.size());
+		return { s_meshletRanges.data(), 1 };
+	}
+	// neither the GL nor the software backend culls back faces, so the meshlets that face away are visible too:
+	// only the frustum test
+	MeshletCullView cullView = getMeshletCullView(viewProj, mtx, view.cameraPos);
+	cullView.cones = false;
+	MeshletCullStats cullStats;
+	const u32 numRanges = cullMeshlets({ mesh.meshlets.data(), mesh.meshlets.size() }, cullView,
+		{ s_meshletRanges.data(), s_meshletRanges.size() }, &cullStats);
+	stats.numMeshTriangles += cullStats.numVisibleInds / 3;
+	stats.numMeshlets += cullStats.numVisible;
+	stats.numCulledMeshlets += cullStats.numFrustumCulled + cullStats.numBackfaceCulled;
+	return { s_meshletRanges.data(), numRanges };
+}
+
+void expandMeshDraws(State& state, const mat4& viewProj, const MeshLodView& view, FrameStats& stats)
+{
+	for (const MeshDraw& draw : state.meshDraws) {
+		const RetainedMesh& mesh = s_meshes[draw.mesh - 1];
+		const tl::CSpan<MeshletRange> ranges = getMeshDrawRanges(mesh, selectMeshLod(mesh, draw.mtx, view), draw.mtx, viewProj, view, stats);
+		std::vector<Triangle>& triangles = draw.color.a >= 1 ? state.triangles : state.transparentTriangles;
+		for (const MeshletRange& range : ranges) {
+			for (u32 i = range.firstInd; i < range.firstInd + range.numInds; i += 3) {
+				Triangle t;
+				Point* p = &t.a;
+				for (int k = 0; k < 3; k++)
+					p[k] = { vec3(draw.mtx * vec4(mesh.positions[mesh.inds[i + k]], 1)), draw.color };
+				triangles.push_back(t);
+			}
+		}
+		stats.numMeshDraws++;
+	}
+	state.meshDraws.clear();
+}
+
+void drawMeshes(tl::CSpan<MeshDraw> draws, const mat4& viewProj, i32 viewProjLoc, const MeshLodView& view, bool transparent, FrameStats& stats)
+{
+	bool any = false;
+	bool restart = false;
+	u32 restartIndex = 0;
+	for (const MeshDraw& draw : draws) {
+		if ((draw.color.a < 1) != transparent)
+			continue;
+		const RetainedMesh& mesh = s_meshes[draw.mesh - 1];
+		assert(mesh.alive);
+		const u32 lodInd = selectMeshLod(mesh, draw.mtx, view);
+		const MeshLod& lod = mesh.lods[lodInd];
+		const tl::CSpan<MeshletRange> ranges = getMeshDrawRanges(mesh, lodInd, draw.mtx, viewProj, view, stats);
+		stats.numMeshDraws++;
+		if (ranges.size() == 0)
+			continue;
+		const mat4 mtx = mesh.quantized ? viewProj * draw.mtx * getDequantizationMatrix(mesh.quantization) : viewProj * draw.mtx;
+		glUniformMatrix4fv(viewProjLoc, 1, GL_FALSE, &mtx[0][0]);
+		glVertexAttrib4fv(1, &draw.color[0]);
+		glBindVertexArray(mesh.vao);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, lod.ebo);
+		if (lod.strips) {
+			const u32 index = mesh.u16Inds ? 0xFFFF : STRIP_RESTART_INDEX;
+			if (!restart)
+				glEnable(GL_PRIMITIVE_RESTART);
+			if (!restart || restartIndex != index)
+				glPrimitiveRestartIndex(index);
+			restart = true;
+			restartIndex = index;
+		}
+		const GLenum indType = mesh.u16Inds ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		if (lodInd != 0 || mesh.meshlets.empty() || !view.cullMeshlets)
+			glDrawElements(lod.strips ? GL_TRIANGLE_STRIP : GL_TRIANGLES, GLsizei(lod.numGpuInds), indType, nullptr);
+		else {
+			// the LOD 0 of a mesh with meshlets is a list in the order of RetainedMesh::inds
+			const size_t indSize = mesh.u16Inds ? sizeof(u16) : sizeof(u32);
+			s_multiDrawCounts.resize(ranges.size());
+			s_multiDrawOffsets.resize(ranges.size());
+			for (size_t i = 0; i < ranges.size(); i++) {
+				s_multiDrawCounts[i] = GLsizei(ranges[i].numInds);
+				s_multiDrawOffsets[i] = (const void*)(ranges[i].firstInd * indSize);
+			}
+			glMultiDrawElements(GL_TRIANGLES, s_multiDrawCounts.data(), indType, s_multiDrawOffsets.data(), GLsizei(ranges.size()));
+		}
+		any = true;
+	}
+	if (restart)
+		glDisable(GL_PRIMITIVE_RESTART);
+	if (any)
+		glUniformMatrix4fv(viewProjLoc, 1, GL_FALSE, &viewProj[0][0]);
+}
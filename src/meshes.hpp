@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+#include "state.hpp"
+#include "geom/vertex_cache.hpp"
+#include "geom/vertex_fetch.hpp"
+#include "geom/overdraw.hpp"
+#include "geom/strips.hpp"
+#include "geom/quantize.hpp"
+#include "geom/meshlets.hpp"
+#include "tl/strided_span.hpp"
+
+// Retained meshes, see createMesh() in user_api.hpp
+// Besides the GL buffers we keep a copy of the optimized mesh on the CPU for the software renderer and the
+// captures, which only know about triangles
+// Every mesh gets a chain of simplified LODs that share its vertex buffer. A background thread builds them
+// after createMesh() and updateMeshLods() uploads them, until then only the LOD 0 (the full mesh) is drawn
+// The LOD 0 of the big meshes is split into meshlets, which are culled every frame against the frustum, so only
+// the ranges of triangles that can be visible are drawn
+
+constexpr u32 MAX_MESH_LODS = 6; // every LOD has half the triangles of the previous one
+
+struct MeshLod {
+	u32 ebo;
+	u32 firstInd, numInds; // its triangles in RetainedMesh::inds
+	// the GL index buffer: triangle strips with primitive restart when they are smaller than the list
+	bool strips;
+	u32 numGpuInds;
+	size_t indexBytes;
+	float error; // RMS distance to the full mesh
+};
+
+struct RetainedMesh {
+	bool alive;
+	u32 generation; // tells the LOD jobs of a reused slot apart
+	u32 vao, vbo;
+	std::vector<vec3> positions;
+	std::vector<u32> inds; // the triangles of all the LODs
+	MeshLod lods[MAX_MESH_LODS];
+	u32 numLods;
+	bool u16Inds; // the index buffers are u16 when the vertices allow it
+	// 16 bit positions in the bounding box, see setMeshQuantization(). positions has them dequantized so all the
+	// backends draw the same mesh
+	bool quantized;
+	PositionQuantization quantization;
+	QuantizationStats quantizationStats;
+	size_t vertexBytes; // of the GL vertex buffer
+	// of the LOD 0, whose index buffer is then a triangle list in the order of the meshlets. Empty for the small
+	// meshes, which keep their strips
+	std::vector<Meshlet> meshlets;
+	vec3 center; // bounding sphere
+	float radius;
+	// what the optimization at creation did
+	VertexCacheStats cacheBefore, cacheAfter;
+	VertexFetchStats fetchBefore, fetchAfter;
+	OverdrawStats overdrawBefore, overdrawAfter;
+	u32 numInputVerts; // before the weld
+	float optimizeTime; // seconds
+	float lodTime; // seconds the background thread took to build the LODs
+};
+
+tl::CSpan<RetainedMesh> getRetainedMeshes(); // the handle of a mesh is its index + 1
+
+// createMesh() from either layout: the positions can be a stream of a SoaMesh or the members of vertex structs
+MeshHandle createMesh(tl::CStridedSpan<vec3> positions, tl::CSpan<u32> inds);
+
+// the meshes created after this get 8 byte quantized positions instead of 12 byte floats, the draws fold the
+// decode into their matrix
+void setMeshQuantization(bool quantize);
+
+// uploads the LOD chains that the background thread finished, or waits for all of them
+void updateMeshLods(bool wait);
+
+// what the LOD selection and the meshlet culling need to know about the view
+struct MeshLodView {
+	vec3 cameraPos;
+	float pixelsPerUnit; // size in pixels of 1 unit at distance 1: viewportHeight / (2 tan(fovY / 2))
+	float maxPixelError; // 0 always draws the full meshes
+	bool cullMeshlets; // false draws all the meshlets
+};
+
+// the coarsest LOD whose error stays below view.maxPixelError: the error relative to the radius times the
+// projected size of the bounding sphere in pixels
+u32 selectMeshLod(const RetainedMesh& mesh, const mat4& mtx, const MeshLodView& view);
+
+// turns the mesh draws of the state into triangles, for the consumers of DrawLists; the meshlets are culled with viewProj
+void expandMeshDraws(State& state, const mat4& viewProj, const MeshLodView& view, FrameStats& stats);
+
+// draws the opaque (color.a >= 1) or the transparent mesh draws, with the program that has the u_viewProj
+// uniform at viewProjLoc; the uniform is left set to viewProj
+void drawMeshes(tl::CSpan<MeshDraw> draws, const mat4& viewProj, i32 viewProjLoc, const MeshLodView& view, bool transparent, FrameStats& stats);
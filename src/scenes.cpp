@@ -0,0 +1,265 @@
+#include "scenes.hpp"
+
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+#include "state.hpp"
+#include "meshes.hpp"
+#include "geom/icosphere.hpp"
+#include "geom/cylinder.hpp"
+#include "geom/mesh_cache.hpp"
+#include "geom/soa_mesh.hpp"
+
+// a heightfield of opaque triangles, the typical "lots of small triangles" case
+static void drawGrid(float dt)
+{
+	constexpr int N = 128;
+	constexpr float SIZE = 4;
+	auto height = [](int x, int z) {
+		return 0.1f * glm::sin(0.3f * x) * glm::cos(0.2f * z);
+	};
+	auto vertex = [&](int x, int z) {
+		return vec3(SIZE * (float(x) / N - 0.5f), height(x, z) - 0.5f, SIZE * (float(z) / N - 0.5f));
+	};
+	for (int z = 0; z < N; z++)
+	for (int x = 0; x < N; x++) {
+		pushColor({ float(x) / N, 0.5f, float(z) / N, 1 });
+		drawTriangle(vertex(x, z), vertex(x, z + 1), vertex(x + 1, z + 1));
+		drawTriangle(vertex(x, z), vertex(x + 1, z + 1), vertex(x + 1, z));
+		popColor();
+	}
+}
+
+// stacked transparent quads, stresses blending and overdraw
+static void drawLayers(float dt)
+{
+	constexpr int NUM_LAYERS = 64;
+	for (int i = 0; i < NUM_LAYERS; i++) {
+		const float z = -2 + 3.f * i / NUM_LAYERS;
+		pushColor({ 1 - float(i) / NUM_LAYERS, float(i) / NUM_LAYERS, 0.5f, 0.1f });
+		drawTriangle({ -1, -1, z }, { 1, -1, z }, { 1, 1, z });
+		drawTriangle({ -1, -1, z }, { 1, 1, z }, { -1, 1, z });
+		popColor();
+	}
+}
+
+// a 3D lattice of lines and points
+static void drawLattice(float dt)
+{
+	constexpr int N = 24;
+	constexpr float STEP = 0.1f;
+	const vec3 origin(-0.5f * N * STEP);
+	pushColor({ 0.8f, 0.8f, 0.8f, 1 });
+	for (int i = 0; i < N; i++)
+	for (int j = 0; j < N; j++) {
+		const float a = i * STEP, b = j * STEP, end = (N - 1) * STEP;
+		drawLine(origin + vec3(0, a, b), origin + vec3(end, a, b));
+		drawLine(origin + vec3(a, 0, b), origin + vec3(a, end, b));
+		drawLine(origin + vec3(a, b, 0), origin + vec3(a, b, end));
+		for (int k = 0; k < N; k++)
+			drawPoint(origin + vec3(a, b, k * STEP));
+	}
+	popColor();
+}
+
+// instances of a retained icosphere, nothing is resubmitted per frame
+static MeshHandle s_sphereMesh = 0;
+static MeshHandle s_cylinderMesh = 0; // its caps and sides have their own vertices, createMesh() welds them
+
+static void initMeshes()
+{
+	constexpr int SUBDIVS = 5;
+	std::vector<vec3> verts(icosphereNumVerts(SUBDIVS));
+	std::vector<u32> inds(icosphereNumInds(SUBDIVS));
+	generateIcosphere({ verts.data(), verts.size() }, { inds.data(), inds.size() }, SUBDIVS, true);
+	s_sphereMesh = createMesh(verts.data(), sizeof(vec3), u32(verts.size()), inds.data(), u32(inds.size()));
+
+	constexpr u32 RESOLUTION = 64;
+	std::vector<Vert_pos_normal> cylVerts(cylinderNumVerts(RESOLUTION));
+	std::vector<u32> cylInds(cylinderNumInds(RESOLUTION));
+	generateCylinder({ cylVerts.data(), cylVerts.size() }, { cylInds.data(), cylInds.size() }, 0.5f, 0, 2, RESOLUTION);
+	s_cylinderMesh = createMesh(attribView<Attrib_pos>(tl::CSpan<Vert_pos_normal>(cylVerts.data(), cylVerts.size())), { cylInds.data(), cylInds.size() });
+}
+
+static void drawMeshes(float dt)
+{
+	constexpr int N = 8;
+	for (int z = 0; z < N; z++)
+	for (int x = 0; x < N; x++) {
+		pushColor({ float(x) / N, 0.6f, float(z) / N, 1 });
+		pushMtx(glm::translate(mat4(1), vec3(x - 0.5f * N, -1, -z)) * glm::scale(mat4(1), vec3(0.4f)));
+		drawMesh(s_sphereMesh);
+		popMtx();
+		popColor();
+	}
+	pushColor({ 0.8f, 0.8f, 0.8f, 1 });
+	pushMtx(glm::translate(mat4(1), vec3(0, -1.4f, -N)));
+	drawMesh(s_cylinderMesh);
+	popMtx();
+	popColor();
+}
+
+// the same icosphere over a field that goes far into the distance, most instances cover a few pixels
+static void drawCrowd(float dt)
+{
+	constexpr int N = 32;
+	constexpr float SPACING = 2;
+	for (int z = 0; z < N; z++)
+	for (int x = 0; x < N; x++) {
+		pushColor({ float(x) / N, 0.6f, float(z) / N, 1 });
+		pushMtx(glm::translate(mat4(1), vec3(SPACING * (x - 0.5f * N), -1, -1 - SPACING * z)) * glm::scale(mat4(1), vec3(0.4f)));
+		drawMesh(s_sphereMesh);
+		popMtx();
+		popColor();
+	}
+}
+
+// the inside of a bumpy cave of 327K triangles around the camera, a big scan viewed from inside: the meshlets
+// outside the frustum are culled
+static MeshHandle s_caveMesh = 0;
+
+static void initCave()
+{
+	constexpr int SUBDIVS = 7;
+	constexpr float RADIUS = 10;
+	std::vector<vec3> verts(icosphereNumVerts(SUBDIVS));
+	std::vector<u32> inds(icosphereNumInds(SUBDIVS));
+	generateIcosphere({ verts.data(), verts.size() }, { inds.data(), inds.size() }, SUBDIVS, true);
+	for (vec3& v : verts)
+		v *= RADIUS * (1 + 0.15f * glm::sin(3 * v.x) * glm::sin(4 * v.y) * glm::sin(5 * v.z));
+	// the walls face inside
+	for (size_t i = 0; i < inds.size(); i += 3)
+		std::swap(inds[i + 1], inds[i + 2]);
+	s_caveMesh = createMesh(verts.data(), sizeof(vec3), u32(verts.size()), inds.data(), u32(inds.size()));
+}
+
+static void drawCave(float dt)
+{
+	pushColor({ 0.7f, 0.55f, 0.4f, 1 });
+	drawMesh(s_caveMesh);
+	popColor();
+}
+
+// a molecule of 2000 atoms going 40 units away, drawn as icospheres from the mesh cache. The adaptive one
+// gives every atom the level of its size on screen, the fixed one the same level to all of them
+struct Atom {
+	vec3 pos;
+	float radius;
+	vec4 color;
+};
+static std::vector<Atom> s_atoms;
+static std::vector<u8> s_atomSubDivs;
+constexpr int MOLECULE_MAX_SUBDIVS = 6;
+constexpr int MOLECULE_FIXED_SUBDIVS = 4;
+
+static void initMolecule()
+{
+	constexpr u32 NUM_ATOMS = 2000;
+	const vec4 colors[] = { { 0.3f, 0.3f, 0.3f, 1 }, { 0.9f, 0.1f, 0.1f, 1 }, { 0.2f, 0.3f, 0.9f, 1 }, { 0.95f, 0.95f, 0.95f, 1 } };
+	const float radii[] = { 0.5f, 0.45f, 0.45f, 0.25f };
+	s_atoms.resize(NUM_ATOMS);
+	s_atomSubDivs.resize(NUM_ATOMS);
+	u32 seed = 1;
+	auto random = [&seed]() {
+		seed = seed * 1664525u + 1013904223u;
+		return float(seed >> 8) / (1 << 24);
+	};
+	for (Atom& atom : s_atoms) {
+		const int element = int(random() * 4);
+		atom.pos = { 16 * random() - 8, 6 * random() - 4, -2 - 38 * random() };
+		atom.radius = radii[element];
+		atom.color = colors[element];
+	}
+}
+
+static CMeshSpans<vec3> getIcosphereLevel(int subDivs)
+{
+	char key[64];
+	snprintf(key, sizeof(key), "icosphere/%d/normalized", subDivs);
+	return getMeshCache().get<vec3>(key, icosphereNumVerts(subDivs), icosphereNumInds(subDivs),
+		[subDivs](tl::Span<vec3> verts, tl::Span<u32> inds) {
+			generateIcosphere(verts, inds, subDivs, true);
+		});
+}
+
+// the atoms are drawn level by level, so each level is only looked up once
+static void drawAtoms()
+{
+	for (int subDivs = 0; subDivs <= MOLECULE_MAX_SUBDIVS; subDivs++) {
+		const CMeshSpans<vec3> mesh = getIcosphereLevel(subDivs);
+		for (size_t a = 0; a < s_atoms.size(); a++) {
+			if (s_atomSubDivs[a] != subDivs)
+				continue;
+			const Atom& atom = s_atoms[a];
+			pushColor(atom.color);
+			pushMtx(glm::translate(mat4(1), atom.pos) * glm::scale(mat4(1), vec3(atom.radius)));
+			for (size_t i = 0; i < mesh.inds.size(); i += 3)
+				drawTriangle(mesh.verts[mesh.inds[i]], mesh.verts[mesh.inds[i + 1]], mesh.verts[mesh.inds[i + 2]]);
+			popMtx();
+			popColor();
+		}
+	}
+}
+
+static void drawMoleculeAdaptive(float dt)
+{
+	constexpr float MAX_PIXEL_ERROR = 0.5f;
+	const ViewInfo view = getViewInfo();
+	for (size_t a = 0; a < s_atoms.size(); a++) {
+		const float dist = glm::distance(s_atoms[a].pos, view.cameraPos);
+		const float projectedRadius = dist > s_atoms[a].radius ? view.pixelsPerUnit * s_atoms[a].radius / dist : FLT_MAX;
+		s_atomSubDivs[a] = u8(selectIcosphereSubDivs(projectedRadius, MAX_PIXEL_ERROR, MOLECULE_MAX_SUBDIVS));
+	}
+	drawAtoms();
+}
+
+// the adaptive levels drawn with drawSphere(), the vertex shader makes the triangles
+static void drawMoleculeSpheres(float dt)
+{
+	constexpr float MAX_PIXEL_ERROR = 0.5f;
+	const ViewInfo view = getViewInfo();
+	for (const Atom& atom : s_atoms) {
+		const float dist = glm::distance(atom.pos, view.cameraPos);
+		const float projectedRadius = dist > atom.radius ? view.pixelsPerUnit * atom.radius / dist : FLT_MAX;
+		pushColor(atom.color);
+		drawSphere(atom.pos, atom.radius, selectIcosphereSubDivs(projectedRadius, MAX_PIXEL_ERROR, MOLECULE_MAX_SUBDIVS));
+		popColor();
+	}
+}
+
+static void drawMoleculeFixed(float dt)
+{
+	std::fill(s_atomSubDivs.begin(), s_atomSubDivs.end(), u8(MOLECULE_FIXED_SUBDIVS));
+	drawAtoms();
+}
+
+static void initNothing() {}
+
+static const Scene s_scenes[] = {
+	{ "user", "the scene in user_code.cpp", userInit, userDraws },
+	{ "grid", "heightfield of 32K opaque triangles", initNothing, drawGrid },
+	{ "layers", "64 overlapping transparent quads", initNothing, drawLayers },
+	{ "lattice", "1.7K lines and 14K points", initNothing, drawLattice },
+	{ "meshes", "64 instances of a retained 20K triangle icosphere and a cylinder", initMeshes, drawMeshes },
+	{ "crowd", "1024 instances of the icosphere up to 64 units away, for the mesh LODs", initMeshes, drawCrowd },
+	{ "molecule", "2000 atoms with the icosphere level of their size on screen", initMolecule, drawMoleculeAdaptive },
+	{ "molecule-fixed", "the same atoms, all with 4 subdivisions", initMolecule, drawMoleculeFixed },
+	{ "cave", "the inside of a retained mesh of 327K triangles, for the meshlet culling", initCave, drawCave },
+	{ "molecule-spheres", "the adaptive atoms as procedural spheres, without vertex buffers", initMolecule, drawMoleculeSpheres },
+};
+
+tl::CSpan<Scene> getScenes()
+{
+	return s_scenes;
+}
+
+const Scene* findScene(const char* name)
+{
+	for (const Scene& scene : getScenes())
+		if (strcmp(scene.name, name) == 0)
+			return &scene;
+	return nullptr;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "tl/span.hpp"
+
+// Scenes selectable with --scene, so performance runs don't depend on what is in user_code.cpp
+// "user" runs userInit()/userDraws(), the others are generated workloads
+
+struct Scene {
+	const char* name;
+	const char* description;
+	void (*init)();
+	void (*draw)(float dt);
+};
+
+tl::CSpan<Scene> getScenes();
+const Scene* findScene(const char* name); // nullptr if there is no such scene
@@ -0,0 +1,246 @@
+#include "spheres.hpp"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include "geom/icosphere.hpp"
+#include "tl/parallel.hpp"
+
+static_assert(MAX_SPHERE_SUBDIVS <= ICOSPHERE_MAX_SUBDIVS, "drawSphere() allows levels that generateIcosphere() doesn't");
+static_assert(2 * MAX_SPHERE_SUBDIVS <= 24, "the triangle index in a face of the top level has to be exact in a float for the row decode");
+
+// what the instance buffer has for every sphere
+struct SphereInstance {
+	vec4 sphere;
+	vec4 color;
+};
+
+static u32 s_prog = 0;
+static i32 s_viewProjLoc, s_subDivsLoc;
+static u32 s_vao, s_instanceVbo;
+static std::vector<SphereInstance> s_instances; // the draws of a pass sorted by level, it only grows
+static std::vector<vec3> s_unitSpheres[MAX_SPHERE_SUBDIVS + 1]; // the vertices of every level for expandSphereDraws()
+
+// the same decode as getIcosphereProceduralVertex(), the tables of the icosahedron are added by initSphereRenderer()
+static const char* SPHERE_VERT_SHADER_SRC =
+R"GLSL(
+uniform mat4 u_viewProj;
+uniform int u_subDivs;
+
+layout(location = 0) in vec4 a_sphere; // center, radius
+layout(location = 1) in vec4 a_color;
+
+out vec4 v_color;
+
+void main()
+{
+	int tri = gl_VertexID / 3;
+	int corner = gl_VertexID - 3 * tri;
+	int face = tri >> (2 * u_subDivs);
+	int l = tri - (face << (2 * u_subDivs));
+	// the row r of the face has 2r+1 triangles, alternating up and down
+	int r = int(sqrt(float(l)));
+	if((r + 1) * (r + 1) <= l)
+		r++;
+	else if(r * r > l)
+		r--;
+	int k = l - r * r;
+	int row = r, col = k >> 1;
+	if((k & 1) == 0) {
+		row += corner != 0 ? 1 : 0;
+		col += corner == 2 ? 1 : 0;
+	}
+	else {
+		row += corner == 1 ? 1 : 0;
+		col += corner != 0 ? 1 : 0;
+	}
+	int n = 1 << u_subDivs;
+
+	// the corners in the order of their index, so both faces of an edge make the same sum
+	ivec3 inds = ivec3(c_icosahedronFaces[3 * face], c_icosahedronFaces[3 * face + 1], c_icosahedronFaces[3 * face + 2]);
+	vec3 weights = vec3(float(n - row), float(row - col), float(col));
+	if(inds.x > inds.y) { inds.xy = inds.yx; weights.xy = weights.yx; }
+	if(inds.y > inds.z) { inds.yz = inds.zy; weights.yz = weights.zy; }
+	if(inds.x > inds.y) { inds.xy = inds.yx; weights.xy = weights.yx; }
+	vec3 p = weights.x * c_icosahedronVerts[inds.x] + weights.y * c_icosahedronVerts[inds.y] + weights.z * c_icosahedronVerts[inds.z];
+
+	gl_Position = u_viewProj * vec4(a_sphere.xyz + a_sphere.w * normalize(p), 1.0);
+	v_color = a_color;
+}
+)GLSL";
+
+static const char* SPHERE_FRAG_SHADER_SRC =
+R"GLSL(
+#version 330 core
+layout(location = 0) out vec4 o_color;
+
+in vec4 v_color;
+
+void main()
+{
+	o_color = v_color;
+}
+)GLSL";
+
+static u32 compileShader(GLenum type, const char* src)
+{
+	const u32 shader = glCreateShader(type);
+	glShaderSource(shader, 1, &src, nullptr);
+	glCompileShader(shader);
+	i32 ok;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+	if (!ok) {
+		char log[4 * 1024];
+		glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+		printf("sphere shader compile error:\n%s\n", log);
+		assert(false);
+	}
+	return shader;
+}
+
+// the first and last triangles of every row of the top level, where sqrt(float(l)) rounds to the wrong row if
+// anywhere, decode to their row
+static bool checkRowDecode()
+{
+	const u32 n = 1u << MAX_SPHERE_SUBDIVS;
+	for (u32 r = 0; r < n; r++) {
+		if (getIcosphereProceduralRow(r * r) != r || getIcosphereProceduralRow(r * r + 2 * r) != r)
+			return false;
+	}
+	return true;
+}
+
+void initSphereRenderer()
+{
+	if (!checkRowDecode()) {
+		printf("the sphere row decode isn't exact at %d subdivisions\n", MAX_SPHERE_SUBDIVS);
+		assert(false);
+	}
+	// the vertices of the icosahedron go in with all their digits, the GPU has to make the same points as the CPU
+	std::string vertSrc = "#version 330 core\nconst vec3 c_icosahedronVerts[12] = vec3[12](\n";
+	char buffer[128];
+	const tl::CSpan<vec3> verts = getIcosahedronVerts();
+	for (size_t i = 0; i < verts.size(); i++) {
+		snprintf(buffer, sizeof(buffer), "\tvec3(%.9g, %.9g, %.9g)%s\n", verts[i].x, verts[i].y, verts[i].z, i + 1 < verts.size() ? "," : "");
+		vertSrc += buffer;
+	}
+	const tl::CSpan<u8> faces = getIcosahedronFaceInds();
+	snprintf(buffer, sizeof(buffer), ");\nconst int c_icosahedronFaces[%zu] = int[%zu](", faces.size(), faces.size());
+	vertSrc += buffer;
+	for (size_t i = 0; i < faces.size(); i++) {
+		snprintf(buffer, sizeof(buffer), "%d%s", faces[i], i + 1 < faces.size() ? ", " : ");\n");
+		vertSrc += buffer;
+	}
+	vertSrc += SPHERE_VERT_SHADER_SRC;
+
+	const u32 vertShad = compileShader(GL_VERTEX_SHADER, vertSrc.c_str());
+	const u32 fragShad = compileShader(GL_FRAGMENT_SHADER, SPHERE_FRAG_SHADER_SRC);
+	s_prog = glCreateProgram();
+	glAttachShader(s_prog, vertShad);
+	glAttachShader(s_prog, fragShad);
+	glLinkProgram(s_prog);
+	i32 ok;
+	glGetProgramiv(s_prog, GL_LINK_STATUS, &ok);
+	if (!ok) {
+		char log[4 * 1024];
+		glGetProgramInfoLog(s_prog, sizeof(log), nullptr, log);
+		printf("sphere program link errors:\n%s\n", log);
+		assert(false);
+	}
+	glDeleteShader(vertShad);
+	glDeleteShader(fragShad);
+	s_viewProjLoc = glGetUniformLocation(s_prog, "u_viewProj");
+	s_subDivsLoc = glGetUniformLocation(s_prog, "u_subDivs");
+
+	// no vertex buffer, only the instance attributes
+	glGenVertexArrays(1, &s_vao);
+	glBindVertexArray(s_vao);
+	glGenBuffers(1, &s_instanceVbo);
+	glBindBuffer(GL_ARRAY_BUFFER, s_instanceVbo);
+	glBufferData(GL_ARRAY_BUFFER, 1, nullptr, GL_STREAM_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribDivisor(0, 1);
+	glEnableVertexAttribArray(1);
+	glVertexAttribDivisor(1, 1);
+	glBindVertexArray(0);
+}
+
+void drawSpheres(tl::CSpan<SphereDraw> draws, const mat4& viewProj, bool transparent, u32 program, FrameStats& stats)
+{
+	assert(s_prog);
+	// a counting sort by level
+	u32 offsets[MAX_SPHERE_SUBDIVS + 2] = {};
+	for (const SphereDraw& draw : draws) {
+		if ((draw.color.a < 1) == transparent)
+			offsets[draw.subDivs + 1]++;
+	}
+	for (int s = 0; s <= MAX_SPHERE_SUBDIVS; s++)
+		offsets[s + 1] += offsets[s];
+	const u32 numInstances = offsets[MAX_SPHERE_SUBDIVS + 1];
+	if (numInstances == 0)
+		return;
+	if (s_instances.size() < numInstances)
+		s_instances.resize(numInstances);
+	u32 cursors[MAX_SPHERE_SUBDIVS + 1];
+	memcpy(cursors, offsets, sizeof(cursors));
+	for (const SphereDraw& draw : draws) {
+		if ((draw.color.a < 1) == transparent)
+			s_instances[cursors[draw.subDivs]++] = {draw.sphere, draw.color};
+	}
+
+	glUseProgram(s_prog);
+	glUniformMatrix4fv(s_viewProjLoc, 1, GL_FALSE, &viewProj[0][0]);
+	glBindVertexArray(s_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, s_instanceVbo);
+	glBufferData(GL_ARRAY_BUFFER, numInstances * sizeof(SphereInstance), s_instances.data(), GL_STREAM_DRAW);
+	for (int s = 0; s <= MAX_SPHERE_SUBDIVS; s++) {
+		const u32 count = offsets[s + 1] - offsets[s];
+		if (count == 0)
+			continue;
+		// GL 3.3 has no base instance, the attributes start at the first instance of the level instead
+		const size_t offset = offsets[s] * sizeof(SphereInstance);
+		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(SphereInstance), (void*)offset);
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(SphereInstance), (void*)(offset + sizeof(vec4)));
+		glUniform1i(s_subDivsLoc, s);
+		glDrawArraysInstanced(GL_TRIANGLES, 0, GLsizei(icosphereNumProceduralVerts(s)), GLsizei(count));
+		stats.numSphereDraws += count;
+		stats.numSphereTriangles += count * (icosphereNumProceduralVerts(s) / 3);
+	}
+	glBindVertexArray(0);
+	glUseProgram(program);
+}
+
+static tl::CSpan<vec3> getUnitSphere(int subDivs)
+{
+	std::vector<vec3>& verts = s_unitSpheres[subDivs];
+	if (verts.empty()) {
+		verts.resize(icosphereNumProceduralVerts(subDivs));
+		tl::parallelFor(0, verts.size(), 4096, [&](size_t i) {
+			verts[i] = getIcosphereProceduralVertex(subDivs, u32(i));
+		});
+	}
+	return { verts.data(), verts.size() };
+}
+
+void expandSphereDraws(State& state, FrameStats& stats)
+{
+	for (const SphereDraw& draw : state.sphereDraws) {
+		const tl::CSpan<vec3> verts = getUnitSphere(draw.subDivs);
+		const vec3 center = vec3(draw.sphere);
+		const float radius = draw.sphere.w;
+		std::vector<Triangle>& triangles = draw.color.a >= 1 ? state.triangles : state.transparentTriangles;
+		for (size_t i = 0; i < verts.size(); i += 3) {
+			triangles.push_back({
+				Point{center + radius * verts[i], draw.color},
+				Point{center + radius * verts[i + 1], draw.color},
+				Point{center + radius * verts[i + 2], draw.color}
+			});
+		}
+		stats.numSphereDraws++;
+		stats.numSphereTriangles += u32(verts.size() / 3);
+	}
+	state.sphereDraws.clear();
+}
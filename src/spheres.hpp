@@ -0,0 +1,17 @@
+#pragma once
+
+#include "state.hpp"
+
+// Spheres drawn with drawSphere(), see user_api.hpp
+// The vertex shader decodes the icosphere vertex of gl_VertexID (see getIcosphereProceduralVertex()), so the
+// only vertex data are the instances: center, radius and color. The draws of a pass are sorted by level and
+// every level is one instanced draw
+
+// compiles the program, needs the GL context
+void initSphereRenderer();
+
+// draws the opaque (color.a >= 1) or the transparent sphere draws with its own program, then binds program again
+void drawSpheres(tl::CSpan<SphereDraw> draws, const mat4& viewProj, bool transparent, u32 program, FrameStats& stats);
+
+// turns the sphere draws of the state into triangles, for the consumers of DrawLists
+void expandSphereDraws(State& state, FrameStats& stats);
@@ -0,0 +1,113 @@
+#include "state.hpp"
+
+#include <assert.h>
+
+State s_state;
+
+void resetState()
+{
+	s_state.color.resize(1);
+	s_state.color[0] = { 1,1,1,1 };
+	s_state.mtx.resize(1);
+	s_state.mtx[0] = mat4(1);
+	s_state.points.clear();
+	s_state.lines.clear();
+	s_state.triangles.clear();
+	s_state.transparentTriangles.clear();
+	s_state.meshDraws.clear();
+	s_state.sphereDraws.clear();
+}
+
+DrawLists getDrawLists(const State& state)
+{
+	return {
+		{state.points.data(), state.points.size()},
+		{state.lines.data(), state.lines.size()},
+		{state.triangles.data(), state.triangles.size()},
+		{state.transparentTriangles.data(), state.transparentTriangles.size()},
+	};
+}
+
+template <typename T>
+static size_t usedBytes(const std::vector<T>& v) { return v.size() * sizeof(T); }
+template <typename T>
+static size_t capacityBytes(const std::vector<T>& v) { return v.capacity() * sizeof(T); }
+
+size_t getStateSize(const State& state)
+{
+	return usedBytes(state.color) + usedBytes(state.mtx) + usedBytes(state.points) + usedBytes(state.lines) +
+		usedBytes(state.triangles) + usedBytes(state.transparentTriangles) + usedBytes(state.meshDraws) + usedBytes(state.sphereDraws);
+}
+
+size_t getStateCapacity(const State& state)
+{
+	return capacityBytes(state.color) + capacityBytes(state.mtx) + capacityBytes(state.points) + capacityBytes(state.lines) +
+		capacityBytes(state.triangles) + capacityBytes(state.transparentTriangles) + capacityBytes(state.meshDraws) + capacityBytes(state.sphereDraws);
+}
+
+void pushColor(vec4 c) { s_state.color.push_back(c); }
+void popColor() { s_state.color.pop_back(); }
+
+void pushMtx(mat4 m)
+{
+	s_state.mtx.push_back(s_state.mtx.back() * m);
+}
+void popMtx() { s_state.mtx.pop_back(); }
+
+void drawPoint(vec3 a)
+{
+	const mat4 m = s_state.mtx.back();
+	const vec4 color = s_state.color.back();
+	a = m * vec4(a, 1);
+	s_state.points.push_back(Point{ a, color });
+}
+
+void drawLine(vec3 a, vec3 b)
+{
+	const mat4 m = s_state.mtx.back();
+	const vec4 color = s_state.color.back();
+	a = m * vec4(a, 1);
+	b = m * vec4(b, 1);
+	s_state.lines.push_back({
+		Point{a, color},
+		Point{b, color}
+	});
+}
+
+void drawTriangle(vec3 a, vec3 b, vec3 c)
+{
+	const mat4 m = s_state.mtx.back();
+	const vec4 color = s_state.color.back();
+	a = m * vec4(a, 1);
+	b = m * vec4(b, 1);
+	c = m * vec4(c, 1);
+	if(color.a >= 1) {
+		s_state.triangles.push_back({
+			Point{a, color},
+			Point{b, color},
+			Point{c, color}
+		});
+	}
+	else {
+		s_state.transparentTriangles.push_back({
+			Point{a, color},
+			Point{b, color},
+			Point{c, color}
+		});
+	}
+}
+
+void drawMesh(MeshHandle mesh)
+{
+	assert(mesh);
+	s_state.meshDraws.push_back({mesh, s_state.mtx.back(), s_state.color.back()});
+}
+
+void drawSphere(vec3 center, float radius, int subDivs)
+{
+	// a level out of range would index past the unit spheres and the draw buckets, in release too
+	subDivs = glm::clamp(subDivs, 0, MAX_SPHERE_SUBDIVS);
+	const mat4& m = s_state.mtx.back();
+	const float scale = glm::max(glm::length(vec3(m[0])), glm::max(glm::length(vec3(m[1])), glm::length(vec3(m[2]))));
+	s_state.sphereDraws.push_back({vec4(vec3(m * vec4(center, 1)), scale * radius), s_state.color.back(), subDivs});
+}
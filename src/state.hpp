@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include "user_api.hpp"
+#include "tl/span.hpp"
+
+struct Point {
+	vec3 pos;
+	vec4 color;
+};
+
+struct Line {
+	Point a, b;
+};
+
+struct Triangle {
+	Point a, b, c;
+};
+
+struct MeshDraw {
+	MeshHandle mesh;
+	mat4 mtx;
+	vec4 color;
+};
+
+struct SphereDraw {
+	vec4 sphere; // center and radius, in world space
+	vec4 color;
+	i32 subDivs;
+};
+
+struct State { // this current state of the frame
+	std::vector<vec4> color;
+	std::vector<mat4> mtx;
+	std::vector<Point> points;
+	std::vector<Line> lines;
+	std::vector<Triangle> triangles;
+	std::vector<Triangle> transparentTriangles;
+	std::vector<MeshDraw> meshDraws;
+	std::vector<SphereDraw> sphereDraws;
+};
+extern State s_state;
+
+// the primitive streams consumed by the renderers, they can point into a State or into a capture file
+struct DrawLists {
+	tl::CSpan<Point> points;
+	tl::CSpan<Line> lines;
+	tl::CSpan<Triangle> triangles;
+	tl::CSpan<Triangle> transparentTriangles;
+};
+DrawLists getDrawLists(const State& state);
+
+size_t getStateSize(const State& state);
+size_t getStateCapacity(const State& state);
+
+// clears the primitives and leaves only the default color and matrix in the stacks
+void resetState();
+
+void pushMtx(mat4 m);
+void popMtx();
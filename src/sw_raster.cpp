@@ -0,0 +1,484 @@
+#include "sw_raster.hpp"
+
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include "tl/parallel.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define SW_RASTER_SSE
+	#include <emmintrin.h>
+#endif
+
+namespace
+{
+
+constexpr size_t SETUP_CHUNK_SIZE = 4096; // triangles per setup job
+
+enum Bin { BIN_OPAQUE_TRIS, BIN_LINES, BIN_POINTS, BIN_TRANSPARENT_TRIS, NUM_BINS };
+
+struct ScreenVert {
+	float x, y, z;
+};
+
+struct TriSetup {
+	// edge functions: E(x, y) = A*x + B*y + C, the pixel is inside when E >= edgeMin for the 3 edges
+	float edgeA[3], edgeB[3], edgeC[3];
+	float edgeMin[3]; // 0 for top-left edges and FLT_MIN for the rest (top-left fill rule)
+	// the depth plane anchored at a vertex: z = z0 + dzdx * (x - x0) + dzdy * (y - y0). An absolute plane would sum
+	// terms of the size of x * y that cancel, losing the small depth differences of a far plane far away
+	float x0, y0, z0, dzdx, dzdy;
+	int minX, minY, maxX, maxY;
+	vec4 color; // the immediate API gives the same color to the 3 vertices so we shade flat
+};
+
+struct LineSetup {
+	ScreenVert a, b;
+	vec4 color;
+	int minX, minY, maxX, maxY; // minX > maxX for culled lines
+};
+
+struct PointSetup {
+	int x, y; // x < 0 for culled points
+	float z;
+	vec4 color;
+};
+
+struct Tile {
+	int x0, y0, x1, y1; // [x0, x1) x [y0, y1)
+	std::vector<u32> bins[NUM_BINS];
+};
+
+struct Context {
+	std::vector<std::vector<TriSetup>> opaqueChunks, transparentChunks;
+	std::vector<LineSetup> lines;
+	std::vector<PointSetup> points;
+	std::vector<Tile> tiles;
+	int numTilesX = 0, numTilesY = 0;
+} s_ctx;
+
+double getTime()
+{
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+u32 packColor(vec4 c)
+{
+	c = glm::clamp(c, vec4(0), vec4(1));
+	return u32(c.r * 255 + 0.5f) | (u32(c.g * 255 + 0.5f) << 8) |
+		(u32(c.b * 255 + 0.5f) << 16) | (u32(c.a * 255 + 0.5f) << 24);
+}
+
+vec4 unpackColor(u32 c)
+{
+	return vec4(c & 0xFF, (c >> 8) & 0xFF, (c >> 16) & 0xFF, c >> 24) * (1.f / 255);
+}
+
+u32 blendColor(u32 dst, const vec4& src)
+{
+	// glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA) applied to the 4 channels
+	return packColor(src * src.a + unpackColor(dst) * (1 - src.a));
+}
+
+ScreenVert toScreen(const vec4& clip, float w, float h)
+{
+	const float invW = 1 / clip.w;
+	return {
+		(clip.x * invW * 0.5f + 0.5f) * w,
+		(clip.y * invW * 0.5f + 0.5f) * h,
+		clip.z * invW * 0.5f + 0.5f,
+	};
+}
+
+// distance to the near (z = -w) and far (z = w) planes, positive inside
+float nearDist(const vec4& v) { return v.z + v.w; }
+float farDist(const vec4& v) { return v.w - v.z; }
+
+template <typename DistFn>
+int clipPolygon(const vec4* in, int n, vec4* out, DistFn dist)
+{
+	int m = 0;
+	for (int i = 0; i < n; i++) {
+		const vec4& a = in[i];
+		const vec4& b = in[(i + 1) % n];
+		const float da = dist(a);
+		const float db = dist(b);
+		if (da >= 0)
+			out[m++] = a;
+		if ((da >= 0) != (db >= 0))
+			out[m++] = glm::mix(a, b, da / (da - db));
+	}
+	return m;
+}
+
+void emitTriangle(ScreenVert v0, ScreenVert v1, ScreenVert v2, const vec4& color, int w, int h, std::vector<TriSetup>& out)
+{
+	float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+	if (area == 0 || !isfinite(area))
+		return;
+	if (area < 0) { // no face culling in the GL path either
+		std::swap(v1, v2);
+		area = -area;
+	}
+
+	TriSetup t;
+	t.minX = std::max(0, int(floorf(std::min({v0.x, v1.x, v2.x}))));
+	t.minY = std::max(0, int(floorf(std::min({v0.y, v1.y, v2.y}))));
+	t.maxX = std::min(w - 1, int(ceilf(std::max({v0.x, v1.x, v2.x}))));
+	t.maxY = std::min(h - 1, int(ceilf(std::max({v0.y, v1.y, v2.y}))));
+	if (t.minX > t.maxX || t.minY > t.maxY)
+		return;
+
+	const ScreenVert v[3] = {v0, v1, v2};
+	const float invArea = 1 / area;
+	for (int i = 0; i < 3; i++) {
+		// edge opposite to the vertex i, E(v[i]) == area
+		const ScreenVert& a = v[(i + 1) % 3];
+		const ScreenVert& b = v[(i + 2) % 3];
+		t.edgeA[i] = a.y - b.y;
+		t.edgeB[i] = b.x - a.x;
+		t.edgeC[i] = a.x * b.y - a.y * b.x;
+		const bool isLeft = t.edgeA[i] > 0;
+		const bool isTop = t.edgeA[i] == 0 && t.edgeB[i] < 0;
+		t.edgeMin[i] = isLeft || isTop ? 0 : FLT_MIN;
+	}
+	const float x1 = v1.x - v0.x, y1 = v1.y - v0.y, z1 = v1.z - v0.z;
+	const float x2 = v2.x - v0.x, y2 = v2.y - v0.y, z2 = v2.z - v0.z;
+	t.x0 = v0.x;
+	t.y0 = v0.y;
+	t.z0 = v0.z;
+	t.dzdx = (z1 * y2 - z2 * y1) * invArea;
+	t.dzdy = (x1 * z2 - x2 * z1) * invArea;
+	t.color = color;
+	out.push_back(t);
+}
+
+void setupTriangle(const Triangle& tri, const mat4& viewProj, int w, int h, std::vector<TriSetup>& out)
+{
+	vec4 poly[2][6] = {{
+		viewProj * vec4(tri.a.pos, 1),
+		viewProj * vec4(tri.b.pos, 1),
+		viewProj * vec4(tri.c.pos, 1),
+	}};
+	int n = 3;
+	const bool needsClip =
+		nearDist(poly[0][0]) < 0 || nearDist(poly[0][1]) < 0 || nearDist(poly[0][2]) < 0 ||
+		farDist(poly[0][0]) < 0 || farDist(poly[0][1]) < 0 || farDist(poly[0][2]) < 0;
+	if (needsClip) {
+		n = clipPolygon(poly[0], n, poly[1], nearDist);
+		n = clipPolygon(poly[1], n, poly[0], farDist);
+	}
+
+	const ScreenVert s0 = toScreen(poly[0][0], w, h);
+	for (int i = 1; i + 1 < n; i++)
+		emitTriangle(s0, toScreen(poly[0][i], w, h), toScreen(poly[0][i + 1], w, h), tri.a.color, w, h, out);
+}
+
+LineSetup setupLine(const Line& line, const mat4& viewProj, int w, int h)
+{
+	LineSetup l;
+	l.minX = 1; l.maxX = 0; // culled
+	vec4 a = viewProj * vec4(line.a.pos, 1);
+	vec4 b = viewProj * vec4(line.b.pos, 1);
+	for (auto dist : {nearDist, farDist}) {
+		const float da = dist(a);
+		const float db = dist(b);
+		if (da < 0 && db < 0)
+			return l;
+		if (da < 0)
+			a = glm::mix(a, b, da / (da - db));
+		else if (db < 0)
+			b = glm::mix(a, b, da / (da - db));
+	}
+
+	l.a = toScreen(a, w, h);
+	l.b = toScreen(b, w, h);
+	l.color = line.a.color;
+	l.minX = std::max(0, int(floorf(std::min(l.a.x, l.b.x))));
+	l.minY = std::max(0, int(floorf(std::min(l.a.y, l.b.y))));
+	l.maxX = std::min(w - 1, int(floorf(std::max(l.a.x, l.b.x))));
+	l.maxY = std::min(h - 1, int(floorf(std::max(l.a.y, l.b.y))));
+	return l;
+}
+
+PointSetup setupPoint(const Point& point, const mat4& viewProj, int w, int h)
+{
+	PointSetup p;
+	p.x = -1;
+	const vec4 c = viewProj * vec4(point.pos, 1);
+	if (nearDist(c) < 0 || farDist(c) < 0)
+		return p;
+	const ScreenVert s = toScreen(c, w, h);
+	if (s.x >= 0 && s.x < w && s.y >= 0 && s.y < h) {
+		p.x = int(s.x);
+		p.y = int(s.y);
+		p.z = s.z;
+		p.color = point.color;
+	}
+	return p;
+}
+
+// ---------------------------------------------------------------------------------------------
+void rasterTriangle(SwFramebuffer& fb, const Tile& tile, const TriSetup& t, bool transparent)
+{
+	const int y0 = std::max(t.minY, tile.y0);
+	const int y1 = std::min(t.maxY, tile.y1 - 1);
+	const int xFirst = std::max(t.minX, tile.x0);
+	const int xLast = std::min(t.maxX, tile.x1 - 1);
+	if (y0 > y1 || xFirst > xLast)
+		return;
+	const u32 color = packColor(t.color);
+
+#ifdef SW_RASTER_SSE
+	// 4 pixels at a time, tiles and the framebuffer stride are multiples of 4 so a group never leaves the tile
+	const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128i laneInds = _mm_setr_epi32(0, 1, 2, 3);
+	const __m128 A0 = _mm_set1_ps(t.edgeA[0]), A1 = _mm_set1_ps(t.edgeA[1]), A2 = _mm_set1_ps(t.edgeA[2]);
+	const __m128 min0 = _mm_set1_ps(t.edgeMin[0]), min1 = _mm_set1_ps(t.edgeMin[1]), min2 = _mm_set1_ps(t.edgeMin[2]);
+	const __m128 dzdx = _mm_set1_ps(t.dzdx), x0 = _mm_set1_ps(t.x0);
+	const __m128i color4 = _mm_set1_epi32(int(color));
+	const __m128i xFirst4 = _mm_set1_epi32(xFirst - 1);
+	const __m128i xLast4 = _mm_set1_epi32(xLast + 1);
+	for (int y = y0; y <= y1; y++) {
+		const float py = y + 0.5f;
+		const __m128 rowE0 = _mm_set1_ps(t.edgeB[0] * py + t.edgeC[0]);
+		const __m128 rowE1 = _mm_set1_ps(t.edgeB[1] * py + t.edgeC[1]);
+		const __m128 rowE2 = _mm_set1_ps(t.edgeB[2] * py + t.edgeC[2]);
+		const __m128 rowZ = _mm_set1_ps(t.dzdy * (py - t.y0) + t.z0);
+		u32* colorRow = &fb.color[size_t(y) * fb.stride];
+		float* depthRow = &fb.depth[size_t(y) * fb.stride];
+		for (int x = xFirst & ~3; x <= xLast; x += 4) {
+			const __m128 px = _mm_add_ps(_mm_set1_ps(float(x)), laneOffsets);
+			const __m128 e0 = _mm_add_ps(_mm_mul_ps(A0, px), rowE0);
+			const __m128 e1 = _mm_add_ps(_mm_mul_ps(A1, px), rowE1);
+			const __m128 e2 = _mm_add_ps(_mm_mul_ps(A2, px), rowE2);
+			__m128 mask = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, min0), _mm_cmpge_ps(e1, min1)), _mm_cmpge_ps(e2, min2));
+			const __m128i xi = _mm_add_epi32(_mm_set1_epi32(x), laneInds);
+			const __m128i inRange = _mm_and_si128(_mm_cmpgt_epi32(xi, xFirst4), _mm_cmplt_epi32(xi, xLast4));
+			mask = _mm_and_ps(mask, _mm_castsi128_ps(inRange));
+			if (_mm_movemask_ps(mask) == 0)
+				continue;
+
+			const __m128 z = _mm_add_ps(_mm_mul_ps(dzdx, _mm_sub_ps(px, x0)), rowZ);
+			const __m128 d = _mm_loadu_ps(depthRow + x);
+			mask = _mm_and_ps(mask, _mm_cmple_ps(z, d));
+			const int bits = _mm_movemask_ps(mask);
+			if (bits == 0)
+				continue;
+
+			if (transparent) {
+				for (int i = 0; i < 4; i++)
+					if (bits & (1 << i))
+						colorRow[x + i] = blendColor(colorRow[x + i], t.color);
+			}
+			else {
+				_mm_storeu_ps(depthRow + x, _mm_or_ps(_mm_and_ps(mask, z), _mm_andnot_ps(mask, d)));
+				const __m128i maski = _mm_castps_si128(mask);
+				const __m128i c = _mm_loadu_si128((const __m128i*)(colorRow + x));
+				_mm_storeu_si128((__m128i*)(colorRow + x), _mm_or_si128(_mm_and_si128(maski, color4), _mm_andnot_si128(maski, c)));
+			}
+		}
+	}
+#else
+	for (int y = y0; y <= y1; y++) {
+		const float py = y + 0.5f;
+		u32* colorRow = &fb.color[size_t(y) * fb.stride];
+		float* depthRow = &fb.depth[size_t(y) * fb.stride];
+		for (int x = xFirst; x <= xLast; x++) {
+			const float px = x + 0.5f;
+			bool inside = true;
+			for (int i = 0; i < 3; i++)
+				inside &= t.edgeA[i] * px + t.edgeB[i] * py + t.edgeC[i] >= t.edgeMin[i];
+			if (!inside)
+				continue;
+			const float z = t.z0 + t.dzdx * (px - t.x0) + t.dzdy * (py - t.y0);
+			if (z > depthRow[x])
+				continue;
+			if (transparent)
+				colorRow[x] = blendColor(colorRow[x], t.color);
+			else {
+				depthRow[x] = z;
+				colorRow[x] = color;
+			}
+		}
+	}
+#endif
+}
+
+void plot(SwFramebuffer& fb, int x, int y, float z, u32 color)
+{
+	const size_t i = size_t(y) * fb.stride + x;
+	if (z <= fb.depth[i]) {
+		fb.depth[i] = z;
+		fb.color[i] = color;
+	}
+}
+
+void rasterLine(SwFramebuffer& fb, const Tile& tile, const LineSetup& l)
+{
+	// one sample per pixel column (or row) along the major axis, like a DDA
+	const u32 color = packColor(l.color);
+	const float dx = l.b.x - l.a.x;
+	const float dy = l.b.y - l.a.y;
+	const float dz = l.b.z - l.a.z;
+	if (fabsf(dx) >= fabsf(dy)) {
+		if (dx == 0)
+			return;
+		const int from = std::max(tile.x0, int(ceilf(std::min(l.a.x, l.b.x) - 0.5f)));
+		const int to = std::min(tile.x1, int(ceilf(std::max(l.a.x, l.b.x) - 0.5f)));
+		for (int x = from; x < to; x++) {
+			const float t = (x + 0.5f - l.a.x) / dx;
+			const int y = int(floorf(l.a.y + t * dy));
+			if (y >= tile.y0 && y < tile.y1)
+				plot(fb, x, y, l.a.z + t * dz, color);
+		}
+	}
+	else {
+		const int from = std::max(tile.y0, int(ceilf(std::min(l.a.y, l.b.y) - 0.5f)));
+		const int to = std::min(tile.y1, int(ceilf(std::max(l.a.y, l.b.y) - 0.5f)));
+		for (int y = from; y < to; y++) {
+			const float t = (y + 0.5f - l.a.y) / dy;
+			const int x = int(floorf(l.a.x + t * dx));
+			if (x >= tile.x0 && x < tile.x1)
+				plot(fb, x, y, l.a.z + t * dz, color);
+		}
+	}
+}
+
+const TriSetup& getTriSetup(const std::vector<std::vector<TriSetup>>& chunks, u32 ref)
+{
+	return chunks[ref >> 16][ref & 0xFFFF];
+}
+
+void rasterTile(SwFramebuffer& fb, const Tile& tile, u32 clearColor)
+{
+	for (int y = tile.y0; y < tile.y1; y++) {
+		std::fill_n(&fb.color[size_t(y) * fb.stride + tile.x0], tile.x1 - tile.x0, clearColor);
+		std::fill_n(&fb.depth[size_t(y) * fb.stride + tile.x0], tile.x1 - tile.x0, 1.f);
+	}
+
+	for (u32 ref : tile.bins[BIN_OPAQUE_TRIS])
+		rasterTriangle(fb, tile, getTriSetup(s_ctx.opaqueChunks, ref), false);
+	for (u32 i : tile.bins[BIN_LINES])
+		rasterLine(fb, tile, s_ctx.lines[i]);
+	for (u32 i : tile.bins[BIN_POINTS]) {
+		const PointSetup& p = s_ctx.points[i];
+		plot(fb, p.x, p.y, p.z, packColor(p.color));
+	}
+	for (u32 ref : tile.bins[BIN_TRANSPARENT_TRIS])
+		rasterTriangle(fb, tile, getTriSetup(s_ctx.transparentChunks, ref), true);
+}
+
+void setupTriangles(tl::CSpan<Triangle> tris, const mat4& viewProj, int w, int h,
+	std::vector<std::vector<TriSetup>>& chunks)
+{
+	const size_t numChunks = (tris.size() + SETUP_CHUNK_SIZE - 1) / SETUP_CHUNK_SIZE;
+	if (chunks.size() < numChunks)
+		chunks.resize(numChunks);
+	tl::parallelFor(0, numChunks, 1, [&](size_t chunkInd) {
+		std::vector<TriSetup>& chunk = chunks[chunkInd];
+		chunk.clear();
+		const size_t from = chunkInd * SETUP_CHUNK_SIZE;
+		const size_t to = std::min(tris.size(), from + SETUP_CHUNK_SIZE);
+		for (size_t i = from; i < to; i++)
+			setupTriangle(tris[i], viewProj, w, h, chunk);
+	});
+	for (size_t i = numChunks; i < chunks.size(); i++)
+		chunks[i].clear();
+}
+
+template <typename F>
+void forEachTile(int minX, int minY, int maxX, int maxY, F f)
+{
+	for (int ty = minY / SW_TILE_SIZE; ty <= maxY / SW_TILE_SIZE; ty++)
+	for (int tx = minX / SW_TILE_SIZE; tx <= maxX / SW_TILE_SIZE; tx++)
+		f(s_ctx.tiles[ty * s_ctx.numTilesX + tx]);
+}
+
+u32 binTriangles(const std::vector<std::vector<TriSetup>>& chunks, Bin bin)
+{
+	u32 n = 0;
+	for (size_t c = 0; c < chunks.size(); c++) {
+		for (size_t i = 0; i < chunks[c].size(); i++) {
+			const TriSetup& t = chunks[c][i];
+			const u32 ref = u32(c << 16 | i);
+			forEachTile(t.minX, t.minY, t.maxX, t.maxY, [&](Tile& tile) { tile.bins[bin].push_back(ref); });
+		}
+		n += chunks[c].size();
+	}
+	return n;
+}
+
+}
+
+void SwFramebuffer::resize(int w, int h)
+{
+	width = w;
+	height = h;
+	stride = (w + SW_TILE_SIZE - 1) / SW_TILE_SIZE * SW_TILE_SIZE;
+	const int paddedHeight = (h + SW_TILE_SIZE - 1) / SW_TILE_SIZE * SW_TILE_SIZE;
+	color.resize(size_t(stride) * paddedHeight);
+	depth.resize(size_t(stride) * paddedHeight);
+}
+
+void swRender(SwFramebuffer& fb, const DrawLists& lists, const mat4& viewProj, vec4 clearColor, SwRasterStats& stats)
+{
+	const int w = fb.width;
+	const int h = fb.height;
+	stats = {};
+	stats.numTriangles = u32(lists.triangles.size() + lists.transparentTriangles.size());
+	stats.numThreads = u32(tl::ThreadPool::get().numThreads());
+
+	const double t0 = getTime();
+	setupTriangles(lists.triangles, viewProj, w, h, s_ctx.opaqueChunks);
+	setupTriangles(lists.transparentTriangles, viewProj, w, h, s_ctx.transparentChunks);
+	s_ctx.lines.resize(lists.lines.size());
+	tl::parallelFor(0, lists.lines.size(), SETUP_CHUNK_SIZE, [&](size_t i) {
+		s_ctx.lines[i] = setupLine(lists.lines[i], viewProj, w, h);
+	});
+	s_ctx.points.resize(lists.points.size());
+	tl::parallelFor(0, lists.points.size(), SETUP_CHUNK_SIZE, [&](size_t i) {
+		s_ctx.points[i] = setupPoint(lists.points[i], viewProj, w, h);
+	});
+
+	const double t1 = getTime();
+	s_ctx.numTilesX = fb.stride / SW_TILE_SIZE;
+	s_ctx.numTilesY = (h + SW_TILE_SIZE - 1) / SW_TILE_SIZE;
+	s_ctx.tiles.resize(s_ctx.numTilesX * s_ctx.numTilesY);
+	for (int ty = 0; ty < s_ctx.numTilesY; ty++)
+	for (int tx = 0; tx < s_ctx.numTilesX; tx++) {
+		Tile& tile = s_ctx.tiles[ty * s_ctx.numTilesX + tx];
+		tile.x0 = tx * SW_TILE_SIZE;
+		tile.y0 = ty * SW_TILE_SIZE;
+		tile.x1 = std::min(w, tile.x0 + SW_TILE_SIZE);
+		tile.y1 = std::min(h, tile.y0 + SW_TILE_SIZE);
+		for (std::vector<u32>& bin : tile.bins)
+			bin.clear();
+	}
+	stats.numRasterizedTriangles += binTriangles(s_ctx.opaqueChunks, BIN_OPAQUE_TRIS);
+	stats.numRasterizedTriangles += binTriangles(s_ctx.transparentChunks, BIN_TRANSPARENT_TRIS);
+	for (u32 i = 0; i < s_ctx.lines.size(); i++) {
+		const LineSetup& l = s_ctx.lines[i];
+		if (l.minX <= l.maxX && l.minY <= l.maxY)
+			forEachTile(l.minX, l.minY, l.maxX, l.maxY, [&](Tile& tile) { tile.bins[BIN_LINES].push_back(i); });
+	}
+	for (u32 i = 0; i < s_ctx.points.size(); i++) {
+		const PointSetup& p = s_ctx.points[i];
+		if (p.x >= 0)
+			forEachTile(p.x, p.y, p.x, p.y, [&](Tile& tile) { tile.bins[BIN_POINTS].push_back(i); });
+	}
+
+	const double t2 = getTime();
+	const u32 clear = packColor(clearColor);
+	tl::parallelFor(0, s_ctx.tiles.size(), 1, [&](size_t i) {
+		rasterTile(fb, s_ctx.tiles[i], clear);
+	});
+
+	const double t3 = getTime();
+	stats.numTiles = u32(s_ctx.tiles.size());
+	stats.setupTime = t1 - t0;
+	stats.binTime = t2 - t1;
+	stats.rasterTime = t3 - t2;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include "state.hpp"
+
+// CPU rasterizer for the primitives in DrawLists, it follows the same rules as the GL renderer in main.cpp:
+// opaque triangles, lines and points with depth test (GL_LEQUAL) and depth writes, then transparent
+// triangles alpha blended without depth writes
+// The screen is split in tiles which are rasterized in parallel, each tile sees its primitives in
+// submission order, so the blending order is the same as in GL
+
+constexpr int SW_TILE_SIZE = 64;
+
+struct SwFramebuffer {
+	int width = 0, height = 0;
+	int stride = 0; // pixels per row, rounded up to a whole number of tiles
+	std::vector<u32> color; // RGBA8, the first row is the bottom one (like in GL)
+	std::vector<float> depth;
+
+	void resize(int w, int h);
+};
+
+struct SwRasterStats {
+	u32 numTriangles; // opaque + transparent triangles submitted
+	u32 numRasterizedTriangles; // after clipping and discarding degenerate or offscreen triangles
+	u32 numTiles;
+	u32 numThreads;
+	double setupTime, binTime, rasterTime; // seconds
+
+	double totalTime()const { return setupTime + binTime + rasterTime; }
+	double trisPerSec()const { return totalTime() > 0 ? numTriangles / totalTime() : 0; }
+};
+
+void swRender(SwFramebuffer& fb, const DrawLists& lists, const mat4& viewProj, vec4 clearColor, SwRasterStats& stats);
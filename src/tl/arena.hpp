@@ -0,0 +1,49 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "span.hpp"
+
+namespace tl
+{
+
+// Bump allocator over memory owned by the caller. Nothing is freed individually, reset() frees everything
+// Use bytesFor() to size the memory exactly
+class Arena
+{
+public:
+    Arena(void* data, size_t size) : _data((uint8_t*)data), _size(size), _used(0) {}
+
+    // worst case number of bytes that alloc<T>(n) consumes
+    template <typename T>
+    static constexpr size_t bytesFor(size_t n) { return n * sizeof(T) + alignof(T) - 1; }
+
+    template <typename T>
+    Span<T> alloc(size_t n);
+
+    size_t size()const { return _size; }
+    size_t used()const { return _used; }
+    void reset() { _used = 0; }
+
+private:
+    uint8_t* _data;
+    size_t _size;
+    size_t _used;
+};
+
+// ---------------------------------------------------------------------------------------------
+template <typename T>
+Span<T> Arena::alloc(size_t n)
+{
+    const uintptr_t p = (uintptr_t)(_data + _used);
+    const uintptr_t aligned = (p + alignof(T) - 1) & ~uintptr_t(alignof(T) - 1);
+    const size_t newUsed = _used + (aligned - p) + n * sizeof(T);
+    assert(newUsed <= _size);
+    if (newUsed > _size)
+        return {};
+    _used = newUsed;
+    return {(T*)aligned, n};
+}
+
+}
@@ -0,0 +1,88 @@
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace tl
+{
+
+#ifdef _WIN32
+
+bool MappedFile::open(const char* path)
+{
+    close();
+    _file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(_file == INVALID_HANDLE_VALUE) {
+        _file = nullptr;
+        return false;
+    }
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(_file, &size) || size.QuadPart == 0) {
+        close();
+        return false;
+    }
+    _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(_mapping)
+        _data = (const uint8_t*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+    if(!_data) {
+        close();
+        return false;
+    }
+    _size = size_t(size.QuadPart);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if(_data)
+        UnmapViewOfFile(_data);
+    if(_mapping)
+        CloseHandle(_mapping);
+    if(_file)
+        CloseHandle(_file);
+    _data = nullptr;
+    _mapping = _file = nullptr;
+    _size = 0;
+}
+
+#else
+
+bool MappedFile::open(const char* path)
+{
+    close();
+    const int fd = ::open(path, O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file alive
+    if(p == MAP_FAILED)
+        return false;
+    _data = (const uint8_t*)p;
+    _size = size_t(st.st_size);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if(_data)
+        munmap((void*)_data, _size);
+    _data = nullptr;
+    _size = 0;
+}
+
+#endif
+
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace tl
+{
+
+// Persistent pool of worker threads used by parallelFor()
+// Only one parallelFor runs on the pool at a time: nested calls, or calls from other threads while the
+// pool is busy, just run serially in the calling thread
+class ThreadPool
+{
+public:
+    static ThreadPool& get();
+
+    size_t numThreads()const { return _workers.size() + 1; } // workers + the calling thread
+
+    template <typename F>
+    void parallelFor(size_t begin, size_t end, size_t grainSize, F&& f);
+
+    ~ThreadPool();
+
+private:
+    struct Job {
+        void (*run)(void* ctx, size_t from, size_t to);
+        void* ctx;
+        size_t begin, end, grainSize;
+        size_t numChunks;
+        std::atomic<size_t> nextChunk;
+        std::atomic<size_t> doneChunks;
+    };
+
+    ThreadPool();
+    void workerLoop();
+    static void runChunks(Job& job);
+
+    std::vector<std::thread> _workers;
+    std::mutex _submitMutex; // held for the whole duration of a parallelFor
+    std::mutex _mutex;
+    std::condition_variable _wakeCv;
+    std::condition_variable _doneCv;
+    Job* _job = nullptr;
+    size_t _generation = 0;
+    size_t _activeWorkers = 0; // workers that could still be touching _job
+    bool _quit = false;
+
+    static thread_local bool t_insideJob;
+};
+
+// f(i) is called for every i in [begin, end), in chunks of grainSize indices
+template <typename F>
+void parallelFor(size_t begin, size_t end, size_t grainSize, F&& f)
+{
+    ThreadPool::get().parallelFor(begin, end, grainSize, f);
+}
+
+// f(from, to) is called for consecutive ranges of at most grainSize indices
+template <typename F>
+void parallelForRanges(size_t begin, size_t end, size_t grainSize, F&& f);
+
+// ---------------------------------------------------------------------------------------------
+inline thread_local bool ThreadPool::t_insideJob = false;
+
+inline ThreadPool& ThreadPool::get()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+inline ThreadPool::ThreadPool()
+{
+    const unsigned n = std::thread::hardware_concurrency();
+    for(unsigned i = 1; i < n; i++)
+        _workers.emplace_back([this] { workerLoop(); });
+}
+
+inline ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _quit = true;
+    }
+    _wakeCv.notify_all();
+    for(std::thread& t : _workers)
+        t.join();
+}
+
+inline void ThreadPool::runChunks(Job& job)
+{
+    for(;;) {
+        const size_t chunk = job.nextChunk.fetch_add(1);
+        if(chunk >= job.numChunks)
+            break;
+        const size_t from = job.begin + chunk * job.grainSize;
+        const size_t to = from + job.grainSize < job.end ? from + job.grainSize : job.end;
+        job.run(job.ctx, from, to);
+        job.doneChunks.fetch_add(1);
+    }
+}
+
+inline void ThreadPool::workerLoop()
+{
+    t_insideJob = true;
+    size_t seenGeneration = 0;
+    for(;;) {
+        Job* job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wakeCv.wait(lock, [&] { return _quit || (_job && _generation != seenGeneration); });
+            if(_quit)
+                return;
+            seenGeneration = _generation;
+            job = _job;
+            _activeWorkers++;
+        }
+        runChunks(*job);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _activeWorkers--;
+        }
+        _doneCv.notify_all();
+    }
+}
+
+template <typename F>
+void ThreadPool::parallelFor(size_t begin, size_t end, size_t grainSize, F&& f)
+{
+    if(begin >= end)
+        return;
+    if(grainSize == 0)
+        grainSize = 1;
+
+    using Fn = std::remove_reference_t<F>;
+    auto runRange = [](void* ctx, size_t from, size_t to) {
+        Fn& f = *(Fn*)ctx;
+        for(size_t i = from; i < to; i++)
+            f(i);
+    };
+
+    const size_t numChunks = (end - begin + grainSize - 1) / grainSize;
+    std::unique_lock<std::mutex> submitLock(_submitMutex, std::defer_lock);
+    if(_workers.empty() || numChunks == 1 || t_insideJob || !submitLock.try_lock()) {
+        runRange((void*)&f, begin, end);
+        return;
+    }
+
+    Job job;
+    job.run = runRange;
+    job.ctx = (void*)&f;
+    job.begin = begin;
+    job.end = end;
+    job.grainSize = grainSize;
+    job.numChunks = numChunks;
+    job.nextChunk = 0;
+    job.doneChunks = 0;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _job = &job;
+        _generation++;
+    }
+    _wakeCv.notify_all();
+
+    t_insideJob = true;
+    runChunks(job);
+    t_insideJob = false;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _doneCv.wait(lock, [&] { return job.doneChunks.load() == job.numChunks && _activeWorkers == 0; });
+    _job = nullptr;
+}
+
+template <typename F>
+void parallelForRanges(size_t begin, size_t end, size_t grainSize, F&& f)
+{
+    if(grainSize == 0)
+        grainSize = 1;
+    const size_t numRanges = (end - begin + grainSize - 1) / grainSize;
+    parallelFor(0, numRanges, 1, [&](size_t r) {
+        const size_t from = begin + r * grainSize;
+        const size_t to = from + grainSize < end ? from + grainSize : end;
+        f(from, to);
+    });
+}
+
+}
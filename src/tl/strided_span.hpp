@@ -0,0 +1,124 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "span.hpp"
+
+namespace tl
+{
+
+// Like Span but the elements are stride bytes apart, so it can view one member of an array of structs
+// without copying, e.g. the positions of an array of vertices: stridedMember(verts, &Vert::pos)
+template <typename T>
+class StridedSpan
+{
+public:
+    class Iterator
+    {
+    public:
+        Iterator(T* p, size_t stride) : _p(p), _stride(stride) {}
+        T& operator*()const { return *_p; }
+        T* operator->()const { return _p; }
+        Iterator& operator++() { _p = (T*)((uint8_t*)_p + _stride); return *this; }
+        bool operator==(const Iterator& o)const { return _p == o._p; }
+        bool operator!=(const Iterator& o)const { return _p != o._p; }
+
+    private:
+        T* _p;
+        size_t _stride;
+    };
+
+    StridedSpan();
+    StridedSpan(T* data, size_t size, size_t stride = sizeof(T));
+    StridedSpan(Span<T> span);
+    operator StridedSpan<const T>()const { return {_data, _size, _stride}; }
+
+    T& operator[](size_t i);
+    const T& operator[](size_t i)const;
+
+    Iterator begin()const { return {_data, _stride}; }
+    Iterator end()const { return {at(_size), _stride}; }
+    T* data()const { return _data; }
+    size_t size()const { return _size; }
+    size_t stride()const { return _stride; } // in bytes
+    bool isContiguous()const { return _stride == sizeof(T); }
+
+    StridedSpan<T> subArray(size_t from, size_t to)const; // "to" is not included i.e: [from, to)
+
+private:
+    T* at(size_t i)const { return (T*)((uint8_t*)_data + i * _stride); }
+
+    T* _data;
+    size_t _size;
+    size_t _stride;
+};
+
+template <typename T>
+using CStridedSpan = StridedSpan<const T>;
+
+// the member of every struct of the span
+template <typename S, typename M>
+StridedSpan<M> stridedMember(Span<S> structs, M S::*member);
+template <typename S, typename M>
+StridedSpan<const M> stridedMember(Span<const S> structs, M S::*member);
+
+// ---------------------------------------------------------------------------------------------
+template <typename T>
+StridedSpan<T>::StridedSpan()
+    : _data(nullptr)
+    , _size(0)
+    , _stride(sizeof(T))
+{}
+
+template <typename T>
+StridedSpan<T>::StridedSpan(T* data, size_t size, size_t stride)
+    : _data(data)
+    , _size(size)
+    , _stride(stride)
+{
+    assert(stride >= sizeof(T) || size <= 1);
+}
+
+template <typename T>
+StridedSpan<T>::StridedSpan(Span<T> span)
+    : _data(span.begin())
+    , _size(span.size())
+    , _stride(sizeof(T))
+{}
+
+template <typename T>
+T& StridedSpan<T>::operator[](size_t i) {
+    assert(i < _size);
+    return *at(i);
+}
+
+template <typename T>
+const T& StridedSpan<T>::operator[](size_t i)const {
+    assert(i < _size);
+    return *at(i);
+}
+
+template <typename T>
+StridedSpan<T> StridedSpan<T>::subArray(size_t from, size_t to)const {
+    assert(from <= to && to <= _size);
+    return StridedSpan<T>(at(from), to - from, _stride);
+}
+
+template <typename S, typename M>
+StridedSpan<M> stridedMember(Span<S> structs, M S::*member)
+{
+    if (structs.size() == 0)
+        return {nullptr, 0, sizeof(S)};
+    return {&(structs.begin()->*member), structs.size(), sizeof(S)};
+}
+
+template <typename S, typename M>
+StridedSpan<const M> stridedMember(Span<const S> structs, M S::*member)
+{
+    if (structs.size() == 0)
+        return {nullptr, 0, sizeof(S)};
+    return {&(structs.begin()->*member), structs.size(), sizeof(S)};
+}
+
+}
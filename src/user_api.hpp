@@ -1,10 +1,16 @@
+#pragma once
+
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
 void userInit();
 void userDraws(float dt);
 
+typedef uint8_t u8;
+typedef uint16_t u16;
 typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int16_t i16;
 typedef int32_t i32;
 using glm::vec2;
 using glm::vec3;
@@ -15,9 +21,54 @@ using glm::mat4;
 
 constexpr float PI = glm::pi<float>();
 
+// with --lazy the frame is only redrawn when something changes, an animation has to ask for new frames
+void setContinuousRedraw(bool continuous);
+void requestRedraw(); // just the next frame
+
+// what it took to produce a frame
+struct FrameStats {
+	u32 numPoints, numLines, numTriangles, numTransparentTriangles;
+	// bytes uploaded to the GPU; with the software renderer only the image is uploaded
+	size_t pointBytes, lineBytes, triangleBytes, transparentTriangleBytes, imageBytes;
+	u32 numDrawCalls; // including the gui
+	u32 numGlCalls;
+	float userDrawsTime, endRenderTime, guiTime; // CPU seconds
+	size_t stateSize, stateCapacity; // bytes used and allocated by the primitive and stack vectors
+	size_t numAllocs, allocBytes; // heap allocations in the whole frame
+	u32 numMeshDraws, numMeshTriangles; // retained meshes, see drawMesh()
+	u32 numMeshlets, numCulledMeshlets; // of the big retained meshes
+	u32 numSphereDraws, numSphereTriangles; // see drawSphere()
+};
+// the stats of the last complete frame
+const FrameStats& getFrameStats();
+
+// the camera of the frame being drawn, for choosing levels of detail
+struct ViewInfo {
+	vec3 cameraPos;
+	float pixelsPerUnit; // size in pixels of 1 unit at distance 1: viewportHeight / (2 tan(fovY / 2))
+};
+ViewInfo getViewInfo();
+
 void pushColor(glm::vec4 c);
 void popColor();
 
 void drawPoint(vec3 a);
 void drawLine(vec3 a, vec3 b);
-void drawTriangle(vec3 a, vec3 b, vec3 c/*, bool solid, bool line*/);
\ No newline at end of file
+void drawTriangle(vec3 a, vec3 b, vec3 c/*, bool solid, bool line*/);
+
+// Meshes uploaded once and drawn every frame without resubmitting their triangles. They are optimized when
+// they are created (e.g. the triangles are reordered for the vertex cache), so creating one can take a while
+// for big meshes. positionStride is the distance in bytes between positions, so they can be inside vertex structs
+typedef u32 MeshHandle; // 0 is no mesh
+MeshHandle createMesh(const vec3* positions, size_t positionStride, u32 numVerts, const u32* inds, u32 numInds);
+void destroyMesh(MeshHandle mesh);
+void drawMesh(MeshHandle mesh); // with the current color and matrix
+
+// Spheres made of an icosphere with subDivs subdivisions (the triangles of generateIcosphere(), see
+// geom/icosphere.hpp), with the current color. The vertex shader makes the vertices from their index, so a
+// sphere only uploads its center, radius and color whatever its level. The center is transformed by the current
+// matrix and the radius scaled by its largest axis
+// The vertex shader finds the row of a triangle from sqrt(float(l)), with l < 4^subDivs, which is exact up to 12
+// subdivisions. 10 already makes 63M vertices per sphere. subDivs is clamped to [0, MAX_SPHERE_SUBDIVS]
+constexpr int MAX_SPHERE_SUBDIVS = 10;
+void drawSphere(vec3 center, float radius, int subDivs);